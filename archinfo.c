@@ -19,40 +19,41 @@
 	3. This notice may not be removed or altered from any source distribution.
 */
 
-#if   defined(_WIN32)
-	#include <windows.h>
-#elif defined(__linux__)
-	#define _GNU_SOURCE
-	#include <unistd.h>
-	#include <sched.h>
-	#include <pthread.h>
-#else
+#if !defined(_WIN32) && !defined(__linux__)
 	#error "Platform not supported!"
 #endif
 
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "archinfo.h"
-
-// maximum cpuid leaf
-uint32_t MaxLeaf = 0;
-
-// maximum cpuid extended leaf
-uint32_t MaxExtLeaf = 0;
-
-// xcr0 register state
-uint64_t XCR0 = 0;
-
-// cpu features
-cpu_features_t Features = { 0 };
-
-// cpu extended features
-cpu_features_ext_t FeaturesExt = { 0 };
-
-
-uint64_t xcr0_state()
+#include "dump.h"
+#include "snapshot.h"
+#include "dispatch.h"
+
+// the decoders read the leaves of the snapshot source: the cpu, or the first cpu of a replayed dump
+#define LEAF(info, leaf, subleaf, a, b, c, d) \
+	do \
+	{ \
+		if((info)->dump == NULL) \
+		{ \
+			CPUID_EXT(leaf, subleaf, a, b, c, d); \
+		} \
+		else \
+		{ \
+			uint32_t regs[4]; \
+			dump_leaf((info)->dump, 0, leaf, subleaf, regs); \
+			(a) = regs[0]; (b) = regs[1]; (c) = regs[2]; (d) = regs[3]; \
+		} \
+	} while(0)
+
+// validated feature registers, alone in their cache line
+uint64_t ArchinfoFeatureWords[ARCHINFO_WORDS] __attribute__((aligned(64))) = { 0 };
+
+// feature query state: 0 not decoded, 1 decoding, 2 published
+static uint32_t FeaturesState = 0;
+
+static uint64_t xcr0_state()
 {
 	uint32_t eax, edx;
 
@@ -98,52 +99,261 @@ int cpuid_available()
 #endif
 }
 
-void max_leaf_vendor();
-void max_ext_leaf();
-void sign_brand_features();
-void ext_features();
-void frequencies();
-void topology();
-void single_core_topology();
-void multi_core_topology();
-void cache_tlb();
+static void max_leaf_vendor(archinfo_t* info);
+static void max_ext_leaf(archinfo_t* info);
+static void validate_features(cpu_features_t* features, uint64_t xcr0);
+static void validate_features_ext(cpu_features_ext_t* features_ext, const cpu_features_t* features, uint64_t xcr0);
+static void sign_brand_features(archinfo_t* info);
+static void ext_features(archinfo_t* info);
+static void xsave(archinfo_t* info);
+static void rdt(archinfo_t* info);
+static void pmu(archinfo_t* info);
+static void frequencies(archinfo_t* info);
+static void tsc(archinfo_t* info);
+static void topology(archinfo_t* info, uint32_t flags);
+static void cache_tlb(archinfo_t* info);
+static void tlbs(archinfo_t* info);
+static void core_types(archinfo_t* info, uint32_t flags);
+static void words_scan(archinfo_t* info);
+static int query(archinfo_t* info, const cpuid_dump_t* dump, uint32_t flags);
+
+
+static void features_query(archinfo_t* info)
+{
+	// get the maximum cpuid leaf and the cpu vendor id
+	max_leaf_vendor(info);
+
+	// get the maximum cpuid extended leaf
+	max_ext_leaf(info);
+
+	// get the signature, the brand and the features of the cpu
+	sign_brand_features(info);
+
+	// get the extended features of the cpu
+	ext_features(info);
+
+	// get the xsave features and state components
+	xsave(info);
+
+	// get the resource director technology capabilities
+	rdt(info);
+
+	// get the performance monitoring counters
+	pmu(info);
+}
+
 
+int archinfo_query(archinfo_t* info)
+{
+	return archinfo_query_ex(info, 0);
+}
 
-int main(int argc, char* argv[])
+int archinfo_query_ex(archinfo_t* info, uint32_t flags)
 {
-	// check if the cpuid instruction is available
-	if(!cpuid_available())
+	return query(info, NULL, flags);
+}
+
+int archinfo_query_dump(archinfo_t* info, const cpuid_dump_t* dump)
+{
+	return query(info, dump, 0);
+}
+
+static int query(archinfo_t* info, const cpuid_dump_t* dump, uint32_t flags)
+{
+	memset(info, 0, sizeof(archinfo_t));
+
+	info->dump = dump;
+
+	// check if the cpuid instruction is available, a dump does not need it
+	if(dump == NULL && !cpuid_available())
+		return 0;
+
+	// get the vendor, the signature and the features of the cpu
+	features_query(info);
+
+	// get the cpu base and maximum frequencies and the bus frequency
+	frequencies(info);
+
+	// get the time stamp counter frequency and invariance
+	tsc(info);
+
+	// get informations about the cpu topology and the caches
+	topology(info, flags);
+
+	// get the cache and tlb descriptors
+	cache_tlb(info);
+
+	// get the deterministic tlb parameters
+	tlbs(info);
+
+	return 1;
+}
+
+void archinfo_free(archinfo_t* info)
+{
+	// the arrays of a cached snapshot belong to its mapping
+	if(info->mapping != NULL)
 	{
-		printf("CPUID is not supported\n");
-	
-		return 1;
+		snapshot_release(info);
+
+		return;
 	}
 
-	// get the maximum cpuid leaf and print the cpu vendor id
-	max_leaf_vendor();
+	for(uint32_t i = 0; i < info->caches_cnt; ++i)
+	{
+		free(info->caches[i].instances);
+		free(info->caches[i].instances_cpus);
 
-	// get the maximum cpuid extended leaf
-	max_ext_leaf();
+		info->caches[i].instances = NULL;
+		info->caches[i].instances_cpus = NULL;
+	}
+
+	free(info->topology.cpus);
+	free(info->topology.cores_ids);
+
+	info->topology.cpus = NULL;
+	info->topology.cores_ids = NULL;
+}
+
+int archinfo_tsc(cpu_tsc_t* tsc_info)
+{
+	archinfo_t info;
+
+	memset(&info, 0, sizeof(archinfo_t));
+	memset(tsc_info, 0, sizeof(cpu_tsc_t));
+
+	if(!cpuid_available())
+		return 0;
 
-	// print the signature, the brand and the features of the cpu
-	sign_brand_features();
+	// the tsc leaves need the maximum leaves and the base frequency, not the topology
+	max_leaf_vendor(&info);
+	max_ext_leaf(&info);
+	frequencies(&info);
+	tsc(&info);
 
-	// print the extended features of the cpu
-	ext_features();
+	*tsc_info = info.tsc;
 
-	// print the cpu base and maximum frequencies and the bus frequency
-	frequencies();
+	return 1;
+}
+
+uint32_t archinfo_pmu(cpu_pmu_t* pmu_info)
+{
+	archinfo_t info;
+
+	memset(&info, 0, sizeof(archinfo_t));
+	memset(pmu_info, 0, sizeof(cpu_pmu_t));
+
+	if(!cpuid_available())
+		return VENDOR_UNKNOWN;
+
+	// the pmu leaves need the vendor and the maximum leaves only
+	max_leaf_vendor(&info);
+	max_ext_leaf(&info);
+	pmu(&info);
+
+	*pmu_info = info.pmu;
+
+	return info.vendor_num;
+}
+
+uint64_t archinfo_features_init(uint32_t word)
+{
+	uint32_t state = 0;
+
+	// the first caller decodes the features, the others wait for the publication
+	if(__atomic_compare_exchange_n(&FeaturesState, &state, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+	{
+		// zero-initialized without calling into libc, so any dispatched function can get here
+		static archinfo_t info;
+
+		if(cpuid_available())
+			features_query(&info);
+
+		uint64_t words[ARCHINFO_WORDS] = { 0 };
+
+		words[ARCHINFO_EDX]     = info.features.edx.value;
+		words[ARCHINFO_ECX]     = info.features.ecx.value;
+		words[ARCHINFO_EXT_EBX] = info.features_ext.ebx.value;
+		words[ARCHINFO_EXT_ECX] = info.features_ext.ecx.value;
 
-	// print informations about the cpu topology
-	if(!Features.edx.htt)
-		single_core_topology();
+		// publish the words, each one carrying the ready bit
+		for(uint32_t i = 0; i < ARCHINFO_WORDS; ++i)
+			__atomic_store_n(&ArchinfoFeatureWords[i], words[i] | ARCHINFO_READY, __ATOMIC_RELAXED);
+
+		__atomic_store_n(&FeaturesState, 2, __ATOMIC_RELEASE);
+	}
 	else
-		multi_core_topology();
+	{
+		// wait until the first caller has published the words
+		while(__atomic_load_n(&FeaturesState, __ATOMIC_ACQUIRE) != 2)
+			__builtin_ia32_pause();
+	}
 
-	// print informations about the cache and the tlb
-	cache_tlb();
+	return __atomic_load_n(&ArchinfoFeatureWords[word], __ATOMIC_RELAXED);
+}
 
-	return 0;
+static uint32_t feature_word(uint32_t word)
+{
+	uint64_t value = __atomic_load_n(&ArchinfoFeatureWords[word], __ATOMIC_RELAXED);
+
+	if(!(value & ARCHINFO_READY))
+		value = archinfo_features_init(word);
+
+	return (uint32_t)value;
+}
+
+int archinfo_features_restrict(const archinfo_t* info)
+{
+	// a snapshot without logical processors has nothing to compare
+	if(info->topology.threads_cnt == 0)
+		return 0;
+
+	const uint32_t* common = info->words_common;
+
+	cpu_features_t features = { .edx.value = common[CPU_WORD_1_EDX], .ecx.value = common[CPU_WORD_1_ECX] };
+	cpu_features_ext_t features_ext = { .ebx.value = common[CPU_WORD_7_EBX], .ecx.value = common[CPU_WORD_7_ECX] };
+
+	// the vector extensions need their state components on every logical processor too, if they enumerate them
+	uint64_t supported = ((uint64_t)common[CPU_WORD_D_EDX] << 32) | common[CPU_WORD_D_EAX];
+	uint64_t xcr0 = (supported != 0) ? info->xcr0 & supported : info->xcr0;
+
+	validate_features(&features, xcr0);
+	validate_features_ext(&features_ext, &features, xcr0);
+
+	uint64_t masks[ARCHINFO_WORDS] = { 0 };
+
+	masks[ARCHINFO_EDX]     = features.edx.value;
+	masks[ARCHINFO_ECX]     = features.ecx.value;
+	masks[ARCHINFO_EXT_EBX] = features_ext.ebx.value;
+	masks[ARCHINFO_EXT_ECX] = features_ext.ecx.value;
+
+	int removed = 0;
+
+	// publish the words first, then clear the features some logical processor does not report
+	for(uint32_t i = 0; i < ARCHINFO_WORDS; ++i)
+	{
+		uint64_t word = feature_word(i) | ARCHINFO_READY;
+
+		if((word & ~(masks[i] | ARCHINFO_READY)) != 0)
+			removed = 1;
+
+		__atomic_fetch_and(&ArchinfoFeatureWords[i], masks[i] | ARCHINFO_READY, __ATOMIC_RELAXED);
+	}
+
+	// the functions dispatched before pick their candidate again among the common features
+	if(removed)
+		dispatch_relink();
+
+	return removed;
+}
+
+void archinfo_features(cpu_features_t* features, cpu_features_ext_t* features_ext)
+{
+	features->edx.value = feature_word(ARCHINFO_EDX);
+	features->ecx.value = feature_word(ARCHINFO_ECX);
+
+	features_ext->ebx.value = feature_word(ARCHINFO_EXT_EBX);
+	features_ext->ecx.value = feature_word(ARCHINFO_EXT_ECX);
 }
 
 const char* microarch_info(uint32_t model_num)
@@ -209,7 +419,85 @@ const char* microarch_info(uint32_t model_num)
 	}
 }
 
-uint32_t fast_log2(uint32_t x)
+static const char* microarch_info_amd(uint32_t family_num, uint32_t model_num)
+{
+	// https://en.wikipedia.org/wiki/List_of_AMD_CPU_microarchitectures
+	// https://en.wikichip.org/wiki/amd/cpuid
+	//
+	// the models of a family are allocated in blocks of 16 to the products of a microarchitecture
+
+	switch(family_num)
+	{
+	// hygon dhyana is a zen core
+	case 0x17:
+	case 0x18:
+		switch(model_num >> 4)
+		{
+		case 0x0:
+		case 0x1:
+		case 0x2:
+			return ((model_num & 0xF) >= 0x8) ? "Zen+ - 12 nm" : "Zen - 14 nm";
+		case 0x3:
+		case 0x4:
+		case 0x6:
+		case 0x7:
+		case 0x9:
+		case 0xA:
+			return "Zen 2 - 7 nm";
+		}
+		break;
+
+	case 0x19:
+		switch(model_num >> 4)
+		{
+		case 0x0:
+		case 0x2:
+		case 0x3:
+		case 0x5:
+			return "Zen 3 - 7 nm";
+		case 0x4:
+			return "Zen 3+ - 6 nm";
+		case 0x1:
+		case 0x6:
+		case 0x7:
+		case 0xA:
+			return "Zen 4 - 5 nm";
+		}
+		break;
+
+	case 0x1A:
+		return "Zen 5 - 4 nm";
+	}
+
+	return "<Unknow>";
+}
+
+const char* microarch_name(uint32_t vendor_num, uint32_t family_num, uint32_t model_num)
+{
+	switch(vendor_num)
+	{
+	case VENDOR_INTEL:
+		return microarch_info(model_num);
+	case VENDOR_AMD:
+		return microarch_info_amd(family_num, model_num);
+
+	default:
+		return "<Unknow>";
+	}
+}
+
+uint32_t archinfo_vendor(const cpu_vendor_t* vendor)
+{
+	if(memcmp(vendor->id, "GenuineIntel", 12) == 0)
+		return VENDOR_INTEL;
+
+	if(memcmp(vendor->id, "AuthenticAMD", 12) == 0 || memcmp(vendor->id, "HygonGenuine", 12) == 0)
+		return VENDOR_AMD;
+
+	return VENDOR_UNKNOWN;
+}
+
+static uint32_t fast_log2(uint32_t x)
 {
 	uint32_t y;
 
@@ -223,7 +511,7 @@ uint32_t fast_log2(uint32_t x)
 	return y;
 }
 
-uint32_t round_next_pow2(uint32_t x)
+static uint32_t round_next_pow2(uint32_t x)
 {
 	x--;
 	x |= x >>  1;
@@ -236,7 +524,7 @@ uint32_t round_next_pow2(uint32_t x)
 	return x;
 }
 
-uint32_t find(uint32_t* v, uint32_t n, uint32_t val)
+static uint32_t find(uint32_t* v, uint32_t n, uint32_t val)
 {
 	for(uint32_t i = 0; i < n; ++i)
 		if(v[i] == val)
@@ -245,22 +533,12 @@ uint32_t find(uint32_t* v, uint32_t n, uint32_t val)
 	return n;
 }
 
-uint32_t apic_id()
+static int cache_info(const archinfo_t* info, cpu_cache_t* cache, uint32_t leaf, uint32_t subleaf)
 {
 	uint32_t eax, ebx, ecx, edx;
 
-	// get the apic id of the current logical processor
-	CPUID(0x1, eax, ebx, ecx, edx);
-
-	return ebx >> 24;
-}
-
-int cache_info(cpu_cache_t* cache, uint32_t subleaf)
-{
-	uint32_t eax, ebx, ecx, edx;
-
-	// get cache informations
-	CPUID_EXT(0x4, subleaf, eax, ebx, ecx, edx);
+	// get cache informations, leaf 0x8000001D has the layout of leaf 0x4 without the cores of the package
+	LEAF(info, leaf, subleaf, eax, ebx, ecx, edx);
 
 	uint32_t type = eax & 0x3;
 
@@ -268,7 +546,7 @@ int cache_info(cpu_cache_t* cache, uint32_t subleaf)
 		return 0;
 
 	cache->level = (eax >> 5) & 0x7;
-	cache->type = CacheTypeStrings[type];
+	cache->type = type;
 
 	cache->line_size = (ebx & 0xFFF) + 1;
 	cache->partitions = ((ebx >> 12) & 0x3FF) + 1;
@@ -285,395 +563,912 @@ int cache_info(cpu_cache_t* cache, uint32_t subleaf)
 	return 1;
 }
 
-void print_cache_info(cpu_cache_t cache)
+static int cache_sharing(archinfo_t* info, cpu_cache_t* cache, uint32_t index)
+{
+	cpu_topology_t* topology = &info->topology;
+
+	cpu_cache_instance_t* instances = calloc(topology->threads_cnt, sizeof(cpu_cache_instance_t));
+	uint32_t* instances_cpus = calloc(topology->threads_cnt, sizeof(uint32_t));
+	uint32_t* cores_ids = calloc(topology->threads_cnt, sizeof(uint32_t));
+
+	if(instances == NULL || instances_cpus == NULL || cores_ids == NULL)
+	{
+		free(instances);
+		free(instances_cpus);
+		free(cores_ids);
+
+		return 0;
+	}
+
+	uint32_t instances_cnt = 0;
+
+	// the logical processors sharing an instance have the same apic id above the sharing mask
+	for(uint32_t i = 0; i < topology->threads_cnt; ++i)
+	{
+		cpu_logical_t* cpu = &topology->cpus[i];
+		uint32_t id = cpu->apic_id & ~cache->mask;
+
+		uint32_t k = 0;
+
+		while(k < instances_cnt && instances[k].id != id)
+			++k;
+
+		if(k == instances_cnt)
+		{
+			instances[k].id = id;
+			instances[k].die_id = cpu->die_id;
+			instances[k].package_id = cpu->package_id;
+
+			instances_cnt++;
+		}
+
+		instances[k].cpus_cnt++;
+
+		cpu->cache_instances[index] = k;
+	}
+
+	// give every instance its slice of the cpus array
+	uint32_t offset = 0;
+
+	for(uint32_t k = 0; k < instances_cnt; ++k)
+	{
+		instances[k].cpus = &instances_cpus[offset];
+
+		offset += instances[k].cpus_cnt;
+
+		instances[k].cpus_cnt = 0;
+	}
+
+	// fill the slices in cpu order and check if an instance spans more than one core
+	for(uint32_t i = 0; i < topology->threads_cnt; ++i)
+	{
+		cpu_logical_t* cpu = &topology->cpus[i];
+		cpu_cache_instance_t* instance = &instances[cpu->cache_instances[index]];
+
+		if(instance->cpus_cnt != 0 && cores_ids[cpu->cache_instances[index]] != cpu->core_id)
+			cache->shared = 1;
+
+		cores_ids[cpu->cache_instances[index]] = cpu->core_id;
+
+		instance->cpus[instance->cpus_cnt] = cpu->cpu;
+		instance->cpus_cnt++;
+	}
+
+	free(cores_ids);
+
+	cache->instances = instances;
+	cache->instances_cpus = instances_cpus;
+	cache->instances_cnt = instances_cnt;
+
+	return 1;
+}
+
+// check the topology extensions of an amd cpu, which implement the leaves 0x8000001D and 0x8000001E
+static int topology_extensions(const archinfo_t* info)
 {
-	printf("Cache Level %u %s:\n", cache.level, cache.type);
-	printf("Size: %u KB, %u partitions\n", cache.size >> 10, cache.partitions);
-	printf("%u sets, %u-way set associative, %u byte line size\n\n", cache.sets, cache.ways, cache.line_size);
+	uint32_t eax, ebx, ecx, edx;
+
+	if(info->vendor_num != VENDOR_AMD || info->max_ext_leaf < 0x8000001E)
+		return 0;
+
+	LEAF(info, 0x80000001, 0x0, eax, ebx, ecx, edx);
+
+	return (ecx >> 22) & 0x1;
 }
 
-void print_cache_tlb_info(uint32_t reg)
+static void caches(archinfo_t* info)
 {
-	const char* info0 = CacheTlbDescriptors[(reg      ) & 0xFF];
-	const char* info1 = CacheTlbDescriptors[(reg >>  8) & 0xFF];
-	const char* info2 = CacheTlbDescriptors[(reg >> 16) & 0xFF];
-	const char* info3 = CacheTlbDescriptors[(reg >> 24) & 0xFF];
+	uint32_t leaf = 0x4;
+
+	// amd cpus enumerate their caches in an extended leaf, otherwise check the maximum cpuid leaf
+	if(topology_extensions(info))
+		leaf = 0x8000001D;
+	else if(info->vendor_num == VENDOR_AMD || info->max_leaf < 0x4)
+		return;
 
-	if(info0 != NULL) printf("%s\n", info0);
-	if(info1 != NULL) printf("%s\n", info1);
-	if(info2 != NULL) printf("%s\n", info2);
-	if(info3 != NULL) printf("%s\n", info3);
+	// retrieve informations about every cache
+	while(info->caches_cnt < MAX_CACHES && cache_info(info, &info->caches[info->caches_cnt], leaf, info->caches_cnt))
+		info->caches_cnt++;
+
+	// map the logical processors to the instances of every cache
+	for(uint32_t i = 0; i < info->caches_cnt; ++i)
+		cache_sharing(info, &info->caches[i], i);
 }
 
-void max_leaf_vendor()
+static void cache_tlb_descriptors(archinfo_t* info, uint32_t reg)
 {
-	cpu_vendor_t vendor = { 0 };
+	for(uint32_t i = 0; i < 4; ++i)
+	{
+		uint8_t descriptor = (reg >> (i * 8)) & 0xFF;
+
+		// skip the null and the unknown descriptors
+		if(CacheTlbDescriptors[descriptor] == NULL)
+			continue;
+
+		if(info->tlb_descriptors_cnt < MAX_TLB_DESCRIPTORS)
+		{
+			info->tlb_descriptors[info->tlb_descriptors_cnt] = descriptor;
+
+			info->tlb_descriptors_cnt++;
+		}
+	}
+}
 
+static void max_leaf_vendor(archinfo_t* info)
+{
 	// get the maximum cpuid leaf and cpu vendor id
-	CPUID(0x0, MaxLeaf, vendor.dword0, vendor.dword2, vendor.dword1);
+	LEAF(info, 0x0, 0x0, info->max_leaf, info->vendor.dword0, info->vendor.dword2, info->vendor.dword1);
 
-	// print the vendor id
-	printf("Vendor ID: %s\n\n", vendor.id);
+	info->vendor_num = archinfo_vendor(&info->vendor);
 }
 
-void max_ext_leaf()
+static void max_ext_leaf(archinfo_t* info)
 {
 	uint32_t ebx, ecx, edx;
 
 	// get the maximum cpuid extended leaf
-	CPUID(0x80000000, MaxExtLeaf, ebx, ecx, edx);
+	LEAF(info, 0x80000000, 0x0, info->max_ext_leaf, ebx, ecx, edx);
+}
+
+// clear the features whose state components the xcr0 does not enable
+static void validate_features(cpu_features_t* features, uint64_t xcr0)
+{
+	// check the avx feature bit validity
+	features->ecx.avx &= (xcr0 & 0x6) == 0x6;
+
+	// check the f16c and fma feature bits validity
+	features->ecx.f16c &= features->ecx.avx;
+	features->ecx.fma  &= features->ecx.avx;
 }
 
-void sign_brand_features()
+static void validate_features_ext(cpu_features_ext_t* features_ext, const cpu_features_t* features, uint64_t xcr0)
 {
-	cpu_signature_t signature;
+	// check the avx2 feature bit validity
+	features_ext->ebx.avx2 &= features->ecx.avx;
+
+	// check the avx512 feature bits validity
+	features_ext->ebx.avx512f  &= (xcr0 & 0xE6) == 0xE6;
+	features_ext->ebx.avx512dq &= features_ext->ebx.avx512f;
+	features_ext->ebx.avx512pf &= features_ext->ebx.avx512f;
+	features_ext->ebx.avx512er &= features_ext->ebx.avx512f;
+	features_ext->ebx.avx512cd &= features_ext->ebx.avx512f;
+	features_ext->ebx.avx512bw &= features_ext->ebx.avx512f;
+	features_ext->ebx.avx512vl &= features_ext->ebx.avx512f;
+}
+
+static void sign_brand_features(archinfo_t* info)
+{
+	cpu_features_t* features = &info->features;
 	uint32_t ebx;
 
 	// get the cpu signature, brand index and basic features
-	CPUID(0x1, signature.value, ebx, Features.ecx.value, Features.edx.value);
-
-	uint32_t brand[12] = { 0 };
+	LEAF(info, 0x1, 0x0, info->signature.value, ebx, features->ecx.value, features->edx.value);
 
 	// check the maximum cpuid extension leaf
-	if(MaxExtLeaf < 0x80000004)
+	if(info->max_ext_leaf < 0x80000004)
 	{
 		uint32_t brand_index = ebx & 0xFF;
 
 		// copy the brand string
-		strcpy((char*)brand, BrandStrings[brand_index]);
+		strncpy(info->brand, BrandStrings[brand_index] ? BrandStrings[brand_index] : BrandStrings[0], sizeof(info->brand) - 1);
 	}
 	else
 	{
+		uint32_t* brand = (uint32_t*)info->brand;
+
 		// get the brand string
-		CPUID(0x80000002, brand[ 0], brand[ 1], brand[ 2], brand[ 3]);
-		CPUID(0x80000003, brand[ 4], brand[ 5], brand[ 6], brand[ 7]);
-		CPUID(0x80000004, brand[ 8], brand[ 9], brand[10], brand[11]);
+		LEAF(info, 0x80000002, 0x0, brand[ 0], brand[ 1], brand[ 2], brand[ 3]);
+		LEAF(info, 0x80000003, 0x0, brand[ 4], brand[ 5], brand[ 6], brand[ 7]);
+		LEAF(info, 0x80000004, 0x0, brand[ 8], brand[ 9], brand[10], brand[11]);
 	}
 
-	// print the brand string
-	printf("Brand: %s\n\n", (char*)brand);
-
-	// print the stepping id, model and family of the cpu
-	printf("Stepping ID: %X\n", signature.stepping);
-	printf("Model: %X\n", signature.model);
-	printf("Family: %X\n", signature.family);
+	info->family_num = info->signature.family;
+	info->model_num = info->signature.model;
 
-	uint32_t model_num = signature.model;
+	// check the extended family number
+	if(info->signature.family == 0xF)
+		info->family_num += info->signature.family_ext;
 
 	// check the extended model number
-	if(signature.family == 0x6 || signature.family == 0xF)
+	if(info->signature.family == 0x6 || info->signature.family == 0xF)
+		info->model_num |= (info->signature.model_ext << 4);
+
+	// check the osxsave feature and set the xcr0 register state
+	if(features->ecx.osxsave)
+		info->xcr0 = (info->dump == NULL) ? xcr0_state() : info->dump->xcr0;
+
+	validate_features(features, info->xcr0);
+}
+
+static void ext_features(archinfo_t* info)
+{
+	// check the maximum cpuid leaf
+	if(info->max_leaf < 0x7)
+		return;
+
+	cpu_features_ext_t* features_ext = &info->features_ext;
+	uint32_t eax, edx;
+
+	// get the cpu extended features
+	LEAF(info, 0x7, 0x0, eax, features_ext->ebx.value, features_ext->ecx.value, edx);
+
+	info->hybrid = (edx >> 15) & 0x1;
+
+	validate_features_ext(features_ext, &info->features, info->xcr0);
+}
+
+static void xsave(archinfo_t* info)
+{
+	// check the maximum cpuid leaf and the xsave feature
+	if(info->max_leaf < 0xD || !info->features.ecx.xsave)
+		return;
+
+	cpu_xsave_t* xsave = &info->xsave;
+	uint32_t eax, ecx, edx;
+
+	// get the supported user components and the standard format sizes
+	LEAF(info, 0xD, 0x0, eax, xsave->enabled_size, xsave->max_size, edx);
+	xsave->supported = ((uint64_t)edx << 32) | eax;
+
+	// get the xsave extensions and the supervisor components
+	LEAF(info, 0xD, 0x1, eax, xsave->compacted_size, ecx, edx);
+	xsave->supported_xss = ((uint64_t)edx << 32) | ecx;
+
+	xsave->xsaveopt = (eax >> 0) & 0x1;
+	xsave->xsavec   = (eax >> 1) & 0x1;
+	xsave->xgetbv1  = (eax >> 2) & 0x1;
+	xsave->xsaves   = (eax >> 3) & 0x1;
+	xsave->xfd      = (eax >> 4) & 0x1;
+
+	// the x87 and sse components are in the fixed legacy region
+	xsave->components[0].size = 160;
+	xsave->components[1].offset = 160;
+	xsave->components[1].size = 256;
+
+	for(uint32_t i = 2; i < XSAVE_COMPONENTS; ++i)
 	{
-		model_num |= (signature.model_ext << 4);
+		if(!(((xsave->supported | xsave->supported_xss) >> i) & 0x1))
+			continue;
+
+		cpu_xsave_component_t* component = &xsave->components[i];
 
-		printf("Extended Model: %X\n", model_num);
+		LEAF(info, 0xD, i, component->size, component->offset, ecx, edx);
+
+		component->supervisor = (ecx >> 0) & 0x1;
+		component->aligned    = (ecx >> 1) & 0x1;
+		component->xfd        = (ecx >> 2) & 0x1;
 	}
+}
 
-	// check the extended family
-	if(signature.family != 0xF)
-		printf("Extended Family: %X\n", signature.family_ext + signature.family);
+uint32_t archinfo_xsave_size(const archinfo_t* info, uint64_t mask, int compacted)
+{
+	const cpu_xsave_t* xsave = &info->xsave;
 
-	printf("\n");
+	// the legacy region and the header are always present
+	uint32_t size = 576;
 
-	// print informations about the microarchitecture
-	printf("Microarchitecture: %s\n\n", microarch_info(model_num));
+	for(uint32_t i = 2; i < XSAVE_COMPONENTS; ++i)
+	{
+		const cpu_xsave_component_t* component = &xsave->components[i];
 
-	// check the osxsave feature and set the xcr0 register state
-	XCR0 = (Features.ecx.osxsave) ? xcr0_state() : 0;
+		if(!((mask >> i) & 0x1) || component->size == 0)
+			continue;
 
-	// check the avx feature bit validity
-	Features.ecx.avx &= (XCR0 & 0x6) == 0x6;
-		
-	// check the f16c and fma feature bits validity
-	Features.ecx.f16c &= Features.ecx.avx;
-	Features.ecx.fma  &= Features.ecx.avx;
+		// the compacted format packs the components in order, the standard one has fixed offsets
+		if(compacted)
+			size = (component->aligned ? (size + 63) & ~63u : size) + component->size;
+		else if(component->offset + component->size > size)
+			size = component->offset + component->size;
+	}
 
-	printf("Features:\n");
+	return size;
+}
 
-	// print the features encoded in edx
-	for(uint32_t i = 0; i < EDX_FEATURES_SIZE; ++i)
-		if(Features.edx.value & EdxFeatures[i].mask)
-			printf("%s ", EdxFeatures[i].name);
+static void rdt_cat(archinfo_t* info, uint32_t subleaf, cpu_rdt_cat_t* cat)
+{
+	uint32_t eax, ebx, ecx, edx;
 
-	// print the features encoded in ecx
-	for(uint32_t i = 0; i < ECX_FEATURES_SIZE; ++i)
-		if(Features.ecx.value & EcxFeatures[i].mask)
-			printf("%s ", EcxFeatures[i].name);
+	LEAF(info, 0x10, subleaf, eax, ebx, ecx, edx);
 
-	printf("\n\n");
+	cat->cbm_length = (eax & 0x1F) + 1;
+	cat->shared_mask = ebx;
+	cat->cdp = (ecx >> 2) & 0x1;
+	cat->noncontiguous = (ecx >> 3) & 0x1;
+	cat->closids = (edx & 0xFFFF) + 1;
 }
 
-void ext_features()
+static void rdt(archinfo_t* info)
 {
 	// check the maximum cpuid leaf
-	if(MaxLeaf < 0x7)
+	if(info->max_leaf < 0x10)
 		return;
 
-	uint32_t eax, edx;
+	cpu_rdt_t* rdt = &info->rdt;
+	uint32_t eax, ebx, ecx, edx;
 
-	// get the cpu extended features
-	CPUID_EXT(0x7, 0x0, eax, FeaturesExt.ebx.value, FeaturesExt.ecx.value, edx);
+	// get the l3 monitoring capabilities
+	if(info->features_ext.ebx.rdt_m)
+	{
+		LEAF(info, 0xF, 0x0, eax, ebx, ecx, edx);
 
-	// check the avx2 feature bit validity
-	FeaturesExt.ebx.avx2 &= Features.ecx.avx;
+		if(edx & 0x2)
+		{
+			LEAF(info, 0xF, 0x1, eax, rdt->upscaling, ecx, edx);
 
-	// check the avx512 feature bits validity
-	FeaturesExt.ebx.avx512f  &= (XCR0 & 0xE6) == 0xE6;
-	FeaturesExt.ebx.avx512dq &= FeaturesExt.ebx.avx512f;
-	FeaturesExt.ebx.avx512pf &= FeaturesExt.ebx.avx512f;
-	FeaturesExt.ebx.avx512er &= FeaturesExt.ebx.avx512f;
-	FeaturesExt.ebx.avx512cd &= FeaturesExt.ebx.avx512f;
-	FeaturesExt.ebx.avx512bw &= FeaturesExt.ebx.avx512f;
-	FeaturesExt.ebx.avx512vl &= FeaturesExt.ebx.avx512f;
+			rdt->rmids = ecx + 1;
+			rdt->counter_width = 24 + (eax & 0xFF);
+
+			rdt->llc_occupancy = (edx >> 0) & 0x1;
+			rdt->mbm_total     = (edx >> 1) & 0x1;
+			rdt->mbm_local     = (edx >> 2) & 0x1;
+		}
+	}
 
-	printf("Extended Features:\n");
+	// get the allocation capabilities of the l3, the l2 and the memory bandwidth
+	if(info->features_ext.ebx.rdt_a)
+	{
+		LEAF(info, 0x10, 0x0, eax, ebx, ecx, edx);
+
+		if(ebx & 0x2)
+			rdt_cat(info, 0x1, &rdt->l3);
 
-	// print the extended features encoded in ebx
-	for(uint32_t i = 0; i < EBX_EXT_FEATURES_SIZE; ++i)
-		if(FeaturesExt.ebx.value & EbxExtFeatures[i].mask)
-			printf("%s ", EbxExtFeatures[i].name);
+		if(ebx & 0x4)
+			rdt_cat(info, 0x2, &rdt->l2);
 
-	// print the extended features encoded in ecx
-	for(uint32_t i = 0; i < ECX_EXT_FEATURES_SIZE; ++i)
-		if(FeaturesExt.ecx.value & EcxExtFeatures[i].mask)
-			printf("%s ", EcxExtFeatures[i].name);
+		if(ebx & 0x8)
+		{
+			LEAF(info, 0x10, 0x3, eax, ebx, ecx, edx);
 
-	printf("\n\n");
+			rdt->mba_max = (eax & 0xFFF) + 1;
+			rdt->mba_linear = (ecx >> 2) & 0x1;
+			rdt->mba_closids = (edx & 0xFFFF) + 1;
+		}
+	}
 }
 
-void frequencies()
+static void pmu_amd(archinfo_t* info)
 {
+	cpu_pmu_t* pmu = &info->pmu;
+	uint32_t eax, ebx, ecx, edx;
+
+	// the core counters are 48 bits wide, 6 of them with the core performance counter extensions
+	LEAF(info, 0x80000001, 0x0, eax, ebx, ecx, edx);
+
+	pmu->counters = ((ecx >> 23) & 0x1) ? 6 : 4;
+	pmu->counter_width = 48;
+
+	// performance monitoring version 2 enumerates the number of core counters
+	if(info->max_ext_leaf < 0x80000022)
+		return;
+
+	LEAF(info, 0x80000022, 0x0, eax, ebx, ecx, edx);
+
+	if(eax & 0x1)
+		pmu->counters = ebx & 0xF;
+}
+
+static void pmu(archinfo_t* info)
+{
+	if(info->vendor_num == VENDOR_AMD)
+	{
+		pmu_amd(info);
+
+		return;
+	}
+
 	// check the maximum cpuid leaf
-	if(MaxLeaf < 0x16)
+	if(info->max_leaf < 0xA)
 		return;
 
+	cpu_pmu_t* pmu = &info->pmu;
 	uint32_t eax, ebx, ecx, edx;
 
-	// get frequencies informations
-	CPUID(0x16, eax, ebx, ecx, edx);
+	LEAF(info, 0xA, 0x0, eax, ebx, ecx, edx);
+
+	pmu->version = eax & 0xFF;
+
+	if(pmu->version == 0)
+		return;
+
+	pmu->counters = (eax >> 8) & 0xFF;
+	pmu->counter_width = (eax >> 16) & 0xFF;
+
+	// a set ebx bit marks an event as not available, only the bits within the vector length are valid
+	uint32_t length = (eax >> 24) & 0xFF;
+	uint32_t valid = (length >= PMU_EVENTS) ? (1u << PMU_EVENTS) - 1 : (1u << length) - 1;
+
+	pmu->events = ~ebx & valid;
 
-	if(eax != 0)
-		printf("Cpu base frequency: %f GHz\n", (float)eax / 1000.0f);
+	// the fixed counters are enumerated from version 2, version 5 also reports a mask of the supported ones
+	if(pmu->version < 2)
+		return;
+
+	pmu->fixed_counters = edx & 0x1F;
+	pmu->fixed_width = (edx >> 5) & 0xFF;
+	pmu->fixed_mask = (1u << pmu->fixed_counters) - 1;
+
+	if(pmu->version >= 5)
+		pmu->fixed_mask |= ecx;
+}
 
-	if(ebx != 0)
-		printf("Cpu maximum frequency: %f GHz\n", (float)ebx / 1000.0f);
+static void frequencies(archinfo_t* info)
+{
+	// check the maximum cpuid leaf
+	if(info->max_leaf < 0x16)
+		return;
 
-	if(ecx != 0)
-		printf("Bus (reference) frequency: %f MHz\n", (float)ecx);
+	uint32_t edx;
 
-	printf("\n");
+	// get frequencies informations
+	LEAF(info, 0x16, 0x0, info->frequencies.base, info->frequencies.max, info->frequencies.bus, edx);
 }
 
-void single_core_topology()
+static void tsc(archinfo_t* info)
 {
-	// print the number of cores and the number of threads
-	printf("Cores: %u\n", 1);
-	printf("Threads: %u\n\n", 1);
+	uint32_t eax, ebx, ecx, edx;
+
+	// the invariant tsc bit of the advanced power management leaf
+	if(info->max_ext_leaf >= 0x80000007)
+	{
+		LEAF(info, 0x80000007, 0x0, eax, ebx, ecx, edx);
+
+		info->tsc.invariant = (edx >> 8) & 1;
+	}
 
 	// check the maximum cpuid leaf
-	if(MaxLeaf < 0x4)
+	if(info->max_leaf < 0x15)
 		return;
 
-	uint32_t subleaf = 0;
-	cpu_cache_t cache;
+	// get the tsc to crystal clock ratio and the crystal frequency
+	LEAF(info, 0x15, 0x0, info->tsc.denominator, info->tsc.numerator, info->tsc.crystal, edx);
 
-	// retrieve informations about every cache
-	while(cache_info(&cache, subleaf))
+	if(info->tsc.numerator == 0 || info->tsc.denominator == 0)
+		return;
+
+	// the crystal frequency is not enumerated by some cpus, their tsc runs at the base frequency
+	if(info->tsc.crystal != 0)
+		info->tsc.frequency = (uint64_t)info->tsc.crystal * info->tsc.numerator / info->tsc.denominator;
+	else if(info->frequencies.base != 0)
+		info->tsc.frequency = (uint64_t)info->frequencies.base * 1000000;
+}
+
+static int extended_topology(archinfo_t* info, uint32_t leaf)
+{
+	// the shift of an amd level gives the id of its own units, the complex and the die are placed at the tile and die levels
+	static const uint32_t AmdLevels[] = { 0, TOPOLOGY_CORE, TOPOLOGY_TILE, TOPOLOGY_DIE, TOPOLOGY_LEVELS };
+
+	cpu_topology_t* topology = &info->topology;
+	uint32_t eax, ebx, ecx, edx;
+
+	// check the maximum cpuid leaf
+	if(((leaf & 0x80000000) ? info->max_ext_leaf : info->max_leaf) < leaf)
+		return 0;
+
+	// check if the leaf is implemented
+	LEAF(info, leaf, 0x0, eax, ebx, ecx, edx);
+
+	if(ebx == 0)
+		return 0;
+
+	// the shift reported by a level gives the id of the unit of the next level
+	uint32_t shifts[TOPOLOGY_LEVELS + 1] = { 0 };
+	uint32_t reported = 0;
+
+	for(uint32_t subleaf = 0; subleaf < 16; ++subleaf)
 	{
-		// print the cache informations
-		print_cache_info(cache);
+		LEAF(info, leaf, subleaf, eax, ebx, ecx, edx);
+
+		uint32_t type = (ecx >> 8) & 0xFF;
+
+		// the first invalid level ends the enumeration
+		if(type == 0)
+			break;
+
+		if(leaf == 0x80000026)
+			type = (type < 5) ? AmdLevels[type] : TOPOLOGY_LEVELS + 1;
+
+		if(type <= TOPOLOGY_LEVELS)
+		{
+			shifts[type] = eax & 0x1F;
+			reported |= 1 << type;
+		}
 
-		subleaf++;
+		// the last level gives the package id
+		topology->pkg_shift = eax & 0x1F;
 	}
+
+	// the levels that are not enumerated span the same units as the level below
+	for(uint32_t level = TOPOLOGY_CORE; level < TOPOLOGY_LEVELS; ++level)
+		topology->shifts[level] = (reported & (1 << level)) ? shifts[level] : topology->shifts[level - 1];
+
+	topology->leaf = leaf;
+
+	return 1;
 }
 
-void multi_core_topology()
+static void legacy_topology(archinfo_t* info)
 {
+	cpu_topology_t* topology = &info->topology;
 	uint32_t eax, ebx, ecx, edx;
 
 	// get the maximum number of logical processors
-	CPUID(0x1, eax, ebx, ecx, edx);
-	uint32_t max_logical_proc = (ebx >> 16) & 0xFF;
+	LEAF(info, 0x1, 0x0, eax, ebx, ecx, edx);
+	uint32_t max_logical_proc = info->features.edx.htt ? (ebx >> 16) & 0xFF : 1;
 
 	// get the maximum number of physical processors
-	CPUID_EXT(0x4, 0x0, eax, ebx, ecx, edx);
-	uint32_t max_physical_proc = (eax >> 26) + 1;
+	uint32_t max_physical_proc = 1;
+
+	if(info->max_leaf >= 0x4)
+	{
+		LEAF(info, 0x4, 0x0, eax, ebx, ecx, edx);
+		max_physical_proc = (eax >> 26) + 1;
+	}
 
-	// calculate the mask of the smt sub id
-	uint32_t smt_mask_width = fast_log2(round_next_pow2(max_logical_proc) / max_physical_proc);
-	uint32_t smt_mask = ~((-1) << smt_mask_width);
+	// calculate the width of the smt sub id
+	uint32_t smt_per_core = round_next_pow2(max_logical_proc) / max_physical_proc;
+	uint32_t smt_mask_width = (smt_per_core > 1) ? fast_log2(smt_per_core) : 0;
 
-	// calculate the mask of the core sub id
+	// calculate the width of the core sub id
 	uint32_t core_mask_width = fast_log2(max_physical_proc);
-	uint32_t core_mask = (~((-1) << (core_mask_width + smt_mask_width))) ^ smt_mask;
 
-	uint32_t threads_cnt;
-	uint32_t apic_ids[256];
+	topology->shifts[TOPOLOGY_CORE] = smt_mask_width;
 
-#if   defined(_WIN32)
-	// get the number of logical processors
-	SYSTEM_INFO sysinfo;
-	GetSystemInfo(&sysinfo);
-	threads_cnt = sysinfo.dwNumberOfProcessors;
+	for(uint32_t level = TOPOLOGY_MODULE; level < TOPOLOGY_LEVELS; ++level)
+		topology->shifts[level] = smt_mask_width + core_mask_width;
 
-	// get the main thread handle
-	HANDLE thread = GetCurrentThread();
+	topology->pkg_shift = smt_mask_width + core_mask_width;
 
-	// save the previous affinity mask
-	DWORD_PTR prev_affinity_mask = SetThreadAffinityMask(thread, 1);
+	topology->leaf = 0x4;
+}
+
+static void legacy_topology_amd(archinfo_t* info)
+{
+	cpu_topology_t* topology = &info->topology;
+	uint32_t eax, ebx, ecx, edx;
+
+	if(info->max_ext_leaf < 0x80000008)
+		return;
 
-	// get the first apic id
-	apic_ids[0] = apic_id();
+	// get the width of the core and thread part of the apic id, or derive it from the number of logical processors
+	LEAF(info, 0x80000008, 0x0, eax, ebx, ecx, edx);
 
-	// for each logical processor get the apic id
-	for(uint32_t i = 1; i < threads_cnt; ++i)
+	uint32_t core_mask_width = (ecx >> 12) & 0xF;
+
+	if(core_mask_width == 0)
+		core_mask_width = fast_log2(round_next_pow2((ecx & 0xFF) + 1));
+
+	// get the threads of a core
+	uint32_t smt_mask_width = 0;
+
+	if(topology_extensions(info))
 	{
-		// set the affinity to a logical processor
-		SetThreadAffinityMask(thread, 1 << i);
+		LEAF(info, 0x8000001E, 0x0, eax, ebx, ecx, edx);
+		smt_mask_width = fast_log2(round_next_pow2(((ebx >> 8) & 0xFF) + 1));
+	}
+
+	topology->shifts[TOPOLOGY_CORE] = smt_mask_width;
+
+	for(uint32_t level = TOPOLOGY_MODULE; level < TOPOLOGY_LEVELS; ++level)
+		topology->shifts[level] = core_mask_width;
+
+	topology->pkg_shift = core_mask_width;
 
-		// get the apic id
-		apic_ids[i] = apic_id();
+	topology->leaf = 0x80000008;
+}
+
+static void topology(archinfo_t* info, uint32_t flags)
+{
+	cpu_topology_t* topology = &info->topology;
+
+	// derive the level shifts from the extended topology leaves, then from the legacy ones
+	if(info->vendor_num == VENDOR_AMD)
+	{
+		if(!extended_topology(info, 0x80000026) && !extended_topology(info, 0xB))
+			legacy_topology_amd(info);
 	}
+	else if(!extended_topology(info, 0x1F) && !extended_topology(info, 0xB))
+		legacy_topology(info);
 
-	// set the previous affinity mask
-	SetThreadAffinityMask(thread, prev_affinity_mask);
-#elif defined(__linux__)
-	// get the number of logical processors
-	threads_cnt = sysconf(_SC_NPROCESSORS_ONLN);
-		
-	// get the main thread handle
-	pthread_t thread = pthread_self();
+	// calculate the package mask
+	topology->pkg_mask = (uint32_t)(((uint64_t)1 << topology->pkg_shift) - 1);
 
-	// save the previous affinity
-	cpu_set_t prev_cpu_set;
-	pthread_getaffinity_np(thread, sizeof(cpu_set_t), &prev_cpu_set);
+	// get the apic id of every logical processor
+	uint32_t threads_cnt = 0;
+	cpu_logical_t* cpus = (info->dump == NULL) ? percpu_collect(&threads_cnt, flags) : percpu_replay(info->dump, &threads_cnt);
 
-	// for each logical procesor get the apic id
-	for(uint32_t i = 0; i < threads_cnt; ++i)
+	uint32_t* cores_ids = calloc(threads_cnt + 1, sizeof(uint32_t));
+	uint32_t* packages_ids = calloc(threads_cnt + 1, sizeof(uint32_t));
+
+	if(cpus == NULL || cores_ids == NULL || packages_ids == NULL)
 	{
-		// set the affinity to a logical processor
-		cpu_set_t cpu_set;
-		CPU_ZERO(&cpu_set);
-		CPU_SET(i, &cpu_set);
-		pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpu_set);
+		free(cpus);
+		free(cores_ids);
+		free(packages_ids);
 
-		// get the apic id
-		apic_ids[i] = apic_id();
+		return;
 	}
 
-	// set the previous affinity
-	pthread_setaffinity_np(thread, sizeof(cpu_set_t), &prev_cpu_set);
-#endif
-
-	uint32_t cores_ids[256];
 	uint32_t cores_cnt = 0;
+	uint32_t packages_cnt = 0;
 
-	// find the number of cores
 	for(uint32_t i = 0; i < threads_cnt; ++i)
 	{
-		// calculate the core id
-		uint32_t core_id = (apic_ids[i] & core_mask) >> smt_mask_width;
+		cpu_logical_t* cpu = &cpus[i];
+
+		// calculate the ids of the core, the die and the package
+		cpu->core_id = cpu->apic_id >> topology->shifts[TOPOLOGY_CORE];
+		cpu->die_id = cpu->apic_id >> topology->shifts[TOPOLOGY_DIE];
+		cpu->package_id = cpu->apic_id >> topology->pkg_shift;
 
 		// check for already found core ids
-		if(find(cores_ids, cores_cnt, core_id) == cores_cnt)
+		if(find(cores_ids, cores_cnt, cpu->core_id) == cores_cnt)
 		{
-			cores_ids[cores_cnt] = core_id;
+			cores_ids[cores_cnt] = cpu->core_id;
 
 			cores_cnt++;
 		}
-	}
 
-	// calculate the package mask
-	uint32_t pkg_mask = core_mask | smt_mask;
+		// check for already found package ids
+		if(find(packages_ids, packages_cnt, cpu->package_id) == packages_cnt)
+		{
+			packages_ids[packages_cnt] = cpu->package_id;
+
+			packages_cnt++;
+		}
+	}
 
-	cpu_cache_t cache;
-	uint32_t subleaf = 0;
+	free(packages_ids);
 
-	// unshared caches array
-	cpu_cache_t unshared_caches[8];
-	uint32_t unshared_caches_cnt = 0;
+	topology->cpus = cpus;
+	topology->cores_ids = cores_ids;
 
-	// shared caches array
-	cpu_cache_t shared_caches[8];
-	uint32_t shared_caches_cnt = 0;
+	topology->cores_cnt = cores_cnt;
+	topology->threads_cnt = threads_cnt;
+	topology->packages_cnt = packages_cnt;
 
 	// retrieve informations about every cache
-	while(cache_info(&cache, subleaf))
+	caches(info);
+
+	// summarize the core types of a hybrid cpu
+	core_types(info, flags);
+
+	// compare the feature registers of the logical processors
+	words_scan(info);
+}
+
+static void words_scan(archinfo_t* info)
+{
+	const cpu_topology_t* topology = &info->topology;
+
+	if(topology->cpus == NULL || topology->threads_cnt == 0)
+		return;
+
+	for(uint32_t w = 0; w < CPU_WORDS; ++w)
+		info->words_common[w] = 0xFFFFFFFF;
+
+	uint32_t majority = 0;
+
+	for(uint32_t i = 0; i < topology->threads_cnt; ++i)
 	{
-		// check if the cache is shared between all the cores
-		if(cache.mask == pkg_mask)
-		{
-			shared_caches[shared_caches_cnt] = cache;
+		const uint32_t* words = topology->cpus[i].words;
 
-			shared_caches_cnt++;
-		}
-		else
-		{
-			unshared_caches[unshared_caches_cnt] = cache;
+		for(uint32_t w = 0; w < CPU_WORDS; ++w)
+			info->words_common[w] &= words[w];
 
-			unshared_caches_cnt++;
-		}
+		// the logical processors reporting the same registers
+		uint32_t same = 0;
+
+		for(uint32_t j = 0; j < topology->threads_cnt; ++j)
+			same += memcmp(topology->cpus[j].words, words, sizeof(topology->cpus[j].words)) == 0;
 
-		subleaf++;
+		if(same > majority)
+			majority = same;
 	}
 
-	// print the number of cores and the number of threads
-	printf("Cores: %u\n", cores_cnt);
-	printf("Threads: %u\n\n", threads_cnt);
+	info->outliers_cnt = topology->threads_cnt - majority;
+}
 
-	// print the unshared caches of each core
-	for(uint32_t i = 0; i < cores_cnt; ++i)
+// read the level 1 data and level 2 cache sizes of a core type from its own leaf 4
+static void core_type_caches(cpu_core_type_t* type, const uint32_t regs[][4], uint32_t regs_cnt)
+{
+	for(uint32_t subleaf = 0; subleaf < regs_cnt; ++subleaf)
 	{
-		printf("Core #%u\n", cores_ids[i]);
+		const uint32_t* r = regs[subleaf];
+
+		uint32_t cache_type = r[0] & 0x1F;
+		uint32_t level = (r[0] >> 5) & 0x7;
+
+		// the first null cache ends the enumeration
+		if(cache_type == 0)
+			break;
+
+		uint32_t size = ((r[1] >> 22) + 1) * (((r[1] >> 12) & 0x3FF) + 1) * ((r[1] & 0xFFF) + 1) * (r[2] + 1);
 
-		for(uint32_t k = 0; k < unshared_caches_cnt; ++k)
-			printf("   Cache Level %u %s\n", unshared_caches[k].level, unshared_caches[k].type);
+		if(level == 1 && cache_type == 1)
+			type->l1d_size = size;
+		else if(level == 2 && cache_type != 2)
+			type->l2_size = size;
 	}
+}
+
+#define CORE_TYPE_SUBLEAVES 8
 
-	if(shared_caches_cnt != 0)
+static void core_type_leaves(cpu_logical_t* cpu, uint32_t index, void* arg)
+{
+	uint32_t (*regs)[CORE_TYPE_SUBLEAVES][4] = arg;
+
+	for(uint32_t subleaf = 0; subleaf < CORE_TYPE_SUBLEAVES; ++subleaf)
+		CPUID_EXT(0x4, subleaf, regs[index][subleaf][0], regs[index][subleaf][1], regs[index][subleaf][2], regs[index][subleaf][3]);
+}
+
+static void core_types(archinfo_t* info, uint32_t flags)
+{
+	const cpu_topology_t* topology = &info->topology;
+
+	if(!info->hybrid || topology->cpus == NULL)
+		return;
+
+	cpu_logical_t firsts[CORE_TYPES];
+	uint32_t indices[CORE_TYPES];
+
+	// the types in CORE_TYPE_* order, performance cores first
+	for(uint32_t type = CORE_TYPE_PERFORMANCE; type < CORE_TYPES; ++type)
 	{
-		printf("\nShared Caches:\n");
+		cpu_core_type_t* summary = &info->core_types[info->core_types_cnt];
+
+		for(uint32_t i = 0; i < topology->threads_cnt; ++i)
+		{
+			const cpu_logical_t* cpu = &topology->cpus[i];
+
+			if(cpu->core_type != type)
+				continue;
+
+			if(summary->cpus_cnt == 0)
+			{
+				summary->type = type;
+				summary->native_model = cpu->native_model;
+				summary->cpu = cpu->cpu;
+
+				firsts[info->core_types_cnt] = *cpu;
+				indices[info->core_types_cnt] = i;
+			}
 
-		// print the shared caches
-		for(uint32_t k = 0; k < shared_caches_cnt; ++k)
-			printf("   Cache Level %u %s\n", shared_caches[k].level, shared_caches[k].type);
+			// count the first logical processor of every core
+			uint32_t j = 0;
+
+			while(j < i && !(topology->cpus[j].core_type == type && topology->cpus[j].core_id == cpu->core_id))
+				++j;
+
+			if(j == i)
+				summary->cores_cnt++;
+
+			summary->cpus_cnt++;
+		}
+
+		if(summary->cpus_cnt != 0)
+			info->core_types_cnt++;
 	}
 
-	printf("\n");
-		
-	// print the details of all the unshared caches
-	for(uint32_t i = 0; i < unshared_caches_cnt; ++i)
-		print_cache_info(unshared_caches[i]);
+	uint32_t regs[CORE_TYPES][CORE_TYPE_SUBLEAVES][4] = { { { 0 } } };
 
-	// print the details of all the shared caches
-	for(uint32_t i = 0; i < shared_caches_cnt; ++i)
-		print_cache_info(shared_caches[i]);
+	// leaf 4 of every type is read on its first logical processor, or on its cpu of the dump
+	if(info->max_leaf >= 0x4)
+	{
+		if(info->dump == NULL)
+			percpu_run(firsts, info->core_types_cnt, flags, core_type_leaves, regs);
+		else
+			for(uint32_t t = 0; t < info->core_types_cnt; ++t)
+				for(uint32_t subleaf = 0; subleaf < CORE_TYPE_SUBLEAVES; ++subleaf)
+					dump_leaf(info->dump, indices[t], 0x4, subleaf, regs[t][subleaf]);
+	}
+
+	for(uint32_t t = 0; t < info->core_types_cnt; ++t)
+		core_type_caches(&info->core_types[t], (const uint32_t (*)[4])regs[t], CORE_TYPE_SUBLEAVES);
 }
 
-void cache_tlb()
+const cpu_core_type_t* archinfo_core_type(const archinfo_t* info, uint32_t type)
+{
+	for(uint32_t t = 0; t < info->core_types_cnt; ++t)
+		if(info->core_types[t].type == type)
+			return &info->core_types[t];
+
+	return NULL;
+}
+
+static void cache_tlb(archinfo_t* info)
 {
 	// check the maximum cpuid leaf
-	if(MaxLeaf < 0x2)
+	if(info->max_leaf < 0x2)
 		return;
 
 	uint32_t eax, ebx, ecx, edx;
 
 	// get cache and tlb informations
-	CPUID(0x2, eax, ebx, ecx, edx);
-
-	printf("Cache and TLB informations:\n");
+	LEAF(info, 0x2, 0x0, eax, ebx, ecx, edx);
 
 	if(~eax & 0x80000000)
-		print_cache_tlb_info(eax >> 8);
+		cache_tlb_descriptors(info, eax >> 8);
 
 	if(~ebx & 0x80000000)
-		print_cache_tlb_info(ebx);
-	
+		cache_tlb_descriptors(info, ebx);
+
 	if(~ecx & 0x80000000)
-		print_cache_tlb_info(ecx);
+		cache_tlb_descriptors(info, ecx);
 
 	if(~edx & 0x80000000)
-		print_cache_tlb_info(edx);
+		cache_tlb_descriptors(info, edx);
+}
+
+static void tlbs(archinfo_t* info)
+{
+	// check the maximum cpuid leaf
+	if(info->max_leaf < 0x18)
+		return;
 
-	printf("\n");
+	uint32_t eax, ebx, ecx, edx;
+	uint32_t max_subleaf;
+
+	// the subleaf 0 enumerates the maximum subleaf and may describe a tlb too
+	LEAF(info, 0x18, 0x0, max_subleaf, ebx, ecx, edx);
+
+	for(uint32_t subleaf = 0; subleaf <= max_subleaf && info->tlbs_cnt < MAX_TLBS; ++subleaf)
+	{
+		if(subleaf != 0)
+			LEAF(info, 0x18, subleaf, eax, ebx, ecx, edx);
+
+		// subleaves of null type are skipped, they do not end the enumeration
+		if((edx & 0x1F) == TLB_NULL || (edx & 0x1F) >= TLB_TYPES)
+			continue;
+
+		cpu_tlb_t* tlb = &info->tlbs[info->tlbs_cnt++];
+
+		tlb->type = edx & 0x1F;
+		tlb->level = (edx >> 5) & 0x7;
+		tlb->fully_associative = (edx >> 8) & 0x1;
+		tlb->sharing = ((edx >> 14) & 0xFFF) + 1;
+
+		tlb->pages = ebx & 0xF;
+		tlb->partitioning = (ebx >> 8) & 0x7;
+		tlb->ways = ebx >> 16;
+		tlb->sets = ecx;
+
+		tlb->entries = tlb->ways * tlb->sets;
+	}
 }
 
+uint64_t tlb_page_size(uint32_t page)
+{
+	switch(page)
+	{
+		case TLB_PAGE_4K: return 4ull << 10;
+		case TLB_PAGE_2M: return 2ull << 20;
+		case TLB_PAGE_4M: return 4ull << 20;
+		case TLB_PAGE_1G: return 1ull << 30;
+	}
+
+	return 0;
+}
+
+uint64_t archinfo_tlb_reach(const archinfo_t* info, uint32_t level, uint32_t page)
+{
+	uint64_t reach = 0;
+
+	// the data side tlbs, with the load tlb standing for the split load and store ones
+	for(uint32_t i = 0; i < info->tlbs_cnt; ++i)
+	{
+		const cpu_tlb_t* tlb = &info->tlbs[i];
+
+		if(tlb->type == TLB_INSTRUCTION || tlb->type == TLB_STORE)
+			continue;
+
+		if((level != 0 && tlb->level != level) || !(tlb->pages & page))
+			continue;
+
+		uint64_t covered = (uint64_t)tlb->entries * tlb_page_size(page);
+
+		if(covered > reach)
+			reach = covered;
+	}
+
+	return reach;
+}
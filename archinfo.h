@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 #define CPUID(leaf, a, b, c, d) \
@@ -34,6 +35,11 @@
 #define EBX_EXT_FEATURES_SIZE 30
 #define ECX_EXT_FEATURES_SIZE  6
 
+#define MAX_CACHES          8
+#define MAX_TLB_DESCRIPTORS 16
+#define MAX_TLBS            16
+#define XSAVE_COMPONENTS    32
+
 // cpu vendor id
 typedef union
 {
@@ -48,6 +54,16 @@ typedef union
 
 } cpu_vendor_t;
 
+// vendors with their own cache and topology leaves
+enum
+{
+	VENDOR_UNKNOWN,
+	VENDOR_INTEL,
+	VENDOR_AMD,
+
+	VENDORS
+};
+
 // cpu signature
 typedef union
 {
@@ -67,12 +83,24 @@ typedef union
 
 } cpu_signature_t;
 
+// physical instance of a cache and the logical processors sharing it
+typedef struct
+{
+	uint32_t id;
+	uint32_t die_id;
+	uint32_t package_id;
+
+	uint32_t cpus_cnt;
+	uint32_t* cpus;
+
+} cpu_cache_instance_t;
+
 // cpu cache
 typedef struct
 {
 	uint32_t level;
 	uint32_t size;
-	const char* type;
+	uint32_t type;
 	uint32_t mask;
 
 	unsigned line_size  : 12;
@@ -80,6 +108,14 @@ typedef struct
 	unsigned ways       : 10;
 	uint32_t sets;
 
+	// instances of the cache, the cpus of every instance are stored in a single array
+	uint32_t instances_cnt;
+	cpu_cache_instance_t* instances;
+	uint32_t* instances_cpus;
+
+	// set if an instance is shared by the logical processors of more than one core
+	uint32_t shared;
+
 } cpu_cache_t;
 
 // cpu features
@@ -268,315 +304,584 @@ typedef struct
 } feature_t;
 
 
-const char* CacheTypeStrings[4] =
+// raw cpuid leaves of every logical processor, see dump.h
+typedef struct cpuid_dump cpuid_dump_t;
+
+// cpu frequencies in MHz
+typedef struct
 {
-	NULL,
-	"Data",
-	"Instruction",
-	"Unified",
-};
+	uint32_t base;
+	uint32_t max;
+	uint32_t bus;
+
+} cpu_frequencies_t;
+
+// time stamp counter
+typedef struct
+{
+	// the counter runs at a constant rate in every P-, C- and T-state
+	uint32_t invariant;
+
+	// tsc to crystal clock ratio and crystal frequency in Hz
+	uint32_t numerator;
+	uint32_t denominator;
+	uint32_t crystal;
+
+	// tsc frequency in Hz, 0 if the cpuid leaves do not enumerate it
+	uint64_t frequency;
+
+} cpu_tsc_t;
 
-const feature_t EdxFeatures[EDX_FEATURES_SIZE] =
+// state component of the xsave area
+typedef struct
 {
-	{ "FPU",           (1 <<  0) },
-	{ "VME",           (1 <<  1) },
-	{ "DE",            (1 <<  2) },
-	{ "PSE",           (1 <<  3) },
-	{ "TSC",           (1 <<  4) },
-	{ "MSR",           (1 <<  5) },
-	{ "PAE",           (1 <<  6) },
-	{ "MCE",           (1 <<  7) },
-	{ "CX8",           (1 <<  8) },
-	{ "APIC",          (1 <<  9) },
-	{ "SEP",           (1 << 11) },
-	{ "MTRR",          (1 << 12) },
-	{ "PGE",           (1 << 13) },
-	{ "MCA",           (1 << 14) },
-	{ "CMOV",          (1 << 15) },
-	{ "PAT",           (1 << 16) },
-	{ "PSE-36",        (1 << 17) },
-	{ "PSN",           (1 << 18) },
-	{ "CLFSH",         (1 << 19) },
-	{ "DS",            (1 << 21) },
-	{ "ACPI",          (1 << 22) },
-	{ "MMX",           (1 << 23) },
-	{ "FXSR",          (1 << 24) },
-	{ "SSE",           (1 << 25) },
-	{ "SSE2",          (1 << 26) },
-	{ "SS",            (1 << 27) },
-	{ "HTT",           (1 << 28) },
-	{ "TM",            (1 << 29) },
-	{ "PBE",           (1 << 31) }
+	// size in bytes and offset in the standard format, the offset of supervisor components is 0
+	uint32_t size;
+	uint32_t offset;
+
+	// managed through IA32_XSS instead of xcr0
+	uint32_t supervisor;
+
+	// aligned to 64 bytes in the compacted format
+	uint32_t aligned;
+
+	// supports extended feature disable
+	uint32_t xfd;
+
+} cpu_xsave_component_t;
+
+// xsave features and state components of leaf 0xD
+typedef struct
+{
+	// components supported in xcr0 and in IA32_XSS
+	uint64_t supported;
+	uint64_t supported_xss;
+
+	// standard format size of the components enabled in xcr0 and of every supported component
+	uint32_t enabled_size;
+	uint32_t max_size;
+
+	// compacted format size of the components enabled in xcr0 and IA32_XSS
+	uint32_t compacted_size;
+
+	uint32_t xsaveopt;
+	uint32_t xsavec;
+	uint32_t xgetbv1;
+	uint32_t xsaves;
+	uint32_t xfd;
+
+	cpu_xsave_component_t components[XSAVE_COMPONENTS];
+
+} cpu_xsave_t;
+
+// cache allocation technology of a cache level
+typedef struct
+{
+	// length of the capacity bitmasks, 0 if the level cannot be partitioned
+	uint32_t cbm_length;
+
+	// ways also used by other agents of the system
+	uint32_t shared_mask;
+
+	// classes of service
+	uint32_t closids;
+
+	// code and data prioritization, noncontiguous masks
+	uint32_t cdp;
+	uint32_t noncontiguous;
+
+} cpu_rdt_cat_t;
+
+// resource director technology of leaves 0xF and 0x10
+typedef struct
+{
+	// l3 monitoring: resource monitoring ids, bytes per counter unit and counter width
+	uint32_t rmids;
+	uint32_t upscaling;
+	uint32_t counter_width;
+
+	// occupancy, total and local bandwidth monitoring
+	uint32_t llc_occupancy;
+	uint32_t mbm_total;
+	uint32_t mbm_local;
+
+	cpu_rdt_cat_t l3;
+	cpu_rdt_cat_t l2;
+
+	// memory bandwidth allocation: maximum throttling value, linear delay scale and classes of service
+	uint32_t mba_max;
+	uint32_t mba_linear;
+	uint32_t mba_closids;
+
+} cpu_rdt_t;
+
+// architectural events of the performance monitoring leaf 0xA, in the order of its ebx bits
+enum
+{
+	PMU_EVENT_CYCLES,
+	PMU_EVENT_INSTRUCTIONS,
+	PMU_EVENT_REF_CYCLES,
+	PMU_EVENT_LLC_REFERENCES,
+	PMU_EVENT_LLC_MISSES,
+	PMU_EVENT_BRANCHES,
+	PMU_EVENT_BRANCH_MISSES,
+	PMU_EVENT_TOPDOWN_SLOTS,
+
+	PMU_EVENTS
 };
 
-const feature_t EcxFeatures[ECX_FEATURES_SIZE] =
+// performance monitoring counters of leaf 0xA, or of the amd leaves 0x80000001 and 0x80000022
+typedef struct
+{
+	// architectural performance monitoring version, 0 on amd cpus
+	uint32_t version;
+
+	// general-purpose counters of a logical processor and their width in bits
+	uint32_t counters;
+	uint32_t counter_width;
+
+	// fixed-function counters, their width and the mask of the supported ones
+	uint32_t fixed_counters;
+	uint32_t fixed_width;
+	uint32_t fixed_mask;
+
+	// mask of the available PMU_EVENT_* architectural events
+	uint32_t events;
+
+} cpu_pmu_t;
+
+// page sizes a tlb translates
+#define TLB_PAGE_4K 0x1
+#define TLB_PAGE_2M 0x2
+#define TLB_PAGE_4M 0x4
+#define TLB_PAGE_1G 0x8
+
+#define TLB_PAGE_SIZES 4
+
+// translation cache types of leaf 0x18
+enum
 {
-	{ "SSE3",          (1 <<  0) },
-	{ "PCLMULQDQ",     (1 <<  1) },
-	{ "DTES64",        (1 <<  2) },
-	{ "MONITOR",       (1 <<  3) },
-	{ "DS-CPL",        (1 <<  4) },
-	{ "VMX",           (1 <<  5) },
-	{ "SMX",           (1 <<  6) },
-	{ "EIST",          (1 <<  7) },
-	{ "TM2",           (1 <<  8) },
-	{ "SSSE3",         (1 <<  9) },
-	{ "CNXT-ID",       (1 << 10) },
-	{ "SDBG",          (1 << 11) },
-	{ "FMA",           (1 << 12) },
-	{ "CMPXCHG16B",    (1 << 13) },
-	{ "XTPR",          (1 << 14) },
-	{ "PDCM",          (1 << 15) },
-	{ "PCID",          (1 << 17) },
-	{ "DCA",           (1 << 18) },
-	{ "SSE4.1",        (1 << 19) },
-	{ "SSE4.2",        (1 << 20) },
-	{ "X2APIC",        (1 << 21) },
-	{ "MOVBE",         (1 << 22) },
-	{ "POPCNT",        (1 << 23) },
-	{ "TSC-DEADLINE",  (1 << 24) },
-	{ "AESNI",         (1 << 25) },
-	{ "XSAVE",         (1 << 26) },
-	{ "OSXSAVE",       (1 << 27) },
-	{ "AVX",           (1 << 28) },
-	{ "F16C",          (1 << 29) },
-	{ "RDRND",         (1 << 30) },
+	TLB_NULL,
+	TLB_DATA,
+	TLB_INSTRUCTION,
+	TLB_UNIFIED,
+	TLB_LOAD,
+	TLB_STORE,
+
+	TLB_TYPES
 };
 
-const feature_t EbxExtFeatures[EBX_EXT_FEATURES_SIZE] =
+// deterministic tlb parameters of leaf 0x18
+typedef struct
 {
-	{ "FSGSBASE",      (1 <<  0) },
-	{ "IA32-TSC-ADJ",  (1 <<  1) },
-	{ "SGX",           (1 <<  2) },
-	{ "BMI1",          (1 <<  3) },
-	{ "HLE",           (1 <<  4) },
-	{ "AVX2",          (1 <<  5) },
-	{ "FDP-EXCP",      (1 <<  6) },
-	{ "SMEP",          (1 <<  7) },
-	{ "BMI2",          (1 <<  8) },
-	{ "ENHANCED-RMS",  (1 <<  9) },
-	{ "INVPCID",       (1 << 10) },
-	{ "RTM",           (1 << 11) },
-	{ "RDT-M",         (1 << 12) },
-	{ "DEPR-FCSDS",    (1 << 13) },
-	{ "MPX",           (1 << 14) },
-	{ "RDT-A",         (1 << 15) },
-	{ "AVX512F",       (1 << 16) },
-	{ "AVX512DQ",      (1 << 17) },
-	{ "RDSEED",        (1 << 18) },
-	{ "ADX",           (1 << 19) },
-	{ "SMAP",          (1 << 20) },
-	{ "CLFLUSHOPT",    (1 << 23) },
-	{ "CLWB",          (1 << 24) },
-	{ "INTEL-PTRACE",  (1 << 25) },
-	{ "AVX512PF",      (1 << 26) },
-	{ "AVX512ER",      (1 << 27) },
-	{ "AVX512CD",      (1 << 28) },
-	{ "SHA",           (1 << 29) },
-	{ "AVX512BW",      (1 << 30) },
-	{ "AVX512VL",      (1 << 31) }
+	uint32_t level;
+	uint32_t type;
+
+	// TLB_PAGE_* sizes translated by the entries
+	uint32_t pages;
+
+	uint32_t entries;
+	uint32_t ways;
+	uint32_t sets;
+	uint32_t fully_associative;
+
+	// 0 if the entries are shared by the logical processors, otherwise the partitioning scheme
+	uint32_t partitioning;
+
+	// maximum number of logical processors sharing the tlb
+	uint32_t sharing;
+
+} cpu_tlb_t;
+
+// topology levels enumerated by the extended topology leaves
+enum
+{
+	TOPOLOGY_SMT,
+	TOPOLOGY_CORE,
+	TOPOLOGY_MODULE,
+	TOPOLOGY_TILE,
+	TOPOLOGY_DIE,
+
+	TOPOLOGY_LEVELS
 };
 
-const feature_t EcxExtFeatures[ECX_EXT_FEATURES_SIZE] =
+// core types of the hybrid leaf 0x1A, every logical processor of a non hybrid cpu is CORE_TYPE_NONE
+enum
 {
-	{ "PREFETCHWT1",   (1 <<  0) },
-	{ "UMIP",          (1 <<  2) },
-	{ "PKU",           (1 <<  3) },
-	{ "OSPKE",         (1 <<  4) },
-	{ "RPID",          (1 << 22) },
-	{ "SGX-LC",        (1 << 30) }
+	CORE_TYPE_NONE,
+	CORE_TYPE_PERFORMANCE,
+	CORE_TYPE_EFFICIENT,
+
+	CORE_TYPES
 };
 
-const char* BrandStrings[256] =
+// feature registers read on every logical processor, compared by the heterogeneity scan
+enum
 {
-	"<Unknow>",
-	"Intel(R) Celeron(R) processor",
-	"Intel(R) Pentium(R) III processor",
-	"Intel(R) Pentium(R) III Xeon(R) processor",
-	"Intel(R) Pentium(R) III processor",
-	"<Unknow>",
-	"Mobile Intel(R) Pentium(R) III processor-M",
-	"Mobile Intel(R) Celeron(R) processor",
-	"Intel(R) Pentium(R) 4 processor",
-	"Intel(R) Pentium(R) 4 processor",
-	"Intel(R) Celeron(R) processor",
-	"Intel(R) Xeon(R) processor",
-	"Intel(R) Xeon(R) processor MP",
-	"<Unknow>",
-	"Mobile Intel(R) Pentium(R) 4 processor-M",
-	"Intel(R) Celeron(R) processor",
-	"<Unknow>",
-	"Mobile Genuine Intel(R) processor",
-	"Intel(R) Celeron(R) M processor",
-	"Mobile Intel(R) Celeron(R) processor",
-	"Intel(R) Celeron(R) processor",
-	"Mobile Genuine Intel(R) processor",
-	"Intel(R) Pentium(R) M processor",
-	"Mobile Intel(R) Celeron(R) processor",
-	"<Unknow>"
+	CPU_WORD_1_EDX,
+	CPU_WORD_1_ECX,
+	CPU_WORD_7_EBX,
+	CPU_WORD_7_ECX,
+	CPU_WORD_7_EDX,
+
+	// xsave state components of leaf 0xD subleaf 0 and extensions of subleaf 1
+	CPU_WORD_D_EAX,
+	CPU_WORD_D_EDX,
+	CPU_WORD_D1_EAX,
+
+	CPU_WORDS
 };
 
-const char* CacheTlbDescriptors[256] =
+// per-cpu cpuid data of a logical processor
+typedef struct
+{
+	uint32_t cpu;
+	uint32_t apic_id;
+
+	// CORE_TYPE_* and model id of the core within its type
+	uint32_t core_type;
+	uint32_t native_model;
+
+	// raw CPU_WORD_* feature registers
+	uint32_t words[CPU_WORDS];
+
+	uint32_t core_id;
+	uint32_t die_id;
+	uint32_t package_id;
+
+	// index of the instance of every cache the logical processor belongs to
+	uint32_t cache_instances[MAX_CACHES];
+
+} cpu_logical_t;
+
+// logical processors, cores and private caches of a core type
+typedef struct
+{
+	uint32_t type;
+	uint32_t native_model;
+
+	uint32_t cpus_cnt;
+	uint32_t cores_cnt;
+
+	// first logical processor of the type, the leaves of the type are read on it
+	uint32_t cpu;
+
+	// sizes in bytes of the level 1 data and level 2 caches of the type, leaf 4 differs between the types
+	uint32_t l1d_size;
+	uint32_t l2_size;
+
+} cpu_core_type_t;
+
+// cpu topology
+typedef struct
+{
+	uint32_t cores_cnt;
+	uint32_t threads_cnt;
+	uint32_t packages_cnt;
+
+	// cpuid leaf the topology is derived from: 0x1F, 0xB or 0x80000026, otherwise 0x4 or 0x80000008 for the legacy leaves
+	// the core complexes of an amd cpu are the tile level and its core complex dies the die level
+	uint32_t leaf;
+
+	// x2apic id shifts giving the id of the unit of each level and of the package
+	uint32_t shifts[TOPOLOGY_LEVELS];
+	uint32_t pkg_shift;
+	uint32_t pkg_mask;
+
+	// logical processors and unique core ids, allocated by archinfo_query()
+	cpu_logical_t* cpus;
+	uint32_t* cores_ids;
+
+} cpu_topology_t;
+
+// cpu informations snapshot
+typedef struct
+{
+	uint32_t max_leaf;
+	uint32_t max_ext_leaf;
+	uint64_t xcr0;
+
+	cpu_vendor_t vendor;
+	uint32_t vendor_num;
+	char brand[49];
+
+	cpu_signature_t signature;
+	uint32_t family_num;
+	uint32_t model_num;
+
+	cpu_features_t features;
+	cpu_features_ext_t features_ext;
+
+	// the logical processors are of different core types, leaf 7 edx bit 15
+	uint32_t hybrid;
+
+	// CPU_WORD_* registers every logical processor reports, and the logical processors that differ from the most common ones
+	uint32_t words_common[CPU_WORDS];
+	uint32_t outliers_cnt;
+
+	cpu_xsave_t xsave;
+
+	cpu_rdt_t rdt;
+
+	cpu_pmu_t pmu;
+
+	cpu_frequencies_t frequencies;
+	cpu_tsc_t tsc;
+
+	cpu_topology_t topology;
+
+	cpu_cache_t caches[MAX_CACHES];
+	uint32_t caches_cnt;
+
+	// core types of a hybrid cpu, performance cores first
+	cpu_core_type_t core_types[CORE_TYPES];
+	uint32_t core_types_cnt;
+
+	uint8_t tlb_descriptors[MAX_TLB_DESCRIPTORS];
+	uint32_t tlb_descriptors_cnt;
+
+	// tlbs enumerated by leaf 0x18, leaf 2 only points to it on recent cpus
+	cpu_tlb_t tlbs[MAX_TLBS];
+	uint32_t tlbs_cnt;
+
+	// dump the snapshot was replayed from, NULL if it was read from the cpu
+	const cpuid_dump_t* dump;
+
+	// read-only mapping of the snapshot cache the arrays point into, NULL if they are allocated
+	void* mapping;
+	size_t mapping_size;
+
+} archinfo_t;
+
+
+// feature registers published by the lazy feature query
+enum
 {
-// 0x00
-	NULL,
-	"Instruction TLB: 4 KByte pages, 4-way set associative, 32 entries",
-	"Instruction TLB: 4 MByte pages, fully associative, 2 entries",
-	"Data TLB: 4 KByte pages, 4-way set associative, 64 entries",
-	"Data TLB: 4 MByte pages, 4-way set associative, 8 entries",
-	"Data TLB1: 4 MByte pages, 4-way set associative, 32 entries",
-	"1st-level instruction cache: 8 KBytes, 4-way set associative, 32 byte line size",
-	"1st-level instruction cache: 16 KBytes, 4-way set associative, 32 byte line size",
-	"1st-level instruction cache: 32KBytes, 4-way set associative, 64 byte line size",
-	"1st-level data cache: 8 KBytes, 2-way set associative, 32 byte line size",
-	"Instruction TLB: 4 MByte pages, 4-way set associative, 4 entries",
-	"1st-level data cache: 16 KBytes, 4-way set associative, 32 byte line size",
-	"1st-level data cache: 16 KBytes, 4-way set associative, 64 byte line size",
-	"1st-level data cache: 24 KBytes, 6-way set associative, 64 byte line size",
-	NULL, NULL,
-// 0x10
-	NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-	"2nd-level cache: 128 KBytes, 2-way set associative, 64 byte line size",
-	NULL, NULL,
-// 0x20
-	NULL,
-	"2nd-level cache: 256 KBytes, 8-way set associative, 64 byte line size",
-	"3rd-level cache: 512 KBytes, 4-way set associative, 64 byte line size, 2 lines per sector",
-	"3rd-level cache: 1 MBytes, 8-way set associative, 64 byte line size, 2 lines per sector",
-	"2nd-level cache: 1 MBytes, 16-way set associative, 64 byte line size",
-	"3rd-level cache: 2 MBytes, 8-way set associative, 64 byte line size, 2 lines per sector",
-	NULL, NULL, NULL,
-	"3rd-level cache: 4 MBytes, 8-way set associative, 64 byte line size, 2 lines per sector",
-	NULL, NULL,
-	"1st-level data cache: 32 KBytes, 8-way set associative, 64 byte line size",
-	NULL, NULL, NULL,
-// 0x30
-	"1st-level instruction cache: 32 KBytes, 8-way set associative, 64 byte line size",
-	NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-// 0x40
-	"2nd-level cache or, if processor contains a valid 2nd-level cache, no 3rd-level cache",
-	"2nd-level cache: 128 KBytes, 4-way set associative, 32 byte line size",
-	"2nd-level cache: 256 KBytes, 4-way set associative, 32 byte line size",
-	"2nd-level cache: 512 KBytes, 4-way set associative, 32 byte line size",
-	"2nd-level cache: 1 MByte, 4-way set associative, 32 byte line size",
-	"2nd-level cache: 2 MByte, 4-way set associative, 32 byte line size",
-	"3rd-level cache: 4 MByte, 4-way set associative, 64 byte line size",
-	"3rd-level cache: 8 MByte, 8-way set associative, 64 byte line size",
-	"2nd-level cache: 3MByte, 12-way set associative, 64 byte line size",
-	"3rd-level cache: 4MB, 16-way set associative, 64-byte line size (Intel Xeon processor MP, Family 0FH, Model 06H); 2nd-level cache: 4 MByte, 16-way set associative, 64 byte line size",
-	"3rd-level cache: 6MByte, 12-way set associative, 64 byte line size",
-	"3rd-level cache: 8MByte, 16-way set associative, 64 byte line size",
-	"3rd-level cache: 12MByte, 12-way set associative, 64 byte line size",
-	"3rd-level cache: 16MByte, 16-way set associative, 64 byte line size",
-	"2nd-level cache: 6MByte, 24-way set associative, 64 byte line size",
-	"Instruction TLB: 4 KByte pages, 32 entries",
-// 0x50
-	"Instruction TLB: 4 KByte and 2-MByte or 4-MByte pages, 64 entries",
-	"Instruction TLB: 4 KByte and 2-MByte or 4-MByte pages, 128 entries",
-	"Instruction TLB: 4 KByte and 2-MByte or 4-MByte pages, 256 entries",
-	NULL, NULL,
-	"Instruction TLB: 2-MByte or 4-MByte pages, fully associative, 7 entries",
-	"Data TLB0: 4 MByte pages, 4-way set associative, 16 entries",
-	"Data TLB0: 4 KByte pages, 4-way associative, 16 entries",
-	NULL,
-	"Data TLB0: 4 KByte pages, fully associative, 16 entries",
-	"Data TLB0: 2 MByte or 4 MByte pages, 4-way set associative, 32 entries",
-	"Data TLB: 4 KByte and 4 MByte pages, 64 entries",
-	"Data TLB: 4 KByte and 4 MByte pages,128 entries",
-	"Data TLB: 4 KByte and 4 MByte pages,256 entries",
-	NULL, NULL,
-// 0x60
-	"1st-level data cache: 16 KByte, 8-way set associative, 64 byte line size",
-	"Instruction TLB: 4 KByte pages, fully associative, 48 entries",
-	NULL,
-	"Data TLB: 2 MByte or 4 MByte pages, 4-way set associative, 32 entries and a separate array with 1 GByte pages, 4-way set associative, 4 entries",
-	"Data TLB: 4 KByte pages, 4-way set associative, 512 entries",
-	NULL,
-	"1st-level data cache: 8 KByte, 4-way set associative, 64 byte line size",
-	"1st-level data cache: 16 KByte, 4-way set associative, 64 byte line size",
-	"1st-level data cache: 32 KByte, 4-way set associative, 64 byte line size",
-	NULL,
-	"uTLB: 4 KByte pages, 8-way set associative, 64 entries",
-	"DTLB: 4 KByte pages, 8-way set associative, 256 entries",
-	"DTLB: 2M/4M pages, 8-way set associative, 128 entries",
-	"DTLB: 1 GByte pages, fully associative, 16 entries",
-	NULL, NULL,
-// 0x70
-	"Trace cache: 12 K-μop, 8-way set associative",
-	"Trace cache: 16 K-μop, 8-way set associative",
-	"Trace cache: 32 K-μop, 8-way set associative",
-	NULL, NULL, NULL,
-	"Instruction TLB: 2M/4M pages, fully associative, 8 entries",
-	NULL,
-	"2nd-level cache: 1 MByte, 4-way set associative, 64byte line size",
-	"2nd-level cache: 128 KByte, 8-way set associative, 64 byte line size, 2 lines per sector",
-	"2nd-level cache: 256 KByte, 8-way set associative, 64 byte line size, 2 lines per sector",
-	"2nd-level cache: 512 KByte, 8-way set associative, 64 byte line size, 2 lines per sector",
-	"2nd-level cache: 1 MByte, 8-way set associative, 64 byte line size, 2 lines per sector",
-	"2nd-level cache: 2 MByte, 8-way set associative, 64byte line size",
-	NULL,
-	"2nd-level cache: 512 KByte, 2-way set associative, 64-byte line size",
-// 0x80
-	"2nd-level cache: 512 KByte, 8-way set associative, 64-byte line size",
-	NULL,
-	"2nd-level cache: 256 KByte, 8-way set associative, 32 byte line size",
-	"2nd-level cache: 512 KByte, 8-way set associative, 32 byte line size",
-	"2nd-level cache: 1 MByte, 8-way set associative, 32 byte line size",
-	"2nd-level cache: 2 MByte, 8-way set associative, 32 byte line size",
-	"2nd-level cache: 512 KByte, 4-way set associative, 64 byte line size",
-	"2nd-level cache: 1 MByte, 8-way set associative, 64 byte line size",
-	NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-// 0x90
-	NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-// 0xA0
-	"DTLB: 4k pages, fully associative, 32 entries",
-	NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-// 0xB0
-	"Instruction TLB: 4 KByte pages, 4-way set associative, 128 entries",
-	"Instruction TLB: 2M pages, 4-way, 8 entries or 4M pages, 4-way, 4 entries",
-	"Instruction TLB: 4KByte pages, 4-way set associative, 64 entries",
-	"Data TLB: 4 KByte pages, 4-way set associative, 128 entries",
-	"Data TLB1: 4 KByte pages, 4-way associative, 256 entries",
-	"Instruction TLB: 4KByte pages, 8-way set associative, 64 entries",
-	"Instruction TLB: 4KByte pages, 8-way set associative, 128 entries",
-	NULL, NULL, NULL,
-	"Data TLB1: 4 KByte pages, 4-way associative, 64 entries",
-	NULL, NULL, NULL, NULL, NULL,
-// 0xC0
-	"Data TLB: 4 KByte and 4 MByte pages, 4-way associative, 8 entries",
-	"Shared 2nd-Level TLB: 4 KByte/2MByte pages, 8-way associative, 1024 entries",
-	"DTLB: 4 KByte/2 MByte pages, 4-way associative, 16 entries",
-	"Shared 2nd-Level TLB: 4 KByte /2 MByte pages, 6-way associative, 1536 entries. Also 1GBbyte pages, 4-way, 16 entries.",
-	"DTLB: 2M/4M Byte pages, 4-way associative, 32 entries",
-	NULL, NULL, NULL, NULL, NULL,
-	"Shared 2nd-Level TLB: 4 KByte pages, 4-way associative, 512 entries",
-	NULL, NULL, NULL, NULL, NULL,
-// 0xD0
-	"3rd-level cache: 512 KByte, 4-way set associative, 64 byte line size",
-	"3rd-level cache: 1 MByte, 4-way set associative, 64 byte line size",
-	"3rd-level cache: 2 MByte, 4-way set associative, 64 byte line size",
-	NULL, NULL, NULL,
-	"3rd-level cache: 1 MByte, 8-way set associative, 64 byte line size",
-	"3rd-level cache: 2 MByte, 8-way set associative, 64 byte line size",
-	"3rd-level cache: 4 MByte, 8-way set associative, 64 byte line size",
-	NULL, NULL, NULL,
-	"3rd-level cache: 1.5 MByte, 12-way set associative, 64 byte line size",
-	"3rd-level cache: 3 MByte, 12-way set associative, 64 byte line size",
-	"3rd-level cache: 6 MByte, 12-way set associative, 64 byte line size",
-	NULL,
-// 0xE0
-	NULL, NULL,
-	"3rd-level cache: 2 MByte, 16-way set associative, 64 byte line size",
-	"3rd-level cache: 4 MByte, 16-way set associative, 64 byte line size",
-	"3rd-level cache: 8 MByte, 16-way set associative, 64 byte line size",
-	NULL, NULL, NULL, NULL, NULL,
-	"3rd-level cache: 12MByte, 24-way set associative, 64 byte line size",
-	"3rd-level cache: 18MByte, 24-way set associative, 64 byte line size",
-	"3rd-level cache: 24MByte, 24-way set associative, 64 byte line size",
-	NULL, NULL, NULL,
-// 0xF0
-	"64-Byte prefetching",
-	"128-Byte prefetching",
-	NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
+	ARCHINFO_EDX,
+	ARCHINFO_ECX,
+	ARCHINFO_EXT_EBX,
+	ARCHINFO_EXT_ECX,
+
+	// padded to a whole cache line of 64-bit words
+	ARCHINFO_WORDS = 8
 };
 
+// feature identifier: register index in the high bits, bit index in the low 5 bits
+#define ARCHINFO_FEATURE(word, bit) (((word) << 5) | (bit))
+
+// set in every published word once the features have been decoded
+#define ARCHINFO_READY ((uint64_t)1 << 63)
+
+typedef enum
+{
+	ARCHINFO_FPU          = ARCHINFO_FEATURE(ARCHINFO_EDX,  0),
+	ARCHINFO_VME          = ARCHINFO_FEATURE(ARCHINFO_EDX,  1),
+	ARCHINFO_DE           = ARCHINFO_FEATURE(ARCHINFO_EDX,  2),
+	ARCHINFO_PSE          = ARCHINFO_FEATURE(ARCHINFO_EDX,  3),
+	ARCHINFO_TSC          = ARCHINFO_FEATURE(ARCHINFO_EDX,  4),
+	ARCHINFO_MSR          = ARCHINFO_FEATURE(ARCHINFO_EDX,  5),
+	ARCHINFO_PAE          = ARCHINFO_FEATURE(ARCHINFO_EDX,  6),
+	ARCHINFO_MCE          = ARCHINFO_FEATURE(ARCHINFO_EDX,  7),
+	ARCHINFO_CX8          = ARCHINFO_FEATURE(ARCHINFO_EDX,  8),
+	ARCHINFO_APIC         = ARCHINFO_FEATURE(ARCHINFO_EDX,  9),
+	ARCHINFO_SEP          = ARCHINFO_FEATURE(ARCHINFO_EDX, 11),
+	ARCHINFO_MTRR         = ARCHINFO_FEATURE(ARCHINFO_EDX, 12),
+	ARCHINFO_PGE          = ARCHINFO_FEATURE(ARCHINFO_EDX, 13),
+	ARCHINFO_MCA          = ARCHINFO_FEATURE(ARCHINFO_EDX, 14),
+	ARCHINFO_CMOV         = ARCHINFO_FEATURE(ARCHINFO_EDX, 15),
+	ARCHINFO_PAT          = ARCHINFO_FEATURE(ARCHINFO_EDX, 16),
+	ARCHINFO_PSE_36       = ARCHINFO_FEATURE(ARCHINFO_EDX, 17),
+	ARCHINFO_PSN          = ARCHINFO_FEATURE(ARCHINFO_EDX, 18),
+	ARCHINFO_CLFSH        = ARCHINFO_FEATURE(ARCHINFO_EDX, 19),
+	ARCHINFO_DS           = ARCHINFO_FEATURE(ARCHINFO_EDX, 21),
+	ARCHINFO_ACPI         = ARCHINFO_FEATURE(ARCHINFO_EDX, 22),
+	ARCHINFO_MMX          = ARCHINFO_FEATURE(ARCHINFO_EDX, 23),
+	ARCHINFO_FXSR         = ARCHINFO_FEATURE(ARCHINFO_EDX, 24),
+	ARCHINFO_SSE          = ARCHINFO_FEATURE(ARCHINFO_EDX, 25),
+	ARCHINFO_SSE2         = ARCHINFO_FEATURE(ARCHINFO_EDX, 26),
+	ARCHINFO_SS           = ARCHINFO_FEATURE(ARCHINFO_EDX, 27),
+	ARCHINFO_HTT          = ARCHINFO_FEATURE(ARCHINFO_EDX, 28),
+	ARCHINFO_TM           = ARCHINFO_FEATURE(ARCHINFO_EDX, 29),
+	ARCHINFO_PBE          = ARCHINFO_FEATURE(ARCHINFO_EDX, 31),
+
+	ARCHINFO_SSE3         = ARCHINFO_FEATURE(ARCHINFO_ECX,  0),
+	ARCHINFO_PCLMULQDQ    = ARCHINFO_FEATURE(ARCHINFO_ECX,  1),
+	ARCHINFO_DTES64       = ARCHINFO_FEATURE(ARCHINFO_ECX,  2),
+	ARCHINFO_MONITOR      = ARCHINFO_FEATURE(ARCHINFO_ECX,  3),
+	ARCHINFO_DS_CPL       = ARCHINFO_FEATURE(ARCHINFO_ECX,  4),
+	ARCHINFO_VMX          = ARCHINFO_FEATURE(ARCHINFO_ECX,  5),
+	ARCHINFO_SMX          = ARCHINFO_FEATURE(ARCHINFO_ECX,  6),
+	ARCHINFO_EIST         = ARCHINFO_FEATURE(ARCHINFO_ECX,  7),
+	ARCHINFO_TM2          = ARCHINFO_FEATURE(ARCHINFO_ECX,  8),
+	ARCHINFO_SSSE3        = ARCHINFO_FEATURE(ARCHINFO_ECX,  9),
+	ARCHINFO_CNXT_ID      = ARCHINFO_FEATURE(ARCHINFO_ECX, 10),
+	ARCHINFO_SDBG         = ARCHINFO_FEATURE(ARCHINFO_ECX, 11),
+	ARCHINFO_FMA          = ARCHINFO_FEATURE(ARCHINFO_ECX, 12),
+	ARCHINFO_CMPXCHG16B   = ARCHINFO_FEATURE(ARCHINFO_ECX, 13),
+	ARCHINFO_XTPR         = ARCHINFO_FEATURE(ARCHINFO_ECX, 14),
+	ARCHINFO_PDCM         = ARCHINFO_FEATURE(ARCHINFO_ECX, 15),
+	ARCHINFO_PCID         = ARCHINFO_FEATURE(ARCHINFO_ECX, 17),
+	ARCHINFO_DCA          = ARCHINFO_FEATURE(ARCHINFO_ECX, 18),
+	ARCHINFO_SSE4_1       = ARCHINFO_FEATURE(ARCHINFO_ECX, 19),
+	ARCHINFO_SSE4_2       = ARCHINFO_FEATURE(ARCHINFO_ECX, 20),
+	ARCHINFO_X2APIC       = ARCHINFO_FEATURE(ARCHINFO_ECX, 21),
+	ARCHINFO_MOVBE        = ARCHINFO_FEATURE(ARCHINFO_ECX, 22),
+	ARCHINFO_POPCNT       = ARCHINFO_FEATURE(ARCHINFO_ECX, 23),
+	ARCHINFO_TSC_DEADLINE = ARCHINFO_FEATURE(ARCHINFO_ECX, 24),
+	ARCHINFO_AESNI        = ARCHINFO_FEATURE(ARCHINFO_ECX, 25),
+	ARCHINFO_XSAVE        = ARCHINFO_FEATURE(ARCHINFO_ECX, 26),
+	ARCHINFO_OSXSAVE      = ARCHINFO_FEATURE(ARCHINFO_ECX, 27),
+	ARCHINFO_AVX          = ARCHINFO_FEATURE(ARCHINFO_ECX, 28),
+	ARCHINFO_F16C         = ARCHINFO_FEATURE(ARCHINFO_ECX, 29),
+	ARCHINFO_RDRND        = ARCHINFO_FEATURE(ARCHINFO_ECX, 30),
+
+	ARCHINFO_FSGSBASE     = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX,  0),
+	ARCHINFO_IA32_TSC_ADJ = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX,  1),
+	ARCHINFO_SGX          = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX,  2),
+	ARCHINFO_BMI1         = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX,  3),
+	ARCHINFO_HLE          = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX,  4),
+	ARCHINFO_AVX2         = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX,  5),
+	ARCHINFO_FDP_EXCP     = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX,  6),
+	ARCHINFO_SMEP         = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX,  7),
+	ARCHINFO_BMI2         = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX,  8),
+	ARCHINFO_ENHANCED_RMS = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX,  9),
+	ARCHINFO_INVPCID      = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 10),
+	ARCHINFO_RTM          = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 11),
+	ARCHINFO_RDT_M        = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 12),
+	ARCHINFO_DEPR_FCSDS   = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 13),
+	ARCHINFO_MPX          = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 14),
+	ARCHINFO_RDT_A        = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 15),
+	ARCHINFO_AVX512F      = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 16),
+	ARCHINFO_AVX512DQ     = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 17),
+	ARCHINFO_RDSEED       = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 18),
+	ARCHINFO_ADX          = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 19),
+	ARCHINFO_SMAP         = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 20),
+	ARCHINFO_CLFLUSHOPT   = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 23),
+	ARCHINFO_CLWB         = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 24),
+	ARCHINFO_INTEL_PTRACE = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 25),
+	ARCHINFO_AVX512PF     = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 26),
+	ARCHINFO_AVX512ER     = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 27),
+	ARCHINFO_AVX512CD     = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 28),
+	ARCHINFO_SHA          = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 29),
+	ARCHINFO_AVX512BW     = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 30),
+	ARCHINFO_AVX512VL     = ARCHINFO_FEATURE(ARCHINFO_EXT_EBX, 31),
+
+	ARCHINFO_PREFETCHWT1  = ARCHINFO_FEATURE(ARCHINFO_EXT_ECX,  0),
+	ARCHINFO_UMIP         = ARCHINFO_FEATURE(ARCHINFO_EXT_ECX,  2),
+	ARCHINFO_PKU          = ARCHINFO_FEATURE(ARCHINFO_EXT_ECX,  3),
+	ARCHINFO_OSPKE        = ARCHINFO_FEATURE(ARCHINFO_EXT_ECX,  4),
+	ARCHINFO_RPID         = ARCHINFO_FEATURE(ARCHINFO_EXT_ECX, 22),
+	ARCHINFO_SGX_LC       = ARCHINFO_FEATURE(ARCHINFO_EXT_ECX, 30)
+
+
+} archinfo_feature_t;
+
+extern const char* CacheTypeStrings[4];
+extern const char* TlbTypeStrings[TLB_TYPES];
+extern const char* TlbPageStrings[TLB_PAGE_SIZES];
+extern const char* XsaveComponentStrings[XSAVE_COMPONENTS];
+extern const char* CoreTypeStrings[CORE_TYPES];
+extern const char* CpuWordStrings[CPU_WORDS];
+extern const char* PmuEventStrings[PMU_EVENTS];
+
+extern const feature_t EdxFeatures[EDX_FEATURES_SIZE];
+extern const feature_t EcxFeatures[ECX_FEATURES_SIZE];
+extern const feature_t EbxExtFeatures[EBX_EXT_FEATURES_SIZE];
+extern const feature_t EcxExtFeatures[ECX_EXT_FEATURES_SIZE];
+
+extern const char* BrandStrings[256];
+extern const char* CacheTlbDescriptors[256];
+
+// validated feature registers, written once and read-only afterwards
+extern uint64_t ArchinfoFeatureWords[ARCHINFO_WORDS];
+
+
+// check if the cpuid instruction is available
+int cpuid_available();
+
+// get the name of the intel microarchitecture of an extended model number
+const char* microarch_info(uint32_t model_num);
+
+// get the name of the microarchitecture of a VENDOR_* cpu from its extended family and model numbers
+const char* microarch_name(uint32_t vendor_num, uint32_t family_num, uint32_t model_num);
+
+// get the VENDOR_* number of a vendor id, hygon cpus use the leaves of amd ones
+uint32_t archinfo_vendor(const cpu_vendor_t* vendor);
+
+// collect the per-cpu leaves by migrating a single thread instead of a pool of pinned threads
+#define ARCHINFO_SERIAL 0x1
+
+// fill a snapshot with every information about the cpu
+// returns 0 if the cpuid instruction is not available
+int archinfo_query(archinfo_t* info);
+
+// fill a snapshot with every information about the cpu using the ARCHINFO_* flags
+int archinfo_query_ex(archinfo_t* info, uint32_t flags);
+
+// fill a snapshot decoding the leaves of a dump instead of the cpu, the dump must outlive the snapshot
+int archinfo_query_dump(archinfo_t* info, const cpuid_dump_t* dump);
+
+// release the storage allocated by archinfo_query()
+void archinfo_free(archinfo_t* info);
+
+// size of the xsave area holding the components of a mask, in the standard or the compacted format
+uint32_t archinfo_xsave_size(const archinfo_t* info, uint64_t mask, int compacted);
+
+// narrow the features published to archinfo_features() and the dispatcher to the ones every logical processor reports
+// the dispatched functions resolved before are patched again, returns 1 if a feature was removed
+int archinfo_features_restrict(const archinfo_t* info);
+
+// get the summary of a CORE_TYPE_* type, NULL if no logical processor is of that type
+const cpu_core_type_t* archinfo_core_type(const archinfo_t* info, uint32_t type);
+
+// size in bytes of a TLB_PAGE_* page size
+uint64_t tlb_page_size(uint32_t page);
+
+// largest memory range the data tlbs of a level translate with a page size, the whole hierarchy if level is 0
+// returns 0 if no tlb of the level translates the page size
+uint64_t archinfo_tlb_reach(const archinfo_t* info, uint32_t level, uint32_t page);
+
+// decode only the time stamp counter leaves, returns 0 if cpuid is not available
+int archinfo_tsc(cpu_tsc_t* tsc);
+
+// decode only the performance monitoring leaves, returns the VENDOR_* number, VENDOR_UNKNOWN if cpuid is not available
+uint32_t archinfo_pmu(cpu_pmu_t* pmu);
+
+// function run by percpu_run() on a logical processor, index is its position in the array
+typedef void (*percpu_fn_t)(cpu_logical_t* cpu, uint32_t index, void* arg);
+
+// run a function on every logical processor of an array while pinned to it, using the ARCHINFO_* flags
+// the function is not called for the cpus that cannot be visited
+void percpu_run(cpu_logical_t* cpus, uint32_t cpus_cnt, uint32_t flags, percpu_fn_t fn, void* arg);
+
+// collect the per-cpu leaves of the online logical processors into an allocated array
+// returns NULL if the logical processors cannot be enumerated
+cpu_logical_t* percpu_collect(uint32_t* cpus_cnt, uint32_t flags);
+
+// collect the per-cpu leaves of the logical processors of a dump into an allocated array
+cpu_logical_t* percpu_replay(const cpuid_dump_t* dump, uint32_t* cpus_cnt);
+
+// parse a linux cpu list such as "0-3,8,10-11" into an allocated array of cpu numbers
+uint32_t* cpulist_parse(const char* list, uint32_t* cpus_cnt);
+
+// format an ascending array of cpu numbers as a linux cpu list
+// returns the length of the list, which is truncated to the size of the buffer
+uint32_t cpulist_format(const uint32_t* cpus, uint32_t cpus_cnt, char* list, uint32_t size);
+
+// decode the features on the first call and return the requested published word
+uint64_t archinfo_features_init(uint32_t word);
+
+// get the validated features, decoding them on the first call
+void archinfo_features(cpu_features_t* features, cpu_features_ext_t* features_ext);
+
+// check if the cpu supports a feature, decoding the features on the first call
+static inline int archinfo_has(archinfo_feature_t feature)
+{
+	// every published word is self-contained so a relaxed load is enough
+	uint64_t word = __atomic_load_n(&ArchinfoFeatureWords[feature >> 5], __ATOMIC_RELAXED);
+
+	if(__builtin_expect(!(word & ARCHINFO_READY), 0))
+		word = archinfo_features_init(feature >> 5);
+
+	return (word >> (feature & 0x1F)) & 1;
+}
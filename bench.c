@@ -0,0 +1,223 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if   defined(_WIN32)
+	#include <windows.h>
+	#include <malloc.h>
+#elif defined(__linux__)
+	#define _GNU_SOURCE
+	#include <sched.h>
+	#include <pthread.h>
+	#include <sys/mman.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "placement.h"
+#include "timer.h"
+
+// size of the transparent huge pages and of the default hugetlb pages
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+#if defined(__linux__) && !defined(MAP_HUGE_SHIFT)
+	#define MAP_HUGE_SHIFT 26
+#endif
+
+// dependent additions of the clock estimation loop
+#define CLOCK_ITERATIONS 50000000
+
+void* bench_alloc(size_t size, int huge_pages)
+{
+#if   defined(_WIN32)
+	return _aligned_malloc(size, 4096);
+#else
+	void* buffer = MAP_FAILED;
+	size_t rounded = (size + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+
+	// try the reserved hugetlb pages first
+	if(huge_pages)
+		buffer = mmap(NULL, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+	if(buffer == MAP_FAILED)
+	{
+		buffer = mmap(NULL, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if(buffer == MAP_FAILED)
+			return NULL;
+
+		// fall back to the transparent huge pages, or keep the base pages
+		madvise(buffer, rounded, huge_pages ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+	}
+
+	return buffer;
+#endif
+}
+
+void bench_free(void* buffer, size_t size)
+{
+#if   defined(_WIN32)
+	_aligned_free(buffer);
+#else
+	size_t rounded = (size + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+
+	munmap(buffer, rounded);
+#endif
+}
+
+// granularity of the mappings of a backing
+static size_t backing_size(bench_pages_t pages)
+{
+	return (pages == BENCH_PAGES_1G) ? ((size_t)1 << 30) : HUGE_PAGE_SIZE;
+}
+
+void* bench_alloc_pages(size_t size, bench_pages_t pages)
+{
+#if   defined(__linux__)
+	size_t rounded = (size + backing_size(pages) - 1) & ~(backing_size(pages) - 1);
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+	// the hugetlb pages of a size must be reserved, there is no fallback
+	if(pages == BENCH_PAGES_2M)
+		flags |= MAP_HUGETLB | (21 << MAP_HUGE_SHIFT);
+	else if(pages == BENCH_PAGES_1G)
+		flags |= MAP_HUGETLB | (30 << MAP_HUGE_SHIFT);
+
+	void* buffer = mmap(NULL, rounded, PROT_READ | PROT_WRITE, flags, -1, 0);
+
+	if(buffer == MAP_FAILED)
+		return NULL;
+
+	if(pages == BENCH_PAGES_4K)
+		madvise(buffer, rounded, MADV_NOHUGEPAGE);
+	else if(pages == BENCH_PAGES_THP)
+		madvise(buffer, rounded, MADV_HUGEPAGE);
+
+	return buffer;
+#else
+	return (pages == BENCH_PAGES_4K) ? bench_alloc(size, 0) : NULL;
+#endif
+}
+
+void bench_free_pages(void* buffer, size_t size, bench_pages_t pages)
+{
+#if   defined(__linux__)
+	size_t rounded = (size + backing_size(pages) - 1) & ~(backing_size(pages) - 1);
+
+	munmap(buffer, rounded);
+#else
+	bench_free(buffer, size);
+#endif
+}
+
+static uint64_t xorshift(uint64_t* state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+
+	return *state;
+}
+
+void bench_chain(uint8_t* buffer, size_t size, uint32_t line_size, uint32_t* order)
+{
+	uint32_t lines = size / line_size;
+	uint64_t state = 0x9E3779B97F4A7C15ull;
+
+	for(uint32_t i = 0; i < lines; ++i)
+		order[i] = i;
+
+	// sattolo's shuffle gives a single cycle visiting every line in a random order
+	for(uint32_t i = lines - 1; i > 0; --i)
+	{
+		uint32_t j = xorshift(&state) % i;
+		uint32_t tmp = order[i];
+
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+
+	for(uint32_t i = 0; i < lines; ++i)
+		*(void**)(buffer + (size_t)i * line_size) = buffer + (size_t)order[i] * line_size;
+}
+
+void* bench_chase(void* p, uint64_t loads)
+{
+	for(uint64_t i = 0; i < loads; i += 8)
+	{
+		p = *(void**)p;
+		p = *(void**)p;
+		p = *(void**)p;
+		p = *(void**)p;
+		p = *(void**)p;
+		p = *(void**)p;
+		p = *(void**)p;
+		p = *(void**)p;
+	}
+
+	return p;
+}
+
+
+double bench_core_ghz()
+{
+	uintptr_t x = 0;
+	uintptr_t i = CLOCK_ITERATIONS;
+	uintptr_t one = 1;
+
+	uint64_t start = timer_ns();
+
+	// every iteration is bound by 8 dependent single cycle additions,
+	// register operands keep recent cores from folding them at rename
+	__asm__ __volatile__
+	(
+		"1:\n\t"
+		"add %2, %0\n\t"
+		"add %2, %0\n\t"
+		"add %2, %0\n\t"
+		"add %2, %0\n\t"
+		"add %2, %0\n\t"
+		"add %2, %0\n\t"
+		"add %2, %0\n\t"
+		"add %2, %0\n\t"
+		"dec %1\n\t"
+		"jnz 1b\n\t"
+		: "+r"(x), "+r"(i)
+		: "r"(one)
+	);
+
+	uint64_t elapsed = timer_ns() - start;
+
+	return (double)CLOCK_ITERATIONS * 8.0 / (double)elapsed;
+}
+
+void bench_pin_current()
+{
+#if   defined(_WIN32)
+	SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << GetCurrentProcessorNumber());
+#else
+	int cpu = sched_getcpu();
+
+	if(cpu >= 0)
+		placement_pin_thread(pthread_self(), cpu);
+#endif
+}
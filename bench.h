@@ -0,0 +1,63 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// allocate a page aligned benchmark buffer, backed by 2 MB pages if requested and available
+// returns NULL on failure
+void* bench_alloc(size_t size, int huge_pages);
+
+// release a buffer allocated by bench_alloc()
+void bench_free(void* buffer, size_t size);
+
+// page backings of a benchmark buffer
+typedef enum
+{
+	BENCH_PAGES_4K,
+	BENCH_PAGES_THP,
+	BENCH_PAGES_2M,
+	BENCH_PAGES_1G,
+
+	BENCH_PAGES
+
+} bench_pages_t;
+
+// allocate a buffer with a single backing: base pages only, transparent huge pages or reserved hugetlb pages
+// returns NULL if the backing is not available
+void* bench_alloc_pages(size_t size, bench_pages_t pages);
+
+// release a buffer allocated by bench_alloc_pages()
+void bench_free_pages(void* buffer, size_t size, bench_pages_t pages);
+
+// link the lines of a buffer into a single cycle in a random order, order holds a scratch index per line
+void bench_chain(uint8_t* buffer, size_t size, uint32_t line_size, uint32_t* order);
+
+// follow a chain built by bench_chain() for a number of dependent loads, a multiple of 8
+void* bench_chase(void* p, uint64_t loads);
+
+// estimate the current core clock in GHz timing a chain of dependent additions
+double bench_core_ghz();
+
+// pin the calling thread to the logical processor it is running on
+void bench_pin_current();
@@ -0,0 +1,480 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if defined(__linux__)
+	#define _GNU_SOURCE
+	#include <unistd.h>
+	#include <sched.h>
+	#include <pthread.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "archinfo.h"
+#include "stream.h"
+#include "placement.h"
+#include "commands.h"
+#include "bench.h"
+#include "timer.h"
+
+#define BANDWIDTH_LEVELS       (MAX_CACHES + 1)
+#define BANDWIDTH_TRIALS       5
+#define BANDWIDTH_PASS_BYTES   (256 << 20)
+#define BANDWIDTH_MAX_STEPS    34
+#define BANDWIDTH_SATURATION   0.9
+
+// elements of an array are rounded to whole cache lines so the arrays stay aligned
+#define BANDWIDTH_ALIGN 8
+
+// volatile sink so the read kernel is not optimized away
+static volatile double Sink;
+
+typedef struct
+{
+	char name[32];
+	size_t working_set;
+
+} bandwidth_level_t;
+
+// arrays of a kernel carved out of a buffer, every array of n elements
+static void carve(double* buffer, size_t working_set, uint32_t arrays, double** a, double** b, double** c, size_t* n)
+{
+	*n = (working_set / (arrays * sizeof(double))) & ~(size_t)(BANDWIDTH_ALIGN - 1);
+
+	*a = buffer;
+	*b = (arrays == 1) ? buffer : buffer + *n;
+	*c = (arrays == 3) ? buffer + 2 * *n : *b;
+}
+
+static uint32_t repetitions(size_t working_set)
+{
+	return (working_set >= BANDWIDTH_PASS_BYTES) ? 1 : BANDWIDTH_PASS_BYTES / working_set;
+}
+
+static void fill(double* buffer, size_t elements)
+{
+	for(size_t i = 0; i < elements; ++i)
+		buffer[i] = 1.0;
+}
+
+// best bandwidth in GB/s of a kernel on a single thread
+static double measure(const stream_kernel_t* kernel, double* buffer, size_t working_set)
+{
+	stream_fn_t fn = (stream_fn_t)dispatch_select(kernel->candidates, STREAM_CANDIDATES)->fn;
+	uint32_t reps = repetitions(working_set);
+
+	double *a, *b, *c;
+	size_t n;
+
+	carve(buffer, working_set, kernel->arrays, &a, &b, &c, &n);
+
+	double best = 0.0;
+
+	for(uint32_t t = 0; t < BANDWIDTH_TRIALS; ++t)
+	{
+		uint64_t start = timer_ns();
+
+		for(uint32_t r = 0; r < reps; ++r)
+			Sink = fn(a, b, c, 3.0, n);
+
+		uint64_t elapsed = timer_ns() - start;
+		double rate = (double)n * kernel->arrays * sizeof(double) * reps / (double)elapsed;
+
+		if(rate > best)
+			best = rate;
+	}
+
+	return best;
+}
+
+#if defined(__linux__)
+
+// the workers start measuring once every one of them has been created, or leave if one could not be
+typedef struct
+{
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+
+	// 0 while the workers are being created, 1 to start, 2 to leave
+	uint32_t state;
+
+} bandwidth_gate_t;
+
+typedef struct
+{
+	bandwidth_gate_t* gate;
+	pthread_barrier_t* barrier;
+
+	double* buffer;
+	size_t working_set;
+
+} bandwidth_worker_t;
+
+static void* bandwidth_worker(void* arg)
+{
+	bandwidth_worker_t* worker = arg;
+
+	// touch the slice from its own thread so the pages are local to its node
+	fill(worker->buffer, worker->working_set / sizeof(double));
+
+	pthread_mutex_lock(&worker->gate->lock);
+
+	while(worker->gate->state == 0)
+		pthread_cond_wait(&worker->gate->cond, &worker->gate->lock);
+
+	uint32_t state = worker->gate->state;
+
+	pthread_mutex_unlock(&worker->gate->lock);
+
+	if(state != 1)
+		return NULL;
+
+	uint32_t reps = repetitions(worker->working_set);
+
+	// every trial of every kernel starts and ends on the barrier shared with the timing thread
+	for(uint32_t k = 0; k < STREAM_KERNELS; ++k)
+	{
+		const stream_kernel_t* kernel = &StreamKernels[k];
+		stream_fn_t fn = (stream_fn_t)dispatch_select(kernel->candidates, STREAM_CANDIDATES)->fn;
+
+		double *a, *b, *c;
+		size_t n;
+
+		carve(worker->buffer, worker->working_set, kernel->arrays, &a, &b, &c, &n);
+
+		for(uint32_t t = 0; t < BANDWIDTH_TRIALS; ++t)
+		{
+			pthread_barrier_wait(worker->barrier);
+
+			for(uint32_t r = 0; r < reps; ++r)
+				Sink = fn(a, b, c, 3.0, n);
+
+			pthread_barrier_wait(worker->barrier);
+		}
+	}
+
+	return NULL;
+}
+
+static void open_gate(bandwidth_gate_t* gate, uint32_t state)
+{
+	pthread_mutex_lock(&gate->lock);
+	gate->state = state;
+	pthread_cond_broadcast(&gate->cond);
+	pthread_mutex_unlock(&gate->lock);
+}
+
+// create the workers directly on their cpus, returns the number of created workers
+static uint32_t create_workers(pthread_t* threads, bandwidth_worker_t* workers, const uint32_t* cpus, uint32_t threads_cnt)
+{
+	// the cpu set is sized for the configured cpus instead of CPU_SETSIZE
+	uint32_t max_cpus = sysconf(_SC_NPROCESSORS_CONF);
+
+	for(uint32_t i = 0; i < threads_cnt; ++i)
+		if(max_cpus < cpus[i] + 1)
+			max_cpus = cpus[i] + 1;
+
+	cpu_set_t* cpu_set = CPU_ALLOC(max_cpus);
+
+	if(cpu_set == NULL)
+		return 0;
+
+	size_t set_size = CPU_ALLOC_SIZE(max_cpus);
+	uint32_t created = 0;
+
+	for(; created < threads_cnt; ++created)
+	{
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+
+		CPU_ZERO_S(set_size, cpu_set);
+		CPU_SET_S(cpus[created], set_size, cpu_set);
+		pthread_attr_setaffinity_np(&attr, set_size, cpu_set);
+
+		int error = pthread_create(&threads[created], &attr, bandwidth_worker, &workers[created]);
+
+		pthread_attr_destroy(&attr);
+
+		if(error != 0)
+			break;
+	}
+
+	CPU_FREE(cpu_set);
+
+	return created;
+}
+
+// run the workers of measure_threads() on their cpus and time every trial of every kernel
+static int run_workers(bandwidth_worker_t* workers, const uint32_t* cpus, uint32_t threads_cnt, double* rates)
+{
+	pthread_t* threads = malloc(threads_cnt * sizeof(pthread_t));
+
+	if(threads == NULL)
+		return 0;
+
+	bandwidth_gate_t gate = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0 };
+	pthread_barrier_t barrier;
+
+	pthread_barrier_init(&barrier, NULL, threads_cnt + 1);
+
+	for(uint32_t i = 0; i < threads_cnt; ++i)
+	{
+		workers[i].gate = &gate;
+		workers[i].barrier = &barrier;
+	}
+
+	uint32_t created = create_workers(threads, workers, cpus, threads_cnt);
+
+	// the created workers leave from the gate if one of them is missing
+	open_gate(&gate, (created == threads_cnt) ? 1 : 2);
+
+	if(created == threads_cnt)
+	{
+		size_t slice = workers[0].working_set;
+		uint32_t reps = repetitions(slice);
+
+		for(uint32_t k = 0; k < STREAM_KERNELS; ++k)
+		{
+			const stream_kernel_t* kernel = &StreamKernels[k];
+			size_t n = (slice / (kernel->arrays * sizeof(double))) & ~(size_t)(BANDWIDTH_ALIGN - 1);
+			double bytes = (double)n * kernel->arrays * sizeof(double) * reps * threads_cnt;
+
+			rates[k] = 0.0;
+
+			for(uint32_t t = 0; t < BANDWIDTH_TRIALS; ++t)
+			{
+				pthread_barrier_wait(&barrier);
+
+				uint64_t start = timer_ns();
+
+				pthread_barrier_wait(&barrier);
+
+				uint64_t elapsed = timer_ns() - start;
+
+				if(bytes / elapsed > rates[k])
+					rates[k] = bytes / elapsed;
+			}
+		}
+	}
+
+	for(uint32_t i = 0; i < created; ++i)
+		pthread_join(threads[i], NULL);
+
+	pthread_barrier_destroy(&barrier);
+	free(threads);
+
+	return created == threads_cnt;
+}
+
+// aggregated bandwidth in GB/s of every kernel running on the first threads_cnt cpus of the plan
+// every worker streams over its own slice of the working set, first touched by the worker
+static int measure_threads(const uint32_t* cpus, uint32_t threads_cnt, size_t working_set, int huge_pages, double* rates)
+{
+	bandwidth_worker_t* workers = calloc(threads_cnt, sizeof(bandwidth_worker_t));
+	size_t slice = (working_set / threads_cnt) & ~(size_t)(BANDWIDTH_ALIGN * sizeof(double) - 1);
+
+	if(workers == NULL)
+		return 0;
+
+	uint32_t allocated = 0;
+
+	for(; allocated < threads_cnt && slice != 0; ++allocated)
+	{
+		workers[allocated].working_set = slice;
+
+		if((workers[allocated].buffer = bench_alloc(slice, huge_pages)) == NULL)
+			break;
+	}
+
+	int measured = (allocated == threads_cnt) && run_workers(workers, cpus, threads_cnt, rates);
+
+	for(uint32_t i = 0; i < allocated; ++i)
+		bench_free(workers[i].buffer, slice);
+
+	free(workers);
+
+	return measured;
+}
+
+static void print_scaling(const archinfo_t* info, uint32_t threads_cnt, placement_policy_t policy, int huge_pages, size_t working_set)
+{
+	uint32_t* cpus = placement_plan(info, policy, threads_cnt);
+
+	if(cpus == NULL)
+		return;
+
+	printf("\nScaling over %zu MB, %s placement:\n", working_set >> 20, PlacementPolicyStrings[policy]);
+	printf("%8s", "Threads");
+
+	for(uint32_t k = 0; k < STREAM_KERNELS; ++k)
+		printf(" %9s", StreamKernels[k].name);
+
+	printf("\n");
+
+	double peak[STREAM_KERNELS] = { 0.0 };
+	double rates[BANDWIDTH_MAX_STEPS][STREAM_KERNELS];
+	uint32_t counts[BANDWIDTH_MAX_STEPS];
+	uint32_t counts_cnt = 0;
+
+	// double the threads up to the requested count, which is always measured
+	for(uint32_t t = 1; t <= threads_cnt; t = (t * 2 > threads_cnt && t != threads_cnt) ? threads_cnt : t * 2)
+	{
+		if(!measure_threads(cpus, t, working_set, huge_pages, rates[counts_cnt]))
+		{
+			printf("Cannot create %u threads with their buffers\n", t);
+
+			break;
+		}
+
+		printf("%8u", t);
+
+		for(uint32_t k = 0; k < STREAM_KERNELS; ++k)
+		{
+			printf(" %9.2f", rates[counts_cnt][k]);
+
+			if(rates[counts_cnt][k] > peak[k])
+				peak[k] = rates[counts_cnt][k];
+		}
+
+		printf("\n");
+
+		counts[counts_cnt++] = t;
+	}
+
+	// the saturation point is the first thread count reaching most of the peak
+	printf("%8s", "Sat. at");
+
+	for(uint32_t k = 0; k < STREAM_KERNELS; ++k)
+	{
+		uint32_t i = 0;
+
+		while(i + 1 < counts_cnt && rates[i][k] < peak[k] * BANDWIDTH_SATURATION)
+			++i;
+
+		printf(" %9u", (counts_cnt != 0) ? counts[i] : 0);
+	}
+
+	printf("\n");
+
+	free(cpus);
+}
+
+#endif
+
+int bandwidth_command(int argc, char* argv[])
+{
+	int huge_pages = 0;
+	uint32_t threads_cnt = 0;
+	placement_policy_t policy = PLACEMENT_CORES;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		if(strcmp(argv[i], "--hugepages") == 0)
+			huge_pages = 1;
+		else if(!placement_policy_parse(argv[i], &policy))
+			threads_cnt = atoi(argv[i]);
+	}
+
+	archinfo_t info;
+
+	if(!archinfo_query(&info))
+	{
+		printf("CPUID is not supported\n");
+
+		return 1;
+	}
+
+	// half of every data or unified cache, then well past the last level
+	bandwidth_level_t levels[BANDWIDTH_LEVELS];
+	uint32_t levels_cnt = 0;
+	size_t llc_size = 0;
+
+	for(uint32_t i = 0; i < info.caches_cnt; ++i)
+	{
+		const cpu_cache_t* cache = &info.caches[i];
+
+		if(cache->type == 2)
+			continue;
+
+		snprintf(levels[levels_cnt].name, sizeof(levels[levels_cnt].name), "L%u", cache->level);
+		levels[levels_cnt++].working_set = cache->size / 2;
+
+		llc_size = cache->size;
+	}
+
+	size_t memory_size = llc_size * 4;
+
+	if(memory_size < (64 << 20))
+		memory_size = 64 << 20;
+
+	if(memory_size > (512 << 20))
+		memory_size = 512 << 20;
+
+	strcpy(levels[levels_cnt].name, "Memory");
+	levels[levels_cnt++].working_set = memory_size;
+
+	double* buffer = bench_alloc(memory_size, huge_pages);
+
+	if(buffer == NULL)
+	{
+		printf("Cannot allocate %zu MB\n", memory_size >> 20);
+		archinfo_free(&info);
+
+		return 1;
+	}
+
+	fill(buffer, memory_size / sizeof(double));
+
+	bench_pin_current();
+
+	printf("Kernels: %s, %s pages\n\n", dispatch_select(StreamKernels[0].candidates, STREAM_CANDIDATES)->name, huge_pages ? "huge" : "base");
+	printf("Single thread GB/s:\n%10s", "Kernel");
+
+	for(uint32_t l = 0; l < levels_cnt; ++l)
+		printf(" %9s", levels[l].name);
+
+	printf("\n");
+
+	for(uint32_t k = 0; k < STREAM_KERNELS; ++k)
+	{
+		printf("%10s", StreamKernels[k].name);
+
+		for(uint32_t l = 0; l < levels_cnt; ++l)
+			printf(" %9.2f", measure(&StreamKernels[k], buffer, levels[l].working_set));
+
+		printf("\n");
+	}
+
+#if defined(__linux__)
+	if(threads_cnt == 0)
+		threads_cnt = info.topology.cores_cnt;
+
+	if(threads_cnt != 0)
+		print_scaling(&info, threads_cnt, policy, huge_pages, memory_size);
+#endif
+
+	bench_free(buffer, memory_size);
+	archinfo_free(&info);
+
+	return 0;
+}
@@ -0,0 +1,350 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if defined(__linux__)
+	#define _GNU_SOURCE
+	#include <unistd.h>
+	#include <sched.h>
+	#include <pthread.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "archinfo.h"
+#include "placement.h"
+#include "commands.h"
+#include "timer.h"
+
+#define PINGPONG_ROUNDTRIPS 4000
+#define PINGPONG_TRIALS     3
+
+#if defined(__linux__)
+
+// relation of two logical processors, from the closest to the farthest
+typedef enum
+{
+	RELATION_SMT,
+	RELATION_L2,
+	RELATION_L3,
+	RELATION_PACKAGE,
+	RELATION_CROSS_PACKAGE,
+
+	RELATIONS
+
+} relation_t;
+
+static const char* RelationStrings[RELATIONS] =
+{
+	"SMT sibling",
+	"Same L2",
+	"Same L3",
+	"Same package",
+	"Cross-package"
+};
+
+typedef struct
+{
+	// the bounced counter is alone in its cache line
+	volatile uint64_t flag __attribute__((aligned(64)));
+
+	uint32_t roundtrips __attribute__((aligned(64)));
+	int cas;
+
+	// 0 until the responder is pinned, 1 to answer, 2 to leave without answering
+	volatile uint32_t state;
+
+} pingpong_t;
+
+// move the counter from value to value + 1, spinning until it holds value
+static inline void handoff(pingpong_t* pingpong, uint64_t value)
+{
+	if(pingpong->cas)
+	{
+		uint64_t expected = value;
+
+		while(!__atomic_compare_exchange_n(&pingpong->flag, &expected, value + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		{
+			__builtin_ia32_pause();
+			expected = value;
+		}
+	}
+	else
+	{
+		while(__atomic_load_n(&pingpong->flag, __ATOMIC_ACQUIRE) != value)
+			__builtin_ia32_pause();
+
+		__atomic_store_n(&pingpong->flag, value + 1, __ATOMIC_RELEASE);
+	}
+}
+
+// the responder answers every odd value of the counter with the next even one
+static void* responder(void* arg)
+{
+	pingpong_t* pingpong = arg;
+	uint64_t total = (uint64_t)pingpong->roundtrips * (PINGPONG_TRIALS + 1);
+
+	while(__atomic_load_n(&pingpong->state, __ATOMIC_ACQUIRE) == 0)
+		__builtin_ia32_pause();
+
+	if(pingpong->state != 1)
+		return NULL;
+
+	for(uint64_t n = 0; n < total; ++n)
+		handoff(pingpong, 2 * n + 1);
+
+	return NULL;
+}
+
+// best round trip time in ns between the calling thread pinned to first and a responder pinned to second
+static double roundtrip(uint32_t first, uint32_t second, uint32_t roundtrips, int cas)
+{
+	pingpong_t pingpong;
+	pthread_t thread;
+
+	memset(&pingpong, 0, sizeof(pingpong));
+	pingpong.roundtrips = roundtrips;
+	pingpong.cas = cas;
+
+	if(!placement_pin_thread(pthread_self(), first))
+		return -1.0;
+
+	if(pthread_create(&thread, NULL, responder, &pingpong) != 0)
+		return -1.0;
+
+	// an unpinned responder could share the cpu of the caller
+	int pinned = placement_pin_thread(thread, second);
+
+	__atomic_store_n(&pingpong.state, pinned ? 1 : 2, __ATOMIC_RELEASE);
+
+	if(!pinned)
+	{
+		pthread_join(thread, NULL);
+
+		return -1.0;
+	}
+
+	double best = -1.0;
+	uint64_t n = 0;
+
+	// the first trial only warms up both the threads on their cpus
+	for(uint32_t t = 0; t <= PINGPONG_TRIALS; ++t)
+	{
+		uint64_t start = timer_ns();
+
+		for(uint32_t r = 0; r < roundtrips; ++r, ++n)
+		{
+			handoff(&pingpong, 2 * n);
+
+			while(__atomic_load_n(&pingpong.flag, __ATOMIC_ACQUIRE) != 2 * n + 2)
+				__builtin_ia32_pause();
+		}
+
+		double elapsed = (double)(timer_ns() - start) / roundtrips;
+
+		if(t != 0 && (best < 0.0 || elapsed < best))
+			best = elapsed;
+	}
+
+	pthread_join(thread, NULL);
+
+	return best;
+}
+
+// the affinity of the calling thread, sized for the configured cpus
+static cpu_set_t* save_affinity(size_t* set_size)
+{
+	uint32_t max_cpus = sysconf(_SC_NPROCESSORS_CONF);
+	cpu_set_t* cpu_set = CPU_ALLOC(max_cpus);
+
+	*set_size = CPU_ALLOC_SIZE(max_cpus);
+
+	if(cpu_set != NULL && pthread_getaffinity_np(pthread_self(), *set_size, cpu_set) != 0)
+	{
+		CPU_FREE(cpu_set);
+
+		return NULL;
+	}
+
+	return cpu_set;
+}
+
+// index of the data or unified cache of a level, -1 if there is none
+static int cache_of_level(const archinfo_t* info, uint32_t level)
+{
+	for(uint32_t i = 0; i < info->caches_cnt; ++i)
+		if(info->caches[i].level == level && info->caches[i].type != 2)
+			return i;
+
+	return -1;
+}
+
+static relation_t relation(const cpu_logical_t* a, const cpu_logical_t* b, int l2, int l3)
+{
+	if(a->package_id != b->package_id)
+		return RELATION_CROSS_PACKAGE;
+
+	if(a->core_id == b->core_id)
+		return RELATION_SMT;
+
+	if(l2 >= 0 && a->cache_instances[l2] == b->cache_instances[l2])
+		return RELATION_L2;
+
+	if(l3 >= 0 && a->cache_instances[l3] == b->cache_instances[l3])
+		return RELATION_L3;
+
+	return RELATION_PACKAGE;
+}
+
+#endif
+
+int c2c_command(int argc, char* argv[])
+{
+	uint32_t roundtrips = PINGPONG_ROUNDTRIPS;
+	int cas = 0;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		if(strcmp(argv[i], "--cas") == 0)
+			cas = 1;
+		else if(atoi(argv[i]) > 0)
+			roundtrips = atoi(argv[i]);
+	}
+
+	archinfo_t info;
+
+	if(!archinfo_query(&info))
+	{
+		printf("CPUID is not supported\n");
+
+		return 1;
+	}
+
+#if defined(__linux__)
+	const cpu_topology_t* topology = &info.topology;
+	uint32_t cpus_cnt = topology->threads_cnt;
+
+	if(cpus_cnt < 2 || topology->cpus == NULL)
+	{
+		printf("At least two logical processors are needed\n");
+		archinfo_free(&info);
+
+		return 1;
+	}
+
+	double* matrix = malloc(cpus_cnt * cpus_cnt * sizeof(double));
+
+	if(matrix == NULL)
+	{
+		archinfo_free(&info);
+
+		return 1;
+	}
+
+	// the pinger moves over every cpu, it is put back where it was allowed to run afterwards
+	size_t set_size;
+	cpu_set_t* affinity = save_affinity(&set_size);
+
+	printf("Handoff: %s, %u round trips\n\n", cas ? "compare and swap" : "store and load", roundtrips);
+	printf("Round trip latency in ns:\n%5s", "");
+
+	for(uint32_t j = 0; j < cpus_cnt; ++j)
+		printf(" %5u", topology->cpus[j].cpu);
+
+	printf("\n");
+
+	// the matrix is symmetric, every pair is measured once
+	for(uint32_t i = 0; i < cpus_cnt; ++i)
+	{
+		printf("%5u", topology->cpus[i].cpu);
+
+		for(uint32_t j = 0; j < cpus_cnt; ++j)
+		{
+			if(j < i)
+				matrix[i * cpus_cnt + j] = matrix[j * cpus_cnt + i];
+			else if(j > i)
+				matrix[i * cpus_cnt + j] = roundtrip(topology->cpus[i].cpu, topology->cpus[j].cpu, roundtrips, cas);
+
+			if(i == j)
+				printf(" %5s", "-");
+			else if(matrix[i * cpus_cnt + j] < 0.0)
+				printf(" %5s", "?");
+			else
+				printf(" %5.0f", matrix[i * cpus_cnt + j]);
+		}
+
+		printf("\n");
+		fflush(stdout);
+	}
+
+	if(affinity != NULL)
+	{
+		pthread_setaffinity_np(pthread_self(), set_size, affinity);
+		CPU_FREE(affinity);
+	}
+
+	// summary of the pairs by their relation
+	int l2 = cache_of_level(&info, 2);
+	int l3 = cache_of_level(&info, 3);
+
+	uint32_t counts[RELATIONS] = { 0 };
+	double sums[RELATIONS] = { 0.0 };
+	double mins[RELATIONS];
+	double maxs[RELATIONS];
+
+	for(uint32_t i = 0; i < cpus_cnt; ++i)
+	{
+		for(uint32_t j = i + 1; j < cpus_cnt; ++j)
+		{
+			double latency = matrix[i * cpus_cnt + j];
+
+			if(latency < 0.0)
+				continue;
+
+			relation_t r = relation(&topology->cpus[i], &topology->cpus[j], l2, l3);
+
+			if(counts[r] == 0 || latency < mins[r])
+				mins[r] = latency;
+
+			if(counts[r] == 0 || latency > maxs[r])
+				maxs[r] = latency;
+
+			sums[r] += latency;
+			counts[r]++;
+		}
+	}
+
+	printf("\n%-15s %7s %8s %8s %8s\n", "Relation", "Pairs", "Min", "Avg", "Max");
+
+	for(uint32_t r = 0; r < RELATIONS; ++r)
+		if(counts[r] != 0)
+			printf("%-15s %7u %8.1f %8.1f %8.1f\n", RelationStrings[r], counts[r], mins[r], sums[r] / counts[r], maxs[r]);
+
+	free(matrix);
+#else
+	printf("The core to core latency needs pthreads\n");
+#endif
+
+	archinfo_free(&info);
+
+	return 0;
+}
@@ -0,0 +1,96 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "archinfo.h"
+#include "commands.h"
+#include "timer.h"
+
+#define COLLECT_RUNS 5
+
+// best time of a few collections in microseconds, the last collection is kept
+static double time_collect(cpu_logical_t** cpus, uint32_t* cpus_cnt, uint32_t flags)
+{
+	uint64_t best = UINT64_MAX;
+
+	for(uint32_t r = 0; r < COLLECT_RUNS; ++r)
+	{
+		free(*cpus);
+
+		uint64_t start = timer_ns();
+
+		*cpus = percpu_collect(cpus_cnt, flags);
+
+		uint64_t elapsed = timer_ns() - start;
+
+		if(elapsed < best)
+			best = elapsed;
+	}
+
+	return (double)best / 1000.0;
+}
+
+int collect_command(int argc, char* argv[])
+{
+	cpu_logical_t* serial = NULL;
+	cpu_logical_t* parallel = NULL;
+
+	uint32_t serial_cnt = 0;
+	uint32_t parallel_cnt = 0;
+
+	double serial_time = time_collect(&serial, &serial_cnt, ARCHINFO_SERIAL);
+	double parallel_time = time_collect(&parallel, &parallel_cnt, 0);
+
+	if(serial == NULL || parallel == NULL)
+	{
+		free(serial);
+		free(parallel);
+
+		return 1;
+	}
+
+	printf("Logical processors: %u\n\n", serial_cnt);
+
+	printf("Serial collection:   %10.1f us\n", serial_time);
+	printf("Parallel collection: %10.1f us\n", parallel_time);
+	printf("Speedup: %.2fx\n\n", serial_time / parallel_time);
+
+	// both the paths must see the same apic ids
+	uint32_t mismatches = (serial_cnt != parallel_cnt);
+
+	for(uint32_t i = 0; i < serial_cnt && i < parallel_cnt; ++i)
+		if(serial[i].apic_id != parallel[i].apic_id)
+			mismatches++;
+
+	free(serial);
+	free(parallel);
+
+	if(mismatches != 0)
+	{
+		printf("The serial and parallel collections differ\n");
+
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,151 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kernels.h"
+#include "dump.h"
+#include "commands.h"
+#include "timer.h"
+
+#define BENCH_LENGTH      4096
+#define BENCH_REPETITIONS 20000
+
+typedef float (*sum_fn_t)(const float*, size_t);
+typedef float (*dot_fn_t)(const float*, const float*, size_t);
+
+// volatile sink so the benchmarked calls are not optimized away
+static volatile float Sink;
+
+static double bench_sum(sum_fn_t fn, const float* x)
+{
+	uint64_t start = timer_ns();
+
+	for(uint32_t r = 0; r < BENCH_REPETITIONS; ++r)
+		Sink = fn(x, BENCH_LENGTH);
+
+	uint64_t elapsed = timer_ns() - start;
+
+	// throughput in elements per nanosecond
+	return (double)BENCH_LENGTH * BENCH_REPETITIONS / (double)elapsed;
+}
+
+static double bench_dot(dot_fn_t fn, const float* x, const float* y)
+{
+	uint64_t start = timer_ns();
+
+	for(uint32_t r = 0; r < BENCH_REPETITIONS; ++r)
+		Sink = fn(x, y, BENCH_LENGTH);
+
+	uint64_t elapsed = timer_ns() - start;
+
+	return (double)BENCH_LENGTH * BENCH_REPETITIONS / (double)elapsed;
+}
+
+static void print_candidates(const char* name, const dispatch_candidate_t* candidates, const float* x, const float* y)
+{
+	const dispatch_candidate_t* selected = dispatch_select(candidates, KERNEL_CANDIDATES);
+	const dispatch_candidate_t* baseline = &candidates[KERNEL_CANDIDATES - 1];
+
+	printf("%s: dispatched to %s\n", name, selected->name);
+
+	double baseline_rate = 0.0;
+
+	// benchmark every supported candidate, the baseline is the last one
+	for(int32_t i = KERNEL_CANDIDATES - 1; i >= 0; --i)
+	{
+		const dispatch_candidate_t* candidate = &candidates[i];
+
+		if(candidate != baseline && !dispatch_supported(candidate))
+		{
+			printf("   %-10s not supported\n", candidate->name);
+
+			continue;
+		}
+
+		double rate = (y == NULL) ? bench_sum((sum_fn_t)candidate->fn, x) : bench_dot((dot_fn_t)candidate->fn, x, y);
+
+		if(candidate == baseline)
+			baseline_rate = rate;
+
+		printf("   %-10s %6.2f Gelem/s  %5.2fx\n", candidate->name, rate, rate / baseline_rate);
+	}
+
+	// benchmark the dispatched entry point, including the function pointer indirection
+	double rate = (y == NULL) ? bench_sum(kernel_sum, x) : bench_dot(kernel_dot, x, y);
+
+	printf("   %-10s %6.2f Gelem/s  %5.2fx\n\n", "Dispatched", rate, rate / baseline_rate);
+}
+
+// print the candidates a dumped cpu would be dispatched to, without running them
+static int replay_dispatch(const char* path)
+{
+	cpuid_dump_t* dump = load_dump(path);
+	archinfo_t info;
+
+	if(dump == NULL || !archinfo_query_dump(&info, dump))
+	{
+		dump_free(dump);
+
+		return 1;
+	}
+
+	printf("Sum: dispatched to %s\n", dispatch_select_for(&info, KernelSumCandidates, KERNEL_CANDIDATES)->name);
+	printf("Dot product: dispatched to %s\n", dispatch_select_for(&info, KernelDotCandidates, KERNEL_CANDIDATES)->name);
+
+	archinfo_free(&info);
+	dump_free(dump);
+
+	return 0;
+}
+
+int dispatch_command(int argc, char* argv[])
+{
+	if(argc > 2 && strcmp(argv[1], "--replay") == 0)
+		return replay_dispatch(argv[2]);
+
+	float* x = malloc(BENCH_LENGTH * sizeof(float));
+	float* y = malloc(BENCH_LENGTH * sizeof(float));
+
+	if(x == NULL || y == NULL)
+	{
+		free(x);
+		free(y);
+
+		return 1;
+	}
+
+	for(uint32_t i = 0; i < BENCH_LENGTH; ++i)
+	{
+		x[i] = (float)(i % 7) * 0.25f;
+		y[i] = (float)(i % 5) * 0.5f;
+	}
+
+	print_candidates("Sum", KernelSumCandidates, x, NULL);
+	print_candidates("Dot product", KernelDotCandidates, x, y);
+
+	free(x);
+	free(y);
+
+	return 0;
+}
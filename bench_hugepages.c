@@ -0,0 +1,278 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "archinfo.h"
+#include "snapshot.h"
+#include "commands.h"
+#include "bench.h"
+#include "timer.h"
+
+#define HUGEPAGES_WORKING_SET_MB 1024
+#define HUGEPAGES_LOADS          (1 << 22)
+#define HUGEPAGES_LINE_SIZE      64
+
+// smallest speedup over the base pages worth a policy change
+#define HUGEPAGES_MIN_GAIN 1.05
+
+static const char* BackingNames[BENCH_PAGES] =
+{
+	"4K",
+	"THP",
+	"2M hugetlb",
+	"1G hugetlb"
+};
+
+// reserved pages of a hugetlb pool
+typedef struct
+{
+	uint32_t size_kb;
+	uint32_t total;
+	uint32_t free;
+
+} hugetlb_pool_t;
+
+// volatile sink so the chase is not optimized away
+static void* volatile Sink;
+
+static hugetlb_pool_t hugetlb_pool(uint32_t size_kb)
+{
+	hugetlb_pool_t pool = { size_kb, 0, 0 };
+	char path[128], line[64];
+
+	snprintf(path, sizeof(path), "/sys/kernel/mm/hugepages/hugepages-%ukB/nr_hugepages", size_kb);
+
+	if(snapshot_read_line(path, line, sizeof(line)))
+		pool.total = strtoul(line, NULL, 10);
+
+	snprintf(path, sizeof(path), "/sys/kernel/mm/hugepages/hugepages-%ukB/free_hugepages", size_kb);
+
+	if(snapshot_read_line(path, line, sizeof(line)))
+		pool.free = strtoul(line, NULL, 10);
+
+	return pool;
+}
+
+// the selected mode of a sysfs setting such as "always [madvise] never"
+static void selected_mode(const char* path, char* mode, size_t size)
+{
+	char line[256];
+
+	snprintf(mode, size, "unavailable");
+
+	if(!snapshot_read_line(path, line, sizeof(line)))
+		return;
+
+	char* open = strchr(line, '[');
+	char* close = (open != NULL) ? strchr(open, ']') : NULL;
+
+	if(close != NULL)
+	{
+		*close = '\0';
+		snprintf(mode, size, "%s", open + 1);
+	}
+}
+
+// kilobytes of a mapping backed by transparent huge pages
+static uint64_t thp_coverage_kb(const void* buffer)
+{
+	FILE* file = fopen("/proc/self/smaps", "r");
+	char line[256];
+	int inside = 0;
+	uint64_t kb = 0;
+
+	if(file == NULL)
+		return 0;
+
+	while(fgets(line, sizeof(line), file) != NULL)
+	{
+		unsigned long long start, end;
+
+		// a mapping header starts the fields of the next mapping
+		if(sscanf(line, "%llx-%llx ", &start, &end) == 2)
+			inside = (start == (uintptr_t)buffer);
+		else if(inside && sscanf(line, "AnonHugePages: %llu kB", &start) == 1)
+			kb = start;
+	}
+
+	fclose(file);
+
+	return kb;
+}
+
+static void print_size(uint64_t bytes)
+{
+	if(bytes >= (1ull << 30))
+		printf("%.1f GB", (double)bytes / (1ull << 30));
+	else
+		printf("%.1f MB", (double)bytes / (1ull << 20));
+}
+
+int hugepages_command(int argc, char* argv[])
+{
+	size_t size = (size_t)((argc > 1) ? strtoul(argv[1], NULL, 10) : HUGEPAGES_WORKING_SET_MB) << 20;
+	archinfo_t info;
+
+	if(size < (2u << 20))
+		size = 2u << 20;
+
+	if(!archinfo_query(&info))
+	{
+		printf("CPUID is not supported\n");
+
+		return 1;
+	}
+
+	bench_pin_current();
+
+	printf("Working set: ");
+	print_size(size);
+	printf("\n\n");
+
+	// the page sizes the data tlbs can map the working set with
+	uint64_t reach[BENCH_PAGES] =
+	{
+		archinfo_tlb_reach(&info, 0, TLB_PAGE_4K),
+		archinfo_tlb_reach(&info, 0, TLB_PAGE_2M),
+		archinfo_tlb_reach(&info, 0, TLB_PAGE_2M),
+		archinfo_tlb_reach(&info, 0, TLB_PAGE_1G)
+	};
+
+	if(info.tlbs_cnt == 0)
+	{
+		printf("TLB reach: unknown, leaf 0x18 is not enumerated\n\n");
+	}
+	else
+	{
+		printf("TLB reach: 4K ");
+		print_size(reach[BENCH_PAGES_4K]);
+		printf(", 2M ");
+		print_size(reach[BENCH_PAGES_2M]);
+		printf(", 1G ");
+		print_size(reach[BENCH_PAGES_1G]);
+		printf("\n\n");
+	}
+
+	char thp[32], defrag[32];
+	selected_mode("/sys/kernel/mm/transparent_hugepage/enabled", thp, sizeof(thp));
+	selected_mode("/sys/kernel/mm/transparent_hugepage/defrag", defrag, sizeof(defrag));
+
+	hugetlb_pool_t pools[BENCH_PAGES] = { { 0 }, { 0 }, hugetlb_pool(2048), hugetlb_pool(1048576) };
+
+	printf("Kernel:\n");
+	printf("   Transparent huge pages: %s, defrag %s\n", thp, defrag);
+	printf("   Hugetlb 2 MB pages: %u reserved, %u free\n", pools[BENCH_PAGES_2M].total, pools[BENCH_PAGES_2M].free);
+	printf("   Hugetlb 1 GB pages: %u reserved, %u free\n\n", pools[BENCH_PAGES_1G].total, pools[BENCH_PAGES_1G].free);
+
+	uint32_t* order = malloc(size / HUGEPAGES_LINE_SIZE * sizeof(uint32_t));
+
+	if(order == NULL)
+	{
+		printf("Cannot allocate the working set\n");
+		archinfo_free(&info);
+
+		return 1;
+	}
+
+	// random dependent loads over the working set, the page walks dominate beyond the tlb reach
+	double ns[BENCH_PAGES] = { 0.0 };
+
+	printf("Random access:\n");
+	printf("   %-12s %10s %9s %9s\n", "Backing", "ns", "Speedup", "Huge");
+
+	for(uint32_t b = 0; b < BENCH_PAGES; ++b)
+	{
+		uint8_t* buffer = bench_alloc_pages(size, (bench_pages_t)b);
+
+		if(buffer == NULL)
+		{
+			printf("   %-12s %10s   not available\n", BackingNames[b], "-");
+
+			continue;
+		}
+
+		bench_chain(buffer, size, HUGEPAGES_LINE_SIZE, order);
+
+		Sink = bench_chase(buffer, HUGEPAGES_LOADS / 4);
+
+		uint64_t start = timer_ns();
+
+		Sink = bench_chase(buffer, HUGEPAGES_LOADS);
+
+		ns[b] = (double)(timer_ns() - start) / HUGEPAGES_LOADS;
+
+		// the share of the buffer the kernel really backed with huge pages
+		double huge = 0.0;
+
+		if(b == BENCH_PAGES_THP)
+			huge = (double)(thp_coverage_kb(buffer) << 10) / (double)size;
+		else if(b != BENCH_PAGES_4K)
+			huge = 1.0;
+
+		printf("   %-12s %10.2f %8.2fx %8.0f%%\n", BackingNames[b], ns[b], ns[BENCH_PAGES_4K] / ns[b], huge * 100.0);
+
+		bench_free_pages(buffer, size, (bench_pages_t)b);
+	}
+
+	free(order);
+
+	// the fastest backing, and what it takes to use it
+	uint32_t best = BENCH_PAGES_4K;
+
+	for(uint32_t b = 1; b < BENCH_PAGES; ++b)
+		if(ns[b] != 0.0 && ns[b] < ns[best])
+			best = b;
+
+	double gain = ns[BENCH_PAGES_4K] / ns[best];
+	size_t page = tlb_page_size((best == BENCH_PAGES_1G) ? TLB_PAGE_1G : TLB_PAGE_2M);
+
+	printf("\nRecommendation: ");
+
+	if(reach[BENCH_PAGES_4K] >= size)
+		printf("keep the base pages, the working set fits the 4K TLB reach\n");
+	else if(gain < HUGEPAGES_MIN_GAIN)
+		printf("keep the base pages, huge pages are %.0f%% faster\n", (gain - 1.0) * 100.0);
+	else if(best == BENCH_PAGES_THP && strcmp(thp, "always") == 0)
+		printf("none, transparent huge pages already back every mapping, %.0f%% faster than base pages\n", (gain - 1.0) * 100.0);
+	else if(best == BENCH_PAGES_THP)
+		printf("madvise(MADV_HUGEPAGE) the arena, %.0f%% faster than base pages\n", (gain - 1.0) * 100.0);
+	else
+		printf("map the arena with MAP_HUGETLB from %zu reserved %s pages, %.0f%% faster than base pages\n",
+		       (size + page - 1) / page, (best == BENCH_PAGES_1G) ? "1 GB" : "2 MB", (gain - 1.0) * 100.0);
+
+	if(gain >= HUGEPAGES_MIN_GAIN)
+		printf("Page walks take about %.0f%% of the base pages access time\n", (1.0 - 1.0 / gain) * 100.0);
+
+	// the larger pages that were not measured
+	if(strcmp(thp, "never") == 0)
+		printf("Transparent huge pages are disabled: echo madvise > /sys/kernel/mm/transparent_hugepage/enabled\n");
+
+	if(ns[BENCH_PAGES_1G] == 0.0 && reach[BENCH_PAGES_2M] != 0 && reach[BENCH_PAGES_2M] < size && reach[BENCH_PAGES_1G] >= size)
+		printf("The 2M reach covers %.0f%% of the working set, reserve %zu 1 GB pages to measure them: echo %zu > /sys/kernel/mm/hugepages/hugepages-1048576kB/nr_hugepages\n",
+		       (double)reach[BENCH_PAGES_2M] * 100.0 / (double)size, (size + (1 << 30) - 1) >> 30, (size + (1 << 30) - 1) >> 30);
+
+	archinfo_free(&info);
+
+	return 0;
+}
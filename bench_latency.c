@@ -0,0 +1,249 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "archinfo.h"
+#include "commands.h"
+#include "bench.h"
+#include "timer.h"
+
+#define LATENCY_MIN_SIZE  (4 * 1024)
+#define LATENCY_MAX_SIZES 64
+#define LATENCY_LOADS     (1 << 21)
+
+// latency step between neighbouring working sets that starts a new plateau
+#define PLATEAU_THRESHOLD 1.5
+
+typedef struct
+{
+	size_t size;
+	double ns;
+	double cycles;
+
+	uint32_t plateau;
+
+} latency_row_t;
+
+typedef struct
+{
+	uint32_t first;
+	uint32_t last;
+	double ns;
+	double cycles;
+
+} latency_plateau_t;
+
+// volatile sink so the chase is not optimized away
+static void* volatile Sink;
+
+static uint32_t find_plateaus(latency_row_t* rows, uint32_t rows_cnt, latency_plateau_t* plateaus)
+{
+	uint32_t plateaus_cnt = 0;
+
+	for(uint32_t r = 0; r < rows_cnt; ++r)
+	{
+		// a row much slower than the previous one starts a new plateau
+		if(plateaus_cnt == 0 || rows[r].ns > rows[r - 1].ns * PLATEAU_THRESHOLD)
+			plateaus[plateaus_cnt++].first = r;
+
+		plateaus[plateaus_cnt - 1].last = r;
+		rows[r].plateau = plateaus_cnt - 1;
+	}
+
+	// average the latency of every plateau
+	for(uint32_t p = 0; p < plateaus_cnt; ++p)
+	{
+		plateaus[p].ns = 0.0;
+		plateaus[p].cycles = 0.0;
+
+		for(uint32_t r = plateaus[p].first; r <= plateaus[p].last; ++r)
+		{
+			plateaus[p].ns += rows[r].ns;
+			plateaus[p].cycles += rows[r].cycles;
+		}
+
+		plateaus[p].ns /= plateaus[p].last - plateaus[p].first + 1;
+		plateaus[p].cycles /= plateaus[p].last - plateaus[p].first + 1;
+	}
+
+	return plateaus_cnt;
+}
+
+static void print_plateau(const char* name, const latency_row_t* rows, const latency_plateau_t* plateau)
+{
+	printf("%-28s %7.2f ns %7.1f cycles   plateau %zu KB - %zu KB\n", name, plateau->ns, plateau->cycles,
+	       rows[plateau->first].size >> 10, rows[plateau->last].size >> 10);
+}
+
+int latency_command(int argc, char* argv[])
+{
+	int huge_pages = 0;
+	size_t max_size = 0;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		if(strcmp(argv[i], "--hugepages") == 0)
+			huge_pages = 1;
+		else
+			max_size = (size_t)atoi(argv[i]) << 20;
+	}
+
+	archinfo_t info;
+
+	if(!archinfo_query(&info))
+	{
+		printf("CPUID is not supported\n");
+
+		return 1;
+	}
+
+	// the data and unified caches, ordered by level
+	const cpu_cache_t* caches[MAX_CACHES];
+	uint32_t caches_cnt = 0;
+	uint32_t line_size = 64;
+
+	for(uint32_t i = 0; i < info.caches_cnt; ++i)
+	{
+		if(info.caches[i].type == 2)
+			continue;
+
+		caches[caches_cnt++] = &info.caches[i];
+		line_size = info.caches[i].line_size;
+	}
+
+	// sweep up to four times the largest cache by default
+	if(max_size == 0)
+	{
+		max_size = (caches_cnt != 0) ? (size_t)caches[caches_cnt - 1]->size * 4 : (64 << 20);
+
+		if(max_size < (64 << 20))
+			max_size = 64 << 20;
+
+		if(max_size > (512 << 20))
+			max_size = 512 << 20;
+	}
+
+	uint8_t* buffer = bench_alloc(max_size, huge_pages);
+	uint32_t* order = malloc((max_size / line_size) * sizeof(uint32_t));
+
+	if(buffer == NULL || order == NULL)
+	{
+		printf("Cannot allocate %zu MB\n", max_size >> 20);
+
+		if(buffer != NULL)
+			bench_free(buffer, max_size);
+
+		free(order);
+		archinfo_free(&info);
+
+		return 1;
+	}
+
+	bench_pin_current();
+
+	double ghz = bench_core_ghz();
+
+	printf("Core clock: %.2f GHz, %s pages\n\n", ghz, huge_pages ? "huge" : "base");
+	printf("%12s %10s %12s\n", "Working set", "ns/load", "cycles/load");
+
+	latency_row_t rows[LATENCY_MAX_SIZES];
+	uint32_t rows_cnt = 0;
+
+	// sweep the powers of two and the points halfway between them
+	for(size_t size = LATENCY_MIN_SIZE; size <= max_size && rows_cnt < LATENCY_MAX_SIZES; )
+	{
+		bench_chain(buffer, size, line_size, order);
+
+		// walk the whole chain once to warm the caches and the tlb
+		Sink = bench_chase(buffer, size / line_size);
+
+		uint64_t start = timer_ns();
+
+		Sink = bench_chase(buffer, LATENCY_LOADS);
+
+		uint64_t elapsed = timer_ns() - start;
+
+		latency_row_t* row = &rows[rows_cnt++];
+
+		row->size = size;
+		row->ns = (double)elapsed / LATENCY_LOADS;
+		row->cycles = row->ns * ghz;
+
+		// label the row with the smallest cache the working set fits in
+		const char* level = "Memory";
+		char name[32];
+
+		for(uint32_t c = 0; c < caches_cnt; ++c)
+		{
+			if(size <= caches[c]->size)
+			{
+				snprintf(name, sizeof(name), "L%u %s", caches[c]->level, CacheTypeStrings[caches[c]->type]);
+				level = name;
+
+				break;
+			}
+		}
+
+		printf("%9zu KB %10.2f %12.1f   %s\n", size >> 10, row->ns, row->cycles, level);
+
+		size = ((size & (size - 1)) == 0) ? size + size / 2 : (size / 3) * 4;
+	}
+
+	latency_plateau_t plateaus[LATENCY_MAX_SIZES];
+	uint32_t plateaus_cnt = find_plateaus(rows, rows_cnt, plateaus);
+
+	printf("\nDetected plateaus:\n");
+
+	uint32_t prev_size = 0;
+
+	// every cache is represented by the largest working set well inside it
+	for(uint32_t c = 0; c < caches_cnt; ++c)
+	{
+		int inside = -1;
+
+		for(uint32_t r = 0; r < rows_cnt; ++r)
+			if(rows[r].size > prev_size && rows[r].size <= caches[c]->size / 2)
+				inside = r;
+
+		char name[64];
+		snprintf(name, sizeof(name), "L%u %s (%u KB):", caches[c]->level, CacheTypeStrings[caches[c]->type], caches[c]->size >> 10);
+
+		if(inside < 0)
+			printf("%-28s no working set inside\n", name);
+		else
+			print_plateau(name, rows, &plateaus[rows[inside].plateau]);
+
+		prev_size = caches[c]->size;
+	}
+
+	// the last plateau is the memory one if the sweep went past the caches
+	if(rows_cnt != 0 && rows[rows_cnt - 1].size > prev_size)
+		print_plateau("Memory:", rows, &plateaus[plateaus_cnt - 1]);
+
+	bench_free(buffer, max_size);
+	free(order);
+	archinfo_free(&info);
+
+	return 0;
+}
@@ -0,0 +1,211 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pmu.h"
+#include "dump.h"
+#include "snapshot.h"
+#include "bench.h"
+#include "timer.h"
+#include "commands.h"
+
+#define PMU_CALLS       1000000
+#define PMU_BUFFER_SIZE (64 << 20)
+#define PMU_LINE_SIZE   64
+#define PMU_LOADS       (1 << 20)
+
+// volatile sinks so the timed reads and loads are not optimized away
+static volatile uint64_t Sink;
+static void* volatile Pointer;
+
+static void print_counters(const cpu_pmu_t* pmu)
+{
+	if(pmu->version != 0)
+		printf("Architectural performance monitoring version %u\n", pmu->version);
+
+	printf("General-purpose counters: %u, %u bits\n", pmu->counters, pmu->counter_width);
+
+	if(pmu->fixed_counters != 0 || pmu->fixed_mask != 0)
+		printf("Fixed counters: %u, %u bits, mask 0x%x\n", pmu->fixed_counters, pmu->fixed_width, pmu->fixed_mask);
+
+	if(pmu->version != 0)
+	{
+		printf("Architectural events: ");
+
+		for(uint32_t e = 0; e < PMU_EVENTS; ++e)
+			if((pmu->events >> e) & 0x1)
+				printf("%s ", PmuEventStrings[e]);
+
+		printf("\n");
+	}
+
+	printf("\n");
+}
+
+// average cost of a counter read in nanoseconds
+static double cost(const pmu_counter_t* counter, int slow)
+{
+	uint64_t start = timer_ns();
+
+	for(uint32_t i = 0; i < PMU_CALLS; ++i)
+		Sink = slow ? pmu_read_syscall(counter) : pmu_read(counter);
+
+	return (double)(timer_ns() - start) / PMU_CALLS;
+}
+
+// count the events of a chain of dependent loads over a buffer larger than the caches
+static int measure(const pmu_t* pmu)
+{
+	uint8_t* buffer = bench_alloc(PMU_BUFFER_SIZE, 0);
+	uint32_t* order = malloc(PMU_BUFFER_SIZE / PMU_LINE_SIZE * sizeof(uint32_t));
+
+	if(buffer == NULL || order == NULL)
+	{
+		printf("Cannot allocate %u MB\n", PMU_BUFFER_SIZE >> 20);
+
+		if(buffer != NULL)
+			bench_free(buffer, PMU_BUFFER_SIZE);
+
+		free(order);
+
+		return 0;
+	}
+
+	bench_chain(buffer, PMU_BUFFER_SIZE, PMU_LINE_SIZE, order);
+
+	uint64_t before[PMU_MAX_COUNTERS], after[PMU_MAX_COUNTERS];
+
+	pmu_sample(pmu, before);
+	Pointer = bench_chase(buffer, PMU_LOADS);
+	pmu_sample(pmu, after);
+
+	printf("%u dependent loads over %u MB:\n", PMU_LOADS, PMU_BUFFER_SIZE >> 20);
+
+	for(uint32_t i = 0; i < pmu->counters_cnt; ++i)
+	{
+		const pmu_counter_t* counter = &pmu->counters[i];
+
+		if(counter->fd == -1)
+			printf("   %-16s %14s\n", PmuEventStrings[counter->event], "not counted");
+		else
+			printf("   %-16s %14llu %8.3f/load\n", PmuEventStrings[counter->event], (unsigned long long)(after[i] - before[i]),
+			       (double)(after[i] - before[i]) / PMU_LOADS);
+	}
+
+	printf("\n");
+
+	bench_free(buffer, PMU_BUFFER_SIZE);
+	free(order);
+
+	return 1;
+}
+
+int pmu_command(int argc, char* argv[])
+{
+	const char* replay = NULL;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+			replay = argv[++i];
+		else
+		{
+			printf("Usage: archinfo pmu [--replay <file>]\n");
+
+			return 1;
+		}
+	}
+
+	archinfo_t info;
+	cpuid_dump_t* dump = NULL;
+
+	if(replay != NULL && (dump = load_dump(replay)) == NULL)
+		return 1;
+
+	if((dump != NULL) ? !archinfo_query_dump(&info, dump) : !archinfo_query(&info))
+	{
+		printf("CPUID is not supported\n");
+		dump_free(dump);
+
+		return 1;
+	}
+
+	if(info.pmu.counters == 0)
+		printf("The cpu does not enumerate performance monitoring counters\n\n");
+	else
+		print_counters(&info.pmu);
+
+	archinfo_free(&info);
+
+	// the counters of a dump cannot be opened
+	if(dump != NULL)
+	{
+		dump_free(dump);
+
+		return 0;
+	}
+
+	char line[64];
+
+	if(snapshot_read_line("/proc/sys/kernel/perf_event_paranoid", line, sizeof(line)))
+		printf("perf_event_paranoid: %s\n", line);
+
+	// hybrid cpus have a pmu for every core type
+	if(snapshot_read_line("/sys/bus/event_source/devices/cpu/rdpmc", line, sizeof(line)) ||
+	   snapshot_read_line("/sys/bus/event_source/devices/cpu_core/rdpmc", line, sizeof(line)))
+		printf("rdpmc: %s\n", line);
+
+	bench_pin_current();
+
+	const uint32_t events[] = { PMU_EVENT_CYCLES, PMU_EVENT_INSTRUCTIONS, PMU_EVENT_LLC_MISSES, PMU_EVENT_BRANCH_MISSES };
+	pmu_t pmu;
+
+	if(!pmu_open(&pmu, events, sizeof(events) / sizeof(events[0])))
+	{
+		printf("Counters: cannot be opened, %s\n", strerror(pmu.error));
+
+		return 1;
+	}
+
+	printf("Counters: %u opened, %u read with rdpmc\n\n", pmu.opened_cnt, pmu.rdpmc_cnt);
+
+	int measured = measure(&pmu);
+
+	// compare the two reads on the first opened counter
+	for(uint32_t i = 0; i < pmu.counters_cnt; ++i)
+	{
+		if(pmu.counters[i].fd == -1)
+			continue;
+
+		printf("Cost per read of %s:\n", PmuEventStrings[pmu.counters[i].event]);
+		printf("   %-16s %8.2f ns\n", "pmu_read", cost(&pmu.counters[i], 0));
+		printf("   %-16s %8.2f ns\n", "read", cost(&pmu.counters[i], 1));
+
+		break;
+	}
+
+	pmu_close(&pmu);
+
+	return !measured;
+}
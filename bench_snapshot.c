@@ -0,0 +1,100 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+
+#include "archinfo.h"
+#include "snapshot.h"
+#include "commands.h"
+#include "timer.h"
+
+#define SNAPSHOT_RUNS 20
+
+int snapshot_command(int argc, char* argv[])
+{
+	const char* path = (argc > 1) ? argv[1] : NULL;
+	archinfo_t info;
+
+	// live discovery, every leaf of every cpu
+	uint64_t live = UINT64_MAX;
+
+	for(uint32_t i = 0; i < SNAPSHOT_RUNS; ++i)
+	{
+		uint64_t start = timer_ns();
+
+		if(!archinfo_query(&info))
+		{
+			printf("CPUID is not supported\n");
+
+			return 1;
+		}
+
+		uint64_t elapsed = timer_ns() - start;
+
+		if(elapsed < live)
+			live = elapsed;
+
+		// the last live snapshot refreshes the cache
+		if(i + 1 < SNAPSHOT_RUNS)
+			archinfo_free(&info);
+	}
+
+	int saved = snapshot_save(&info, path);
+	archinfo_free(&info);
+
+	if(!saved)
+	{
+		printf("Cannot write the snapshot cache\n");
+
+		return 1;
+	}
+
+	// mapping the cache, including the key check
+	uint64_t cached = UINT64_MAX;
+	size_t size = 0;
+
+	for(uint32_t i = 0; i < SNAPSHOT_RUNS; ++i)
+	{
+		uint64_t start = timer_ns();
+
+		if(!snapshot_load(&info, path))
+		{
+			printf("Cannot load the snapshot cache\n");
+
+			return 1;
+		}
+
+		uint64_t elapsed = timer_ns() - start;
+
+		if(elapsed < cached)
+			cached = elapsed;
+
+		size = info.mapping_size;
+		archinfo_free(&info);
+	}
+
+	printf("Cache size: %zu bytes\n", size);
+	printf("Live discovery: %8.1f us\n", (double)live / 1e3);
+	printf("Cached load:    %8.1f us\n", (double)cached / 1e3);
+	printf("Speedup:        %8.1fx\n", (double)live / (double)cached);
+
+	return 0;
+}
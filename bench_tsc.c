@@ -0,0 +1,135 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+
+#include "archinfo.h"
+#include "tsc.h"
+#include "commands.h"
+#include "bench.h"
+#include "timer.h"
+
+#define TSC_CALLS          10000000
+#define TSC_VALIDATION_MS  200
+
+// volatile sink so the timed reads are not optimized away
+static volatile uint64_t Sink;
+
+typedef uint64_t (*clock_fn_t)();
+
+static uint64_t read_tsc()
+{
+	return tsc_read();
+}
+
+static uint64_t read_tsc_ordered()
+{
+	return tsc_read_ordered();
+}
+
+static uint64_t read_tsc_ns()
+{
+	return tsc_ns();
+}
+
+static uint64_t read_timer_ns()
+{
+	return timer_ns();
+}
+
+// average cost of a clock read in nanoseconds
+static double cost(clock_fn_t fn)
+{
+	uint64_t start = timer_ns();
+
+	for(uint32_t i = 0; i < TSC_CALLS; ++i)
+		Sink = fn();
+
+	return (double)(timer_ns() - start) / TSC_CALLS;
+}
+
+int tsc_command(int argc, char* argv[])
+{
+	cpu_tsc_t tsc;
+
+	if(!archinfo_tsc(&tsc))
+	{
+		printf("CPUID is not supported\n");
+
+		return 1;
+	}
+
+	bench_pin_current();
+
+	int usable = tsc_init();
+
+	printf("Invariant TSC: %s\n", tsc.invariant ? "yes" : "no");
+
+	// without a crystal the frequency is the base frequency of leaf 0x16
+	if(tsc.crystal != 0)
+		printf("Leaf 0x15 frequency: %.3f MHz, crystal %.3f MHz x %u/%u\n", (double)tsc.frequency / 1e6, (double)tsc.crystal / 1e6, tsc.numerator, tsc.denominator);
+	else if(tsc.frequency != 0)
+		printf("Base frequency: %.3f MHz, leaf 0x15 does not enumerate the crystal\n", (double)tsc.frequency / 1e6);
+	else
+		printf("Leaf 0x15 frequency: not enumerated\n");
+
+	// the enumerated frequency is checked against a longer calibration
+	uint64_t calibrated = tsc_calibrate(TSC_VALIDATION_MS);
+
+	printf("Calibrated frequency: %.3f MHz over %u ms", (double)calibrated / 1e6, TSC_VALIDATION_MS);
+
+	if(tsc.frequency != 0)
+		printf(", %+.0f ppm from the enumerated frequency", ((double)calibrated - (double)tsc.frequency) * 1e6 / (double)tsc.frequency);
+
+	printf("\nClock frequency: %.3f MHz, %s\n\n", (double)TscClock.frequency / 1e6, TscClock.calibrated ? "calibrated" : "enumerated");
+
+	// the tsc clock must stay monotonic and track the raw clock
+	uint64_t previous = tsc_ns();
+	uint32_t backwards = 0;
+
+	uint64_t raw_start = timer_raw_ns();
+	uint64_t tsc_start = tsc_ns();
+
+	while(timer_raw_ns() - raw_start < (uint64_t)TSC_VALIDATION_MS * 1000000)
+	{
+		uint64_t now = tsc_ns();
+
+		backwards += (now < previous);
+		previous = now;
+	}
+
+	double raw_elapsed = (double)(timer_raw_ns() - raw_start);
+	double tsc_elapsed = (double)(tsc_ns() - tsc_start);
+
+	printf("Drift from the raw clock: %+.0f ppm over %u ms\n", (tsc_elapsed - raw_elapsed) * 1e6 / raw_elapsed, TSC_VALIDATION_MS);
+	printf("Backward steps: %u\n\n", backwards);
+
+	printf("Cost per read:\n");
+	printf("   %-16s %6.2f ns\n", "rdtsc", cost(read_tsc));
+	printf("   %-16s %6.2f ns\n", "rdtscp", cost(read_tsc_ordered));
+	printf("   %-16s %6.2f ns\n", "tsc_ns", cost(read_tsc_ns));
+	printf("   %-16s %6.2f ns\n", "clock_gettime", cost(read_timer_ns));
+
+	if(!usable)
+		printf("\nThe TSC is not invariant, tsc_ns() is not a reliable clock on this cpu\n");
+
+	return 0;
+}
@@ -0,0 +1,317 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "archinfo.h"
+#include "commands.h"
+#include "bench.h"
+#include "timer.h"
+
+#define XSAVE_ITERATIONS 200000
+#define XSAVE_RUNS       5
+
+// context switches per second the overhead is expressed at
+#define XSAVE_SWITCH_RATE 100000
+
+typedef enum
+{
+	XSAVE_PLAIN,
+	XSAVE_OPT,
+	XSAVE_COMPACTED,
+
+	XSAVE_VARIANTS
+
+} xsave_variant_t;
+
+typedef enum
+{
+	STATE_CLEAN,
+	STATE_AVX,
+	STATE_AVX512,
+
+	STATES
+
+} xsave_state_t;
+
+static const char* VariantNames[XSAVE_VARIANTS] = { "XSAVE", "XSAVEOPT", "XSAVEC" };
+static const char* StateNames[STATES] = { "Clean", "AVX dirty", "AVX-512 dirty" };
+
+// the restore replaces every vector register, the compiler must not keep values in them
+// the avx-512 registers and the opmasks can only be allocated by an avx-512 build
+#if defined(__AVX512F__)
+	#define AVX512_CLOBBERS \
+		"xmm16", "xmm17", "xmm18", "xmm19", "xmm20", "xmm21", "xmm22", "xmm23", \
+		"xmm24", "xmm25", "xmm26", "xmm27", "xmm28", "xmm29", "xmm30", "xmm31", \
+		"k1", "k2", "k3", "k4", "k5", "k6", "k7",
+	#define DIRTY_CLOBBERS "xmm16", "xmm31", "k1",
+#else
+	#define AVX512_CLOBBERS
+	#define DIRTY_CLOBBERS
+#endif
+
+#define VECTOR_CLOBBERS \
+	"xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", \
+	"xmm8", "xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14", "xmm15", AVX512_CLOBBERS "memory"
+
+static inline void save(xsave_variant_t variant, void* area, uint64_t mask)
+{
+	uint32_t low = (uint32_t)mask, high = (uint32_t)(mask >> 32);
+
+	if(variant == XSAVE_PLAIN)
+		__asm__ __volatile__ ("xsave64 (%0)" : : "r"(area), "a"(low), "d"(high) : "memory");
+	else if(variant == XSAVE_OPT)
+		__asm__ __volatile__ ("xsaveopt64 (%0)" : : "r"(area), "a"(low), "d"(high) : "memory");
+	else
+		__asm__ __volatile__ ("xsavec64 (%0)" : : "r"(area), "a"(low), "d"(high) : "memory");
+}
+
+static inline void restore(const void* area, uint64_t mask)
+{
+	__asm__ __volatile__ ("xrstor64 (%0)" : : "r"(area), "a"((uint32_t)mask), "d"((uint32_t)(mask >> 32)) : VECTOR_CLOBBERS);
+}
+
+// components in use, zero if xgetbv with ecx 1 is not supported
+static uint64_t in_use(const archinfo_t* info)
+{
+	uint32_t eax, edx;
+
+	if(!info->xsave.xgetbv1)
+		return 0;
+
+	__asm__ __volatile__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(1));
+
+	return ((uint64_t)edx << 32) | eax;
+}
+
+// reset the components to their initial configuration, then dirty the registers of a state
+static void set_state(xsave_state_t state, const void* init, uint64_t mask, const void* data)
+{
+	restore(init, mask);
+
+	if(state == STATE_AVX)
+		__asm__ __volatile__ ("vmovdqu (%0), %%ymm0" : : "r"(data) : "xmm0");
+
+	// the upper halves of zmm0-15, zmm16-31 and an opmask are three separate components
+	if(state == STATE_AVX512)
+		__asm__ __volatile__
+		(
+			"vmovdqu64 (%0), %%zmm0\n\t"
+			"vmovdqu64 (%0), %%zmm16\n\t"
+			"vmovdqu64 (%0), %%zmm31\n\t"
+			"kmovw (%0), %%k1\n\t"
+			: : "r"(data) : DIRTY_CLOBBERS "xmm0"
+		);
+}
+
+// best of some runs, the restores keep the state of the registers
+static double measure(xsave_variant_t variant, void* area, uint64_t mask)
+{
+	uint64_t best = UINT64_MAX;
+
+	for(uint32_t r = 0; r < XSAVE_RUNS; ++r)
+	{
+		uint64_t start = timer_ns();
+
+		// a context switch saves the outgoing thread and restores the incoming one
+		for(uint32_t i = 0; i < XSAVE_ITERATIONS; ++i)
+		{
+			save(variant, area, mask);
+			restore(area, mask);
+		}
+
+		uint64_t elapsed = timer_ns() - start;
+
+		if(elapsed < best)
+			best = elapsed;
+	}
+
+	return (double)best / XSAVE_ITERATIONS;
+}
+
+static void print_components(const archinfo_t* info)
+{
+	const cpu_xsave_t* xsave = &info->xsave;
+
+	printf("Components:\n");
+	printf("   %-3s %-20s %6s %7s   %s\n", "#", "Name", "Size", "Offset", "Flags");
+
+	for(uint32_t i = 0; i < XSAVE_COMPONENTS; ++i)
+	{
+		const cpu_xsave_component_t* component = &xsave->components[i];
+		uint64_t bit = 1ull << i;
+
+		if(!((xsave->supported | xsave->supported_xss) & bit))
+			continue;
+
+		printf("   %-3u %-20s %6u %7u  ", i, (XsaveComponentStrings[i] != NULL) ? XsaveComponentStrings[i] : "<Unknown>", component->size, component->offset);
+
+		if(info->xcr0 & bit)
+			printf(" enabled");
+
+		if(component->supervisor)
+			printf(" supervisor");
+
+		if(component->aligned)
+			printf(" aligned");
+
+		if(component->xfd)
+			printf(" xfd");
+
+		printf("\n");
+	}
+
+	printf("\n");
+}
+
+int xsave_command(int argc, char* argv[])
+{
+	archinfo_t info;
+
+	if(!archinfo_query(&info))
+	{
+		printf("CPUID is not supported\n");
+
+		return 1;
+	}
+
+	const cpu_xsave_t* xsave = &info.xsave;
+
+	if(!info.features.ecx.xsave || !info.features.ecx.osxsave)
+	{
+		printf("XSAVE is not enabled by the operating system\n");
+		archinfo_free(&info);
+
+		return 1;
+	}
+
+	printf("XSAVE extensions:%s%s%s%s%s\n", xsave->xsaveopt ? " XSAVEOPT" : "", xsave->xsavec ? " XSAVEC" : "", xsave->xgetbv1 ? " XGETBV1" : "",
+	       xsave->xsaves ? " XSAVES" : "", xsave->xfd ? " XFD" : "");
+	printf("XCR0: 0x%llx, %u bytes standard, %u bytes compacted, %u bytes for every supported component\n\n",
+	       (unsigned long long)info.xcr0, xsave->enabled_size, archinfo_xsave_size(&info, info.xcr0, 1), xsave->max_size);
+
+	print_components(&info);
+
+	// only x87, sse, avx and avx-512: restoring pkru would reset the protection keys of the process
+	// and the amx components are armed with extended feature disable
+	uint64_t mask = info.xcr0 & 0xE7;
+
+	size_t size = (xsave->max_size + 63) & ~(size_t)63;
+	uint8_t* area = aligned_alloc(64, size);
+	uint8_t* init = aligned_alloc(64, size);
+	uint8_t* data = aligned_alloc(64, 64);
+
+	if(area == NULL || init == NULL || data == NULL)
+	{
+		printf("Cannot allocate the save areas\n");
+
+		free(area);
+		free(init);
+		free(data);
+		archinfo_free(&info);
+
+		return 1;
+	}
+
+	// a zero header restores every component to its initial configuration
+	memset(area, 0, size);
+	memset(init, 0, size);
+	memset(data, 0x5A, 64);
+
+	// a valid mxcsr in the legacy region
+	*(uint32_t*)(init + 24) = 0x1F80;
+
+	int variants[XSAVE_VARIANTS] = { 1, xsave->xsaveopt, xsave->xsavec };
+	int states[STATES] = { 1, (mask & 0x6) == 0x6, (mask & 0xE6) == 0xE6 };
+	double ns[STATES][XSAVE_VARIANTS] = { { 0.0 } };
+
+	bench_pin_current();
+
+	printf("Save and restore, ns:\n");
+	printf("   %-14s %6s %6s", "State", "In use", "Bytes");
+
+	for(uint32_t v = 0; v < XSAVE_VARIANTS; ++v)
+		printf(" %9s", VariantNames[v]);
+
+	printf("\n");
+
+	for(uint32_t s = 0; s < STATES; ++s)
+	{
+		if(!states[s])
+			continue;
+
+		set_state((xsave_state_t)s, init, mask, data);
+
+		// the compacted format only writes the components in use
+		uint64_t used = in_use(&info) & mask;
+
+		printf("   %-14s %6llx %6u", StateNames[s], (unsigned long long)used, archinfo_xsave_size(&info, used, 1));
+
+		for(uint32_t v = 0; v < XSAVE_VARIANTS; ++v)
+		{
+			if(!variants[v])
+			{
+				printf(" %9s", "-");
+
+				continue;
+			}
+
+			// xsavec sets the compacted bit of the header, which xsave and xsaveopt never clear
+			memset(area + 512, 0, 64);
+
+			set_state((xsave_state_t)s, init, mask, data);
+
+			ns[s][v] = measure((xsave_variant_t)v, area, mask);
+
+			printf(" %9.1f", ns[s][v]);
+		}
+
+		printf("\n");
+	}
+
+	// leave the vector registers in their initial configuration
+	restore(init, mask);
+
+	// the kernel saves with xsaves, which has the init and modified optimizations of xsavec and xsaveopt
+	xsave_variant_t kernel = xsave->xsavec ? XSAVE_COMPACTED : (xsave->xsaveopt ? XSAVE_OPT : XSAVE_PLAIN);
+
+	for(uint32_t s = STATE_AVX; s < STATES; ++s)
+	{
+		if(!states[s])
+			continue;
+
+		double extra = ns[s][kernel] - ns[STATE_CLEAN][kernel];
+
+		printf("\n%s state adds %.1f ns per context switch over clean state, %.2f%% of a core at %u switches per second",
+		       StateNames[s], extra, extra * XSAVE_SWITCH_RATE / 1e7, XSAVE_SWITCH_RATE);
+	}
+
+	printf("\n");
+
+	free(area);
+	free(init);
+	free(data);
+	archinfo_free(&info);
+
+	return 0;
+}
@@ -0,0 +1,98 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "config.h"
+#include "commands.h"
+
+int config_command(int argc, char* argv[])
+{
+	placement_policy_t policy = PLACEMENT_CORES;
+	config_format_t format = CONFIG_FORMATS;
+
+	if((argc > 1 && atoi(argv[1]) <= 0) ||
+	   (argc > 2 && !placement_policy_parse(argv[2], &policy)) ||
+	   (argc > 3 && !config_format_parse(argv[3], &format)))
+	{
+		printf("Usage: archinfo config [workers] [policy] [format]\n\nPolicies:");
+
+		for(uint32_t i = 0; i < PLACEMENT_POLICIES; ++i)
+			printf(" %s", PlacementPolicyStrings[i]);
+
+		printf("\nFormats:");
+
+		for(uint32_t i = 0; i < CONFIG_FORMATS; ++i)
+			printf(" %s", ConfigFormatStrings[i]);
+
+		printf("\n");
+
+		return 1;
+	}
+
+	archinfo_t info;
+
+	if(!archinfo_query(&info))
+	{
+		printf("CPUID is not supported\n");
+
+		return 1;
+	}
+
+	// one worker per core by default
+	uint32_t workers_cnt = (argc > 1) ? atoi(argv[1]) : info.topology.cores_cnt;
+	uint32_t* cpus = placement_plan(&info, policy, workers_cnt);
+
+	if(cpus == NULL)
+	{
+		archinfo_free(&info);
+
+		return 1;
+	}
+
+	for(uint32_t i = 0; i < CONFIG_FORMATS; ++i)
+	{
+		// print a single configuration without its name if requested
+		if(format != CONFIG_FORMATS && format != i)
+			continue;
+
+		uint32_t length = config_format(&info, cpus, workers_cnt, policy, i, NULL, 0);
+		char* out = malloc(length + 1);
+
+		if(out == NULL)
+			break;
+
+		config_format(&info, cpus, workers_cnt, policy, i, out, length + 1);
+
+		if(format == CONFIG_FORMATS)
+			printf("%-18s %s\n", ConfigFormatStrings[i], out);
+		else
+			printf("%s\n", out);
+
+		free(out);
+	}
+
+	free(cpus);
+	archinfo_free(&info);
+
+	return 0;
+}
@@ -0,0 +1,90 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dump.h"
+#include "commands.h"
+
+cpuid_dump_t* load_dump(const char* path)
+{
+	FILE* file = fopen(path, "r");
+
+	if(file == NULL)
+	{
+		printf("Cannot open %s\n", path);
+
+		return NULL;
+	}
+
+	cpuid_dump_t* dump = dump_read(file);
+
+	fclose(file);
+
+	if(dump == NULL)
+		printf("%s is not a cpuid dump\n", path);
+
+	return dump;
+}
+
+int dump_command(int argc, char* argv[])
+{
+	uint32_t flags = 0;
+	const char* path = NULL;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		if(strcmp(argv[i], "--serial") == 0)
+			flags |= ARCHINFO_SERIAL;
+		else
+			path = argv[i];
+	}
+
+	cpuid_dump_t* dump = dump_capture(flags);
+
+	if(dump == NULL)
+	{
+		printf("Cannot capture the cpuid leaves\n");
+
+		return 1;
+	}
+
+	// write to the standard output without a file name
+	FILE* file = (path != NULL) ? fopen(path, "w") : stdout;
+
+	if(file == NULL)
+	{
+		printf("Cannot open %s\n", path);
+		dump_free(dump);
+
+		return 1;
+	}
+
+	int written = dump_write(dump, file);
+
+	if(file != stdout)
+		written &= (fclose(file) == 0);
+
+	dump_free(dump);
+
+	return written ? 0 : 1;
+}
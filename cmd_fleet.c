@@ -0,0 +1,563 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#if defined(__linux__)
+	#include <unistd.h>
+	#include <pthread.h>
+#endif
+
+#include "archinfo.h"
+#include "dump.h"
+#include "kernels.h"
+#include "commands.h"
+
+#define FLEET_MAX_WORKERS 64
+
+// everything compared between the hosts, hashed to deduplicate them
+typedef struct
+{
+	cpu_vendor_t vendor;
+	char brand[49];
+
+	uint32_t signature;
+	uint32_t family_num;
+	uint32_t model_num;
+
+	cpu_features_t features;
+	cpu_features_ext_t features_ext;
+	uint64_t xcr0;
+
+	// ecx of leaf 0x80000001, for lahf and lzcnt
+	uint32_t ext_ecx;
+
+	uint32_t packages_cnt;
+	uint32_t cores_cnt;
+	uint32_t threads_cnt;
+
+	struct
+	{
+		uint32_t level;
+		uint32_t type;
+		uint32_t size;
+		uint32_t ways;
+		uint32_t instances_cnt;
+
+	} caches[MAX_CACHES];
+
+	uint32_t caches_cnt;
+
+	// candidates selected for the sample kernels
+	uint32_t sum_candidate;
+	uint32_t dot_candidate;
+
+} fleet_profile_t;
+
+typedef struct
+{
+	char* path;
+
+	int decoded;
+	uint64_t hash;
+	fleet_profile_t profile;
+
+} fleet_host_t;
+
+typedef struct
+{
+	fleet_host_t* hosts;
+	uint32_t hosts_cnt;
+
+	// next host to decode, shared by the workers
+	uint32_t next;
+
+} fleet_pool_t;
+
+typedef struct
+{
+	char key[128];
+	uint32_t count;
+
+} fleet_bucket_t;
+
+typedef struct
+{
+	fleet_bucket_t* buckets;
+	uint32_t buckets_cnt;
+	uint32_t capacity;
+
+} fleet_histogram_t;
+
+// fnv-1a of the profile bytes, the profiles are zeroed so the padding does not matter
+static uint64_t hash(const void* data, size_t size)
+{
+	const uint8_t* bytes = data;
+	uint64_t h = 0xCBF29CE484222325ull;
+
+	for(size_t i = 0; i < size; ++i)
+	{
+		h ^= bytes[i];
+		h *= 0x100000001B3ull;
+	}
+
+	return h;
+}
+
+static void profile(fleet_profile_t* profile, const archinfo_t* info, const cpuid_dump_t* dump)
+{
+	uint32_t regs[4];
+
+	memset(profile, 0, sizeof(fleet_profile_t));
+
+	profile->vendor = info->vendor;
+	memcpy(profile->brand, info->brand, sizeof(profile->brand));
+
+	profile->signature = info->signature.value;
+	profile->family_num = info->family_num;
+	profile->model_num = info->model_num;
+
+	profile->features = info->features;
+	profile->features_ext = info->features_ext;
+	profile->xcr0 = info->xcr0;
+
+	dump_leaf(dump, 0, 0x80000001, 0x0, regs);
+	profile->ext_ecx = regs[2];
+
+	profile->packages_cnt = info->topology.packages_cnt;
+	profile->cores_cnt = info->topology.cores_cnt;
+	profile->threads_cnt = info->topology.threads_cnt;
+
+	for(uint32_t i = 0; i < info->caches_cnt; ++i)
+	{
+		profile->caches[i].level = info->caches[i].level;
+		profile->caches[i].type = info->caches[i].type;
+		profile->caches[i].size = info->caches[i].size;
+		profile->caches[i].ways = info->caches[i].ways;
+		profile->caches[i].instances_cnt = info->caches[i].instances_cnt;
+	}
+
+	profile->caches_cnt = info->caches_cnt;
+
+	profile->sum_candidate = dispatch_select_for(info, KernelSumCandidates, KERNEL_CANDIDATES) - KernelSumCandidates;
+	profile->dot_candidate = dispatch_select_for(info, KernelDotCandidates, KERNEL_CANDIDATES) - KernelDotCandidates;
+}
+
+static void decode(fleet_host_t* host)
+{
+	FILE* file = fopen(host->path, "r");
+
+	if(file == NULL)
+		return;
+
+	cpuid_dump_t* dump = dump_read(file);
+	archinfo_t info;
+
+	fclose(file);
+
+	if(dump != NULL && archinfo_query_dump(&info, dump))
+	{
+		profile(&host->profile, &info, dump);
+
+		host->hash = hash(&host->profile, sizeof(fleet_profile_t));
+		host->decoded = 1;
+
+		archinfo_free(&info);
+	}
+
+	dump_free(dump);
+}
+
+static void* fleet_worker(void* arg)
+{
+	fleet_pool_t* pool = arg;
+
+	// the workers take the next host until every one is decoded
+	for(;;)
+	{
+		uint32_t i = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+
+		if(i >= pool->hosts_cnt)
+			break;
+
+		decode(&pool->hosts[i]);
+	}
+
+	return NULL;
+}
+
+static void decode_all(fleet_pool_t* pool, uint32_t workers_cnt)
+{
+#if defined(__linux__)
+	pthread_t threads[FLEET_MAX_WORKERS];
+	uint32_t started = 0;
+
+	for(; started < workers_cnt && started < FLEET_MAX_WORKERS; ++started)
+		if(pthread_create(&threads[started], NULL, fleet_worker, pool) != 0)
+			break;
+
+	// the calling thread decodes too, so the pool works even without workers
+	fleet_worker(pool);
+
+	for(uint32_t i = 0; i < started; ++i)
+		pthread_join(threads[i], NULL);
+#else
+	fleet_worker(pool);
+#endif
+}
+
+static int compare_paths(const void* a, const void* b)
+{
+	return strcmp(((const fleet_host_t*)a)->path, ((const fleet_host_t*)b)->path);
+}
+
+// list the regular files of a directory as hosts sorted by path
+static fleet_host_t* list_hosts(const char* directory, uint32_t* hosts_cnt)
+{
+	DIR* dir = opendir(directory);
+
+	if(dir == NULL)
+		return NULL;
+
+	uint32_t capacity = 64;
+	uint32_t cnt = 0;
+	fleet_host_t* hosts = malloc(capacity * sizeof(fleet_host_t));
+	struct dirent* entry;
+
+	while(hosts != NULL && (entry = readdir(dir)) != NULL)
+	{
+		if(entry->d_name[0] == '.')
+			continue;
+
+		size_t length = strlen(directory) + strlen(entry->d_name) + 2;
+		char* path = malloc(length);
+		struct stat st;
+
+		if(path == NULL)
+			break;
+
+		snprintf(path, length, "%s/%s", directory, entry->d_name);
+
+		if(stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+		{
+			free(path);
+
+			continue;
+		}
+
+		if(cnt == capacity)
+		{
+			capacity *= 2;
+
+			fleet_host_t* grown = realloc(hosts, capacity * sizeof(fleet_host_t));
+
+			if(grown == NULL)
+			{
+				free(path);
+
+				break;
+			}
+
+			hosts = grown;
+		}
+
+		memset(&hosts[cnt], 0, sizeof(fleet_host_t));
+		hosts[cnt++].path = path;
+	}
+
+	closedir(dir);
+
+	if(hosts != NULL)
+		qsort(hosts, cnt, sizeof(fleet_host_t), compare_paths);
+
+	*hosts_cnt = cnt;
+
+	return hosts;
+}
+
+static void histogram_add(fleet_histogram_t* histogram, const char* key, uint32_t count)
+{
+	for(uint32_t i = 0; i < histogram->buckets_cnt; ++i)
+	{
+		if(strcmp(histogram->buckets[i].key, key) == 0)
+		{
+			histogram->buckets[i].count += count;
+
+			return;
+		}
+	}
+
+	if(histogram->buckets_cnt == histogram->capacity)
+	{
+		uint32_t capacity = (histogram->capacity != 0) ? histogram->capacity * 2 : 16;
+		fleet_bucket_t* grown = realloc(histogram->buckets, capacity * sizeof(fleet_bucket_t));
+
+		if(grown == NULL)
+			return;
+
+		histogram->buckets = grown;
+		histogram->capacity = capacity;
+	}
+
+	fleet_bucket_t* bucket = &histogram->buckets[histogram->buckets_cnt++];
+
+	snprintf(bucket->key, sizeof(bucket->key), "%s", key);
+	bucket->count = count;
+}
+
+static int compare_buckets(const void* a, const void* b)
+{
+	const fleet_bucket_t* ba = a;
+	const fleet_bucket_t* bb = b;
+
+	if(ba->count != bb->count)
+		return (ba->count > bb->count) ? -1 : 1;
+
+	return strcmp(ba->key, bb->key);
+}
+
+// print the buckets from the most common and release them
+static void histogram_print(fleet_histogram_t* histogram, const char* title)
+{
+	qsort(histogram->buckets, histogram->buckets_cnt, sizeof(fleet_bucket_t), compare_buckets);
+
+	printf("%s:\n", title);
+
+	for(uint32_t i = 0; i < histogram->buckets_cnt; ++i)
+		printf("   %8u  %s\n", histogram->buckets[i].count, histogram->buckets[i].key);
+
+	printf("\n");
+
+	free(histogram->buckets);
+	memset(histogram, 0, sizeof(fleet_histogram_t));
+}
+
+// highest x86-64 microarchitecture level supported by a set of features
+static uint32_t x86_64_level(const cpu_features_t* features, const cpu_features_ext_t* features_ext, uint32_t ext_ecx)
+{
+	const uint32_t lahf = ext_ecx & 0x1;
+	const uint32_t lzcnt = (ext_ecx >> 5) & 0x1;
+
+	if(!(features->ecx.cmpxchg16b && lahf && features->ecx.popcnt && features->ecx.sse3 &&
+	     features->ecx.ssse3 && features->ecx.sse4_1 && features->ecx.sse4_2))
+		return 1;
+
+	if(!(features->ecx.avx && features_ext->ebx.avx2 && features_ext->ebx.bmi1 && features_ext->ebx.bmi2 &&
+	     features->ecx.f16c && features->ecx.fma && lzcnt && features->ecx.movbe && features->ecx.osxsave))
+		return 2;
+
+	if(!(features_ext->ebx.avx512f && features_ext->ebx.avx512bw && features_ext->ebx.avx512cd &&
+	     features_ext->ebx.avx512dq && features_ext->ebx.avx512vl))
+		return 3;
+
+	return 4;
+}
+
+static void print_common_isa(const fleet_host_t* hosts, uint32_t hosts_cnt)
+{
+	cpu_features_t features;
+	cpu_features_ext_t features_ext;
+	uint32_t ext_ecx = 0xFFFFFFFF;
+
+	memset(&features, 0xFF, sizeof(features));
+	memset(&features_ext, 0xFF, sizeof(features_ext));
+
+	// the features every decoded host supports
+	for(uint32_t i = 0; i < hosts_cnt; ++i)
+	{
+		if(!hosts[i].decoded)
+			continue;
+
+		features.edx.value &= hosts[i].profile.features.edx.value;
+		features.ecx.value &= hosts[i].profile.features.ecx.value;
+		features_ext.ebx.value &= hosts[i].profile.features_ext.ebx.value;
+		features_ext.ecx.value &= hosts[i].profile.features_ext.ecx.value;
+		ext_ecx &= hosts[i].profile.ext_ecx;
+	}
+
+	printf("Common ISA:\n");
+
+	for(uint32_t i = 0; i < EDX_FEATURES_SIZE; ++i)
+		if(features.edx.value & EdxFeatures[i].mask)
+			printf("%s ", EdxFeatures[i].name);
+
+	for(uint32_t i = 0; i < ECX_FEATURES_SIZE; ++i)
+		if(features.ecx.value & EcxFeatures[i].mask)
+			printf("%s ", EcxFeatures[i].name);
+
+	for(uint32_t i = 0; i < EBX_EXT_FEATURES_SIZE; ++i)
+		if(features_ext.ebx.value & EbxExtFeatures[i].mask)
+			printf("%s ", EbxExtFeatures[i].name);
+
+	for(uint32_t i = 0; i < ECX_EXT_FEATURES_SIZE; ++i)
+		if(features_ext.ecx.value & EcxExtFeatures[i].mask)
+			printf("%s ", EcxExtFeatures[i].name);
+
+	uint32_t level = x86_64_level(&features, &features_ext, ext_ecx);
+
+	if(level == 1)
+		printf("\n\nBaseline: -march=x86-64\n\n");
+	else
+		printf("\n\nBaseline: -march=x86-64-v%u\n\n", level);
+}
+
+static void print_report(const fleet_host_t* hosts, uint32_t hosts_cnt)
+{
+	fleet_histogram_t histogram = { 0 };
+	uint32_t decoded = 0;
+	char key[128];
+
+	for(uint32_t i = 0; i < hosts_cnt; ++i)
+		decoded += hosts[i].decoded;
+
+	printf("Hosts: %u decoded, %u failed\n\n", decoded, hosts_cnt - decoded);
+
+	if(decoded == 0)
+		return;
+
+	// identical profiles are grouped by their hash
+	for(uint32_t i = 0; i < hosts_cnt; ++i)
+	{
+		if(!hosts[i].decoded)
+			continue;
+
+		snprintf(key, sizeof(key), "%016llx %s", (unsigned long long)hosts[i].hash, hosts[i].profile.brand);
+		histogram_add(&histogram, key, 1);
+	}
+
+	printf("Unique profiles: %u\n", histogram.buckets_cnt);
+	histogram_print(&histogram, "Profiles");
+
+	print_common_isa(hosts, hosts_cnt);
+
+	for(uint32_t i = 0; i < hosts_cnt; ++i)
+	{
+		const fleet_profile_t* profile = &hosts[i].profile;
+
+		if(!hosts[i].decoded)
+			continue;
+
+		snprintf(key, sizeof(key), "%s %s (family %X, model %X)", profile->vendor.id,
+		         microarch_name(archinfo_vendor(&profile->vendor), profile->family_num, profile->model_num), profile->family_num, profile->model_num);
+		histogram_add(&histogram, key, 1);
+	}
+
+	histogram_print(&histogram, "Microarchitectures");
+
+	for(uint32_t i = 0; i < hosts_cnt; ++i)
+	{
+		if(!hosts[i].decoded)
+			continue;
+
+		snprintf(key, sizeof(key), "Sum %s", KernelSumCandidates[hosts[i].profile.sum_candidate].name);
+		histogram_add(&histogram, key, 1);
+
+		snprintf(key, sizeof(key), "Dot product %s", KernelDotCandidates[hosts[i].profile.dot_candidate].name);
+		histogram_add(&histogram, key, 1);
+	}
+
+	histogram_print(&histogram, "Dispatched kernels");
+
+	for(uint32_t i = 0; i < hosts_cnt; ++i)
+	{
+		const fleet_profile_t* profile = &hosts[i].profile;
+
+		if(!hosts[i].decoded)
+			continue;
+
+		for(uint32_t c = 0; c < profile->caches_cnt; ++c)
+		{
+			snprintf(key, sizeof(key), "L%u %s %u KB, %u-way, %u instances", profile->caches[c].level, CacheTypeStrings[profile->caches[c].type],
+			         profile->caches[c].size >> 10, profile->caches[c].ways, profile->caches[c].instances_cnt);
+			histogram_add(&histogram, key, 1);
+		}
+	}
+
+	histogram_print(&histogram, "Caches");
+
+	for(uint32_t i = 0; i < hosts_cnt; ++i)
+	{
+		const fleet_profile_t* profile = &hosts[i].profile;
+
+		if(!hosts[i].decoded)
+			continue;
+
+		snprintf(key, sizeof(key), "%u packages, %u cores, %u threads", profile->packages_cnt, profile->cores_cnt, profile->threads_cnt);
+		histogram_add(&histogram, key, 1);
+	}
+
+	histogram_print(&histogram, "Topologies");
+
+	if(decoded != hosts_cnt)
+	{
+		printf("Failed:\n");
+
+		for(uint32_t i = 0; i < hosts_cnt; ++i)
+			if(!hosts[i].decoded)
+				printf("   %s\n", hosts[i].path);
+
+		printf("\n");
+	}
+}
+
+int fleet_command(int argc, char* argv[])
+{
+	if(argc < 2)
+	{
+		printf("Usage: archinfo fleet <directory> [workers]\n");
+
+		return 1;
+	}
+
+	uint32_t workers_cnt = (argc > 2) ? atoi(argv[2]) : 0;
+
+#if defined(__linux__)
+	if(argc <= 2)
+		workers_cnt = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+	fleet_pool_t pool = { 0 };
+
+	pool.hosts = list_hosts(argv[1], &pool.hosts_cnt);
+
+	if(pool.hosts == NULL)
+	{
+		printf("Cannot list %s\n", argv[1]);
+
+		return 1;
+	}
+
+	// the calling thread is one of the workers
+	decode_all(&pool, (workers_cnt > 1) ? workers_cnt - 1 : 0);
+
+	print_report(pool.hosts, pool.hosts_cnt);
+
+	for(uint32_t i = 0; i < pool.hosts_cnt; ++i)
+		free(pool.hosts[i].path);
+
+	free(pool.hosts);
+
+	return 0;
+}
@@ -0,0 +1,152 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "placement.h"
+#include "dump.h"
+#include "snapshot.h"
+#include "bench.h"
+#include "commands.h"
+
+// maximum frequency of a logical processor in MHz, 0 if cpufreq does not report it
+static uint32_t max_frequency(uint32_t cpu)
+{
+	char path[128], line[64];
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cpufreq/cpuinfo_max_freq", cpu);
+
+	if(!snapshot_read_line(path, line, sizeof(line)))
+		return 0;
+
+	return strtoul(line, NULL, 10) / 1000;
+}
+
+static void print_type(const archinfo_t* info, const cpu_core_type_t* type, int live)
+{
+	const cpu_topology_t* topology = &info->topology;
+
+	uint32_t* cpus = malloc(type->cpus_cnt * sizeof(uint32_t));
+	uint32_t cpus_cnt = 0;
+	uint32_t min_mhz = 0, max_mhz = 0;
+
+	if(cpus == NULL)
+		return;
+
+	// the logical processors of the type and the range of their maximum frequencies
+	for(uint32_t i = 0; i < topology->threads_cnt; ++i)
+	{
+		if(topology->cpus[i].core_type != type->type)
+			continue;
+
+		cpus[cpus_cnt++] = topology->cpus[i].cpu;
+
+		uint32_t mhz = live ? max_frequency(topology->cpus[i].cpu) : 0;
+
+		if(mhz != 0 && (min_mhz == 0 || mhz < min_mhz))
+			min_mhz = mhz;
+
+		if(mhz > max_mhz)
+			max_mhz = mhz;
+	}
+
+	char list[1024];
+	cpulist_format(cpus, cpus_cnt, list, sizeof(list));
+
+	printf("%s, native model 0x%06x:\n", CoreTypeStrings[type->type], type->native_model);
+	printf("   Cores: %u, threads: %u\n", type->cores_cnt, type->cpus_cnt);
+	printf("   CPUs: %s\n", list);
+	printf("   L1 data cache: %u KB, L2 cache: %u KB\n", type->l1d_size / 1024, type->l2_size / 1024);
+
+	if(max_mhz == 0)
+		printf("   Maximum frequency: unknown\n\n");
+	else if(min_mhz == max_mhz)
+		printf("   Maximum frequency: %u MHz\n\n", max_mhz);
+	else
+		printf("   Maximum frequency: %u-%u MHz\n\n", min_mhz, max_mhz);
+
+	free(cpus);
+}
+
+int hybrid_command(int argc, char* argv[])
+{
+	const char* replay = NULL;
+	uint32_t workers_cnt = 0;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+			replay = argv[++i];
+		else if(atoi(argv[i]) > 0)
+			workers_cnt = atoi(argv[i]);
+		else
+		{
+			printf("Usage: archinfo hybrid [workers] [--replay <file>]\n");
+
+			return 1;
+		}
+	}
+
+	archinfo_t info;
+	cpuid_dump_t* dump = NULL;
+
+	if(replay != NULL && (dump = load_dump(replay)) == NULL)
+		return 1;
+
+	if((dump != NULL) ? !archinfo_query_dump(&info, dump) : !archinfo_query(&info))
+	{
+		printf("CPUID is not supported\n");
+		dump_free(dump);
+
+		return 1;
+	}
+
+	if(info.core_types_cnt == 0)
+		printf("The cpu is not hybrid, every core is a performance core\n\n");
+
+	for(uint32_t t = 0; t < info.core_types_cnt; ++t)
+		print_type(&info, &info.core_types[t], dump == NULL);
+
+	// place the latency critical workers, one per performance core by default
+	const cpu_core_type_t* performance = archinfo_core_type(&info, CORE_TYPE_PERFORMANCE);
+
+	if(workers_cnt == 0)
+		workers_cnt = (performance != NULL) ? performance->cores_cnt : info.topology.cores_cnt;
+
+	uint32_t* cpus = placement_plan(&info, PLACEMENT_PERFORMANCE, workers_cnt);
+
+	if(cpus != NULL)
+	{
+		printf("Latency critical workers: %u\nCPUs: ", workers_cnt);
+
+		for(uint32_t w = 0; w < workers_cnt; ++w)
+			printf("%s%u", w ? "," : "", cpus[w]);
+
+		printf("\n");
+	}
+
+	free(cpus);
+	archinfo_free(&info);
+	dump_free(dump);
+
+	return 0;
+}
@@ -0,0 +1,79 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "placement.h"
+#include "commands.h"
+
+int place_command(int argc, char* argv[])
+{
+	placement_policy_t policy = PLACEMENT_COMPACT;
+
+	if(argc < 2 || atoi(argv[1]) <= 0 || (argc > 2 && !placement_policy_parse(argv[2], &policy)))
+	{
+		printf("Usage: archinfo place <workers> [policy]\n\nPolicies:");
+
+		for(uint32_t i = 0; i < PLACEMENT_POLICIES; ++i)
+			printf(" %s", PlacementPolicyStrings[i]);
+
+		printf("\n");
+
+		return 1;
+	}
+
+	uint32_t workers_cnt = atoi(argv[1]);
+
+	archinfo_t info;
+
+	if(!archinfo_query(&info))
+	{
+		printf("CPUID is not supported\n");
+
+		return 1;
+	}
+
+	uint32_t* cpus = placement_plan(&info, policy, workers_cnt);
+
+	if(cpus == NULL)
+	{
+		archinfo_free(&info);
+
+		return 1;
+	}
+
+	printf("Policy: %s\n", PlacementPolicyStrings[policy]);
+	printf("Workers: %u\n\n", workers_cnt);
+
+	// print the cpus in worker order
+	printf("CPUs: ");
+
+	for(uint32_t w = 0; w < workers_cnt; ++w)
+		printf("%s%u", w ? "," : "", cpus[w]);
+
+	printf("\n");
+
+	free(cpus);
+	archinfo_free(&info);
+
+	return 0;
+}
@@ -0,0 +1,232 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "resctrl.h"
+#include "dump.h"
+#include "commands.h"
+
+static void usage()
+{
+	printf("Usage: archinfo rdt [--replay <file>] [--resctrl <dir>] [plan <name>:<share>[:<mba>][@<cpus>]... [--apply]]\n\n");
+	printf("   share    percentage of the l3 ways given exclusively to the class, 0 to share the ones of the default group\n");
+	printf("   mba      percentage of the memory bandwidth, omitted or 100 for no throttling\n");
+	printf("   cpus     cpu list moved to the group of the class\n");
+}
+
+// parse a class as name:share[:mba][@cpus]
+static int parse_class(const char* arg, resctrl_class_t* class)
+{
+	memset(class, 0, sizeof(resctrl_class_t));
+
+	const char* cpus = strchr(arg, '@');
+	const char* share = strchr(arg, ':');
+
+	if(share == NULL || share == arg || (cpus != NULL && cpus < share) || (size_t)(share - arg) >= sizeof(class->name))
+		return 0;
+
+	memcpy(class->name, arg, share - arg);
+
+	// the group is a directory of the resctrl mount
+	if(strchr(class->name, '/') != NULL || strcmp(class->name, "info") == 0 || class->name[0] == '.')
+		return 0;
+
+	char* end;
+	class->share = strtoul(share + 1, &end, 10);
+
+	if(end == share + 1 || class->share > 100)
+		return 0;
+
+	if(*end == ':')
+	{
+		const char* mba = end + 1;
+		class->mba = strtoul(mba, &end, 10);
+
+		if(end == mba || class->mba > 100)
+			return 0;
+	}
+
+	if(*end == '@')
+	{
+		if(strlen(end + 1) >= sizeof(class->cpus))
+			return 0;
+
+		strcpy(class->cpus, end + 1);
+	}
+
+	else if(*end != '\0')
+		return 0;
+
+	return 1;
+}
+
+static void print_cat(const char* level, const cpu_rdt_cat_t* cat)
+{
+	if(cat->cbm_length == 0)
+	{
+		printf("%s allocation: not supported\n", level);
+
+		return;
+	}
+
+	printf("%s allocation: %u-bit masks, %u classes of service, shared ways 0x%x%s%s\n", level, cat->cbm_length, cat->closids,
+	       cat->shared_mask, cat->cdp ? ", CDP" : "", cat->noncontiguous ? ", noncontiguous masks" : "");
+}
+
+static void print_capabilities(const archinfo_t* info)
+{
+	const cpu_rdt_t* rdt = &info->rdt;
+
+	print_cat("L3", &rdt->l3);
+	print_cat("L2", &rdt->l2);
+
+	if(rdt->mba_max != 0)
+		printf("Memory bandwidth allocation: %u classes of service, throttling up to %u%s\n", rdt->mba_closids, rdt->mba_max, rdt->mba_linear ? ", linear" : "");
+	else
+		printf("Memory bandwidth allocation: not supported\n");
+
+	if(rdt->rmids != 0)
+		printf("L3 monitoring: %u RMIDs, %u-bit counters of %u bytes%s%s%s\n", rdt->rmids, rdt->counter_width, rdt->upscaling,
+		       rdt->llc_occupancy ? ", occupancy" : "", rdt->mbm_total ? ", total bandwidth" : "", rdt->mbm_local ? ", local bandwidth" : "");
+	else
+		printf("L3 monitoring: not supported\n");
+}
+
+static void print_plan(const resctrl_t* resctrl, const resctrl_class_t* classes, uint32_t classes_cnt, uint32_t default_mask)
+{
+	char schemata[4096];
+
+	printf("\nPlan (%s %s, %u domains):\n", resctrl->path, resctrl->mounted ? "mounted" : "from cpuid", resctrl->domains_cnt);
+	printf("   %-16s %5s %10s %4s  %s\n", "Group", "Ways", "Mask", "MBA", "CPUs");
+
+	char mba[16];
+
+	for(uint32_t i = 0; i < classes_cnt; ++i)
+	{
+		snprintf(mba, sizeof(mba), "%u", classes[i].mba_planned);
+
+		printf("   %-16s %5u %#10x %4s  %s\n", classes[i].name, classes[i].ways, classes[i].mask, (classes[i].mba_planned != 0) ? mba : "-",
+		       (classes[i].cpus[0] != '\0') ? classes[i].cpus : "-");
+	}
+
+	uint32_t ways = 0;
+
+	for(uint32_t mask = default_mask; mask != 0; mask &= mask - 1)
+		++ways;
+
+	printf("   %-16s %5u %#10x %4s  %s\n\n", "default", ways, default_mask, "-", "remaining");
+
+	// print the schemata written to every group
+	for(uint32_t i = 0; i < classes_cnt; ++i)
+	{
+		resctrl_schemata(resctrl, classes[i].mask, classes[i].mba_planned, schemata, sizeof(schemata));
+		printf("%s/%s/schemata:\n%s", resctrl->path, classes[i].name, schemata);
+	}
+
+	resctrl_schemata(resctrl, default_mask, 0, schemata, sizeof(schemata));
+	printf("%s/schemata:\n%s", resctrl->path, schemata);
+}
+
+int rdt_command(int argc, char* argv[])
+{
+	const char* replay = NULL;
+	const char* path = NULL;
+	int plan = 0, apply = 0;
+
+	resctrl_class_t classes[RESCTRL_MAX_CLASSES];
+	uint32_t classes_cnt = 0;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+			replay = argv[++i];
+		else if(strcmp(argv[i], "--resctrl") == 0 && i + 1 < argc)
+			path = argv[++i];
+		else if(strcmp(argv[i], "--apply") == 0)
+			apply = 1;
+		else if(strcmp(argv[i], "plan") == 0)
+			plan = 1;
+		else if(plan && classes_cnt < RESCTRL_MAX_CLASSES && parse_class(argv[i], &classes[classes_cnt]))
+			++classes_cnt;
+		else
+		{
+			usage();
+
+			return 1;
+		}
+	}
+
+	// applying a dumped cpu would partition another machine
+	if((plan && classes_cnt == 0) || (apply && (!plan || replay != NULL)))
+	{
+		usage();
+
+		return 1;
+	}
+
+	archinfo_t info;
+	cpuid_dump_t* dump = NULL;
+
+	if(replay != NULL && (dump = load_dump(replay)) == NULL)
+		return 1;
+
+	if((dump != NULL) ? !archinfo_query_dump(&info, dump) : !archinfo_query(&info))
+	{
+		printf("CPUID is not supported\n");
+		dump_free(dump);
+
+		return 1;
+	}
+
+	print_capabilities(&info);
+
+	resctrl_t resctrl;
+	resctrl_status_t status = RESCTRL_OK;
+
+	if(plan)
+	{
+		uint32_t default_mask = 0;
+
+		if(!resctrl_open(&resctrl, path, &info))
+			status = RESCTRL_UNSUPPORTED;
+		else if((status = resctrl_plan(&resctrl, classes, classes_cnt, &default_mask)) == RESCTRL_OK)
+			print_plan(&resctrl, classes, classes_cnt, default_mask);
+
+		if(status == RESCTRL_OK && apply)
+		{
+			if(!resctrl.mounted)
+				printf("\n%s is not a mounted resctrl\n", resctrl.path);
+			else if((status = resctrl_apply(&resctrl, classes, classes_cnt, default_mask)) == RESCTRL_OK)
+				printf("\nApplied to %s\n", resctrl.path);
+		}
+
+		if(status != RESCTRL_OK)
+			printf("\nCannot partition the l3: %s\n", ResctrlStatusStrings[status]);
+	}
+
+	archinfo_free(&info);
+	dump_free(dump);
+
+	return (status == RESCTRL_OK && (!apply || resctrl.mounted)) ? 0 : 1;
+}
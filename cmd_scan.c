@@ -0,0 +1,217 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dump.h"
+#include "commands.h"
+
+// names of the bits of the feature words that have a table, the other bits in hexadecimal if unnamed is set
+static void word_names(uint32_t word, uint32_t bits, int unnamed)
+{
+	const feature_t* table = NULL;
+	uint32_t size = 0;
+
+	switch(word)
+	{
+	case CPU_WORD_1_EDX: table = EdxFeatures;    size = EDX_FEATURES_SIZE;     break;
+	case CPU_WORD_1_ECX: table = EcxFeatures;    size = ECX_FEATURES_SIZE;     break;
+	case CPU_WORD_7_EBX: table = EbxExtFeatures; size = EBX_EXT_FEATURES_SIZE; break;
+	case CPU_WORD_7_ECX: table = EcxExtFeatures; size = ECX_EXT_FEATURES_SIZE; break;
+	}
+
+	for(uint32_t i = 0; i < size; ++i)
+	{
+		if(bits & table[i].mask)
+		{
+			printf("%s ", table[i].name);
+			bits &= ~table[i].mask;
+		}
+	}
+
+	// the bits without a name
+	if(unnamed && bits != 0)
+		printf("0x%x ", bits);
+}
+
+static void print_common(const archinfo_t* info)
+{
+	printf("Common features:\n");
+
+	for(uint32_t w = CPU_WORD_1_EDX; w <= CPU_WORD_7_ECX; ++w)
+		word_names(w, info->words_common[w], 0);
+
+	printf("\nXSAVE components: 0x%llx\n\n", ((unsigned long long)info->words_common[CPU_WORD_D_EDX] << 32) | info->words_common[CPU_WORD_D_EAX]);
+}
+
+// print the registers of a group of logical processors that differ from the most common ones
+static void print_group(const uint32_t* cpus, uint32_t cpus_cnt, const uint32_t* words, const uint32_t* majority)
+{
+	char list[1024];
+	cpulist_format(cpus, cpus_cnt, list, sizeof(list));
+
+	printf("   CPUs %s:\n", list);
+
+	for(uint32_t w = 0; w < CPU_WORDS; ++w)
+	{
+		if(words[w] == majority[w])
+			continue;
+
+		printf("      %-14s 0x%08x", CpuWordStrings[w], words[w]);
+
+		if(majority[w] & ~words[w])
+		{
+			printf(", missing ");
+			word_names(w, majority[w] & ~words[w], 1);
+		}
+
+		if(words[w] & ~majority[w])
+		{
+			printf(", extra ");
+			word_names(w, words[w] & ~majority[w], 1);
+		}
+
+		printf("\n");
+	}
+}
+
+static void print_outliers(const archinfo_t* info)
+{
+	const cpu_topology_t* topology = &info->topology;
+
+	uint32_t* cpus = malloc(topology->threads_cnt * sizeof(uint32_t));
+	uint32_t* grouped = calloc(topology->threads_cnt, sizeof(uint32_t));
+
+	if(cpus == NULL || grouped == NULL)
+	{
+		free(cpus);
+		free(grouped);
+
+		return;
+	}
+
+	// the most common registers are the reference of the outliers
+	const uint32_t* majority = NULL;
+	uint32_t majority_cnt = 0;
+
+	for(uint32_t i = 0; i < topology->threads_cnt; ++i)
+	{
+		uint32_t same = 0;
+
+		for(uint32_t j = 0; j < topology->threads_cnt; ++j)
+			same += memcmp(topology->cpus[j].words, topology->cpus[i].words, sizeof(topology->cpus[i].words)) == 0;
+
+		if(same > majority_cnt)
+		{
+			majority = topology->cpus[i].words;
+			majority_cnt = same;
+		}
+	}
+
+	printf("Outliers:\n");
+
+	// group the outliers reporting the same registers
+	for(uint32_t i = 0; i < topology->threads_cnt; ++i)
+	{
+		const uint32_t* words = topology->cpus[i].words;
+
+		if(grouped[i] || memcmp(words, majority, sizeof(topology->cpus[i].words)) == 0)
+			continue;
+
+		uint32_t cpus_cnt = 0;
+
+		for(uint32_t j = i; j < topology->threads_cnt; ++j)
+		{
+			if(!grouped[j] && memcmp(topology->cpus[j].words, words, sizeof(topology->cpus[j].words)) == 0)
+			{
+				grouped[j] = 1;
+				cpus[cpus_cnt++] = topology->cpus[j].cpu;
+			}
+		}
+
+		print_group(cpus, cpus_cnt, words, majority);
+	}
+
+	printf("\n");
+
+	free(cpus);
+	free(grouped);
+}
+
+int scan_command(int argc, char* argv[])
+{
+	const char* replay = NULL;
+	uint32_t flags = 0;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+			replay = argv[++i];
+		else if(strcmp(argv[i], "--serial") == 0)
+			flags |= ARCHINFO_SERIAL;
+		else
+		{
+			printf("Usage: archinfo scan [--serial] [--replay <file>]\n");
+
+			return 1;
+		}
+	}
+
+	archinfo_t info;
+	cpuid_dump_t* dump = NULL;
+
+	if(replay != NULL && (dump = load_dump(replay)) == NULL)
+		return 1;
+
+	if((dump != NULL) ? !archinfo_query_dump(&info, dump) : !archinfo_query_ex(&info, flags))
+	{
+		printf("CPUID is not supported\n");
+		dump_free(dump);
+
+		return 1;
+	}
+
+	printf("Logical processors: %u, %u outliers\n\n", info.topology.threads_cnt, info.outliers_cnt);
+
+	print_common(&info);
+
+	if(info.outliers_cnt != 0)
+		print_outliers(&info);
+
+	// the dispatcher of this process only runs on the scanned cpus
+	if(dump == NULL)
+	{
+		if(archinfo_features_restrict(&info))
+			printf("Dispatch: restricted to the common features\n");
+		else
+			printf("Dispatch: every logical processor supports the features of this one\n");
+	}
+
+	uint32_t outliers_cnt = info.outliers_cnt;
+
+	archinfo_free(&info);
+	dump_free(dump);
+
+	// a heterogeneous machine fails the scan, for provisioning scripts
+	return outliers_cnt != 0;
+}
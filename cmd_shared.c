@@ -0,0 +1,174 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if defined(__linux__)
+	#include <unistd.h>
+	#include <signal.h>
+	#include <time.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shared.h"
+#include "commands.h"
+#include "timer.h"
+
+#define SHARED_INTERVAL_MS 1000
+#define SHARED_READS       1000000
+
+#if defined(__linux__)
+
+static volatile sig_atomic_t Publishing = 1;
+
+static void stop_publishing(int signal)
+{
+	Publishing = 0;
+}
+
+#endif
+
+int publish_command(int argc, char* argv[])
+{
+#if defined(__linux__)
+	uint32_t interval = SHARED_INTERVAL_MS;
+	uint32_t flags = 0;
+	const char* name = NULL;
+	int detach = 0;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		if(strcmp(argv[i], "--name") == 0 && i + 1 < argc)
+			name = argv[++i];
+		else if(strcmp(argv[i], "--detach") == 0)
+			detach = 1;
+		else if(strcmp(argv[i], "--serial") == 0)
+			flags |= ARCHINFO_SERIAL;
+		else
+			interval = strtoul(argv[i], NULL, 10);
+	}
+
+	if(interval == 0)
+		interval = SHARED_INTERVAL_MS;
+
+	// the segment records the pid of the process that keeps it fresh, so detach first
+	if(detach && daemon(0, 0) != 0)
+	{
+		printf("Cannot detach from the terminal\n");
+
+		return 1;
+	}
+
+	shared_publisher_t publisher;
+
+	if(!shared_publish(&publisher, name, flags))
+	{
+		printf("Cannot publish %s, is another process publishing it?\n", (name != NULL) ? name : SHARED_DEFAULT_NAME);
+
+		return 1;
+	}
+
+	signal(SIGINT, stop_publishing);
+	signal(SIGTERM, stop_publishing);
+
+	printf("Publishing %s every %u ms\n", publisher.name, interval);
+	fflush(stdout);
+
+	struct timespec period = { interval / 1000, (interval % 1000) * 1000000l };
+	int status = 0;
+
+	// a signal interrupts the sleep and stops the loop
+	while(Publishing)
+	{
+		nanosleep(&period, NULL);
+
+		if(Publishing && !shared_refresh(&publisher))
+		{
+			printf("Cannot refresh %s\n", publisher.name);
+			status = 1;
+
+			break;
+		}
+	}
+
+	shared_unpublish(&publisher);
+
+	return status;
+#else
+	printf("Publishing needs posix shared memory\n");
+
+	return 1;
+#endif
+}
+
+int shared_command(int argc, char* argv[])
+{
+	const char* name = NULL;
+
+	for(int i = 1; i < argc; ++i)
+		if(strcmp(argv[i], "--name") == 0 && i + 1 < argc)
+			name = argv[++i];
+
+	shared_reader_t reader;
+
+	if(!shared_attach(&reader, name))
+	{
+		printf("No snapshot is published as %s\n", (name != NULL) ? name : SHARED_DEFAULT_NAME);
+
+		return 1;
+	}
+
+	const archinfo_t* info = &reader.info;
+	shared_dynamic_t dynamic;
+
+	int current = shared_read(&reader, &dynamic);
+
+	if(dynamic.updates == 0)
+	{
+		printf("The publisher of %s stopped while writing\n", (name != NULL) ? name : SHARED_DEFAULT_NAME);
+		shared_detach(&reader);
+
+		return 1;
+	}
+
+	printf("Brand: %s\n", info->brand);
+	printf("Topology: %u cores, %u threads\n\n", info->topology.cores_cnt, info->topology.threads_cnt);
+
+	printf("Updates: %llu, %.1f ms ago%s\n", (unsigned long long)dynamic.updates, (double)(timer_ns() - dynamic.timestamp) / 1e6, current ? "" : ", retired");
+	printf("Online cpus: %u\n", dynamic.online_cnt);
+
+	for(uint32_t cpu = 0; cpu < dynamic.frequencies_cnt; ++cpu)
+		if(dynamic.online[cpu / 64] & (1ull << (cpu % 64)))
+			printf("   Cpu %-4u %5u MHz\n", cpu, dynamic.frequencies[cpu]);
+
+	// the cost a reader pays instead of a discovery
+	uint64_t start = timer_ns();
+
+	for(uint32_t i = 0; i < SHARED_READS; ++i)
+		shared_read(&reader, &dynamic);
+
+	printf("\nRead cost: %.1f ns\n", (double)(timer_ns() - start) / SHARED_READS);
+
+	shared_detach(&reader);
+
+	return 0;
+}
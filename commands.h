@@ -0,0 +1,48 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "archinfo.h"
+
+// archinfo subcommands, each one returns the exit status of the program
+int dispatch_command(int argc, char* argv[]);
+int collect_command(int argc, char* argv[]);
+int place_command(int argc, char* argv[]);
+int config_command(int argc, char* argv[]);
+int latency_command(int argc, char* argv[]);
+int bandwidth_command(int argc, char* argv[]);
+int c2c_command(int argc, char* argv[]);
+int tsc_command(int argc, char* argv[]);
+int dump_command(int argc, char* argv[]);
+int fleet_command(int argc, char* argv[]);
+int snapshot_command(int argc, char* argv[]);
+int publish_command(int argc, char* argv[]);
+int shared_command(int argc, char* argv[]);
+int hugepages_command(int argc, char* argv[]);
+int xsave_command(int argc, char* argv[]);
+int rdt_command(int argc, char* argv[]);
+int hybrid_command(int argc, char* argv[]);
+int scan_command(int argc, char* argv[]);
+int pmu_command(int argc, char* argv[]);
+
+// read a dump file for the --replay options, printing the reason of a failure
+cpuid_dump_t* load_dump(const char* path);
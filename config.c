@@ -0,0 +1,241 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "config.h"
+
+const char* ConfigFormatStrings[CONFIG_FORMATS] =
+{
+	"omp-places",
+	"omp-proc-bind",
+	"gomp-cpu-affinity",
+	"taskset",
+	"numactl",
+	"dpdk",
+	"jvm"
+};
+
+int config_format_parse(const char* name, config_format_t* format)
+{
+	for(uint32_t i = 0; i < CONFIG_FORMATS; ++i)
+	{
+		if(strcmp(name, ConfigFormatStrings[i]) == 0)
+		{
+			*format = (config_format_t)i;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void append(char* out, uint32_t size, uint32_t* length, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+
+	// keep counting the length past the end of the buffer
+	int written = vsnprintf((*length < size) ? out + *length : NULL, (*length < size) ? size - *length : 0, format, args);
+
+	va_end(args);
+
+	if(written > 0)
+		*length += written;
+}
+
+static int compare_cpus(const void* a, const void* b)
+{
+	uint32_t x = *(const uint32_t*)a;
+	uint32_t y = *(const uint32_t*)b;
+
+	return (x < y) ? -1 : (x > y);
+}
+
+static const cpu_logical_t* find_cpu(const cpu_topology_t* topology, uint32_t cpu)
+{
+	for(uint32_t i = 0; i < topology->threads_cnt; ++i)
+		if(topology->cpus[i].cpu == cpu)
+			return &topology->cpus[i];
+
+	return NULL;
+}
+
+static uint32_t place_of(const archinfo_t* info, placement_policy_t policy, uint32_t cpu)
+{
+	const cpu_logical_t* logical = find_cpu(&info->topology, cpu);
+
+	if(logical == NULL)
+		return cpu;
+
+	if(policy == PLACEMENT_PACKAGE)
+		return logical->package_id;
+
+	if(policy == PLACEMENT_L3)
+	{
+		int llc = placement_llc(info);
+
+		if(llc >= 0)
+			return logical->cache_instances[llc];
+	}
+
+	return logical->core_id;
+}
+
+static void omp_places(const archinfo_t* info, const uint32_t* cpus, uint32_t cpus_cnt,
+                       placement_policy_t policy, char* out, uint32_t size, uint32_t* length)
+{
+	uint32_t* places = malloc(cpus_cnt * sizeof(uint32_t));
+	uint8_t* done = calloc(cpus_cnt, 1);
+
+	if(places == NULL || done == NULL)
+	{
+		free(places);
+		free(done);
+
+		return;
+	}
+
+	for(uint32_t i = 0; i < cpus_cnt; ++i)
+		places[i] = place_of(info, policy, cpus[i]);
+
+	uint32_t places_cnt = 0;
+
+	// one place per group, in the order the groups appear in the plan
+	for(uint32_t i = 0; i < cpus_cnt; ++i)
+	{
+		if(done[i])
+			continue;
+
+		append(out, size, length, "%s{", places_cnt ? "," : "");
+
+		uint32_t members = 0;
+
+		for(uint32_t k = i; k < cpus_cnt; ++k)
+		{
+			if(done[k] || places[k] != places[i])
+				continue;
+
+			// a cpu planned twice appears once in its place
+			int duplicate = 0;
+
+			for(uint32_t j = i; j < k; ++j)
+				if(cpus[j] == cpus[k] && places[j] == places[i])
+					duplicate = 1;
+
+			if(!duplicate)
+				append(out, size, length, "%s%u", members++ ? "," : "", cpus[k]);
+
+			done[k] = 1;
+		}
+
+		append(out, size, length, "}");
+
+		places_cnt++;
+	}
+
+	free(places);
+	free(done);
+}
+
+uint32_t config_format(const archinfo_t* info, const uint32_t* cpus, uint32_t cpus_cnt,
+                       placement_policy_t policy, config_format_t format, char* out, uint32_t size)
+{
+	uint32_t length = 0;
+
+	if(size != 0)
+		out[0] = '\0';
+
+	if(cpus_cnt == 0)
+		return 0;
+
+	// sorted and unique cpus for the cpu lists
+	uint32_t* sorted = malloc(cpus_cnt * sizeof(uint32_t));
+
+	if(sorted == NULL)
+		return 0;
+
+	memcpy(sorted, cpus, cpus_cnt * sizeof(uint32_t));
+	qsort(sorted, cpus_cnt, sizeof(uint32_t), compare_cpus);
+
+	uint32_t unique_cnt = 1;
+
+	for(uint32_t i = 1; i < cpus_cnt; ++i)
+		if(sorted[i] != sorted[unique_cnt - 1])
+			sorted[unique_cnt++] = sorted[i];
+
+	uint32_t list_length = cpulist_format(sorted, unique_cnt, NULL, 0);
+	char* list = malloc(list_length + 1);
+
+	if(list == NULL)
+	{
+		free(sorted);
+
+		return 0;
+	}
+
+	cpulist_format(sorted, unique_cnt, list, list_length + 1);
+
+	switch(format)
+	{
+	case CONFIG_OMP_PLACES:
+		omp_places(info, cpus, cpus_cnt, policy, out, size, &length);
+		break;
+
+	case CONFIG_OMP_PROC_BIND:
+		append(out, size, &length, "%s", (policy == PLACEMENT_SCATTER) ? "spread" : "close");
+		break;
+
+	case CONFIG_GOMP_CPU_AFFINITY:
+		// the threads are bound in plan order
+		for(uint32_t i = 0; i < cpus_cnt; ++i)
+			append(out, size, &length, "%s%u", i ? " " : "", cpus[i]);
+		break;
+
+	case CONFIG_TASKSET:
+		append(out, size, &length, "taskset -c %s", list);
+		break;
+
+	case CONFIG_NUMACTL:
+		append(out, size, &length, "numactl --physcpubind=%s --localalloc", list);
+		break;
+
+	case CONFIG_DPDK:
+		append(out, size, &length, "-l %s --main-lcore %u", list, cpus[0]);
+		break;
+
+	case CONFIG_JVM:
+		append(out, size, &length, "-XX:ActiveProcessorCount=%u", unique_cnt);
+		break;
+
+	default:
+		break;
+	}
+
+	free(list);
+	free(sorted);
+
+	return length;
+}
@@ -0,0 +1,50 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "placement.h"
+
+// runtime configurations generated from a placement
+typedef enum
+{
+	CONFIG_OMP_PLACES,
+	CONFIG_OMP_PROC_BIND,
+	CONFIG_GOMP_CPU_AFFINITY,
+	CONFIG_TASKSET,
+	CONFIG_NUMACTL,
+	CONFIG_DPDK,
+	CONFIG_JVM,
+
+	CONFIG_FORMATS
+
+} config_format_t;
+
+extern const char* ConfigFormatStrings[CONFIG_FORMATS];
+
+// parse the name of a configuration format, returns 0 if the name is unknown
+int config_format_parse(const char* name, config_format_t* format);
+
+// format the configuration of the cpus planned with a policy
+// the openmp places group the cpus by core, by last level cache for the l3 policy and by package for the package policy
+// returns the length of the configuration, which is truncated to the size of the buffer
+uint32_t config_format(const archinfo_t* info, const uint32_t* cpus, uint32_t cpus_cnt,
+                       placement_policy_t policy, config_format_t format, char* out, uint32_t size);
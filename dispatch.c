@@ -0,0 +1,126 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "dispatch.h"
+
+// functions dispatched so far, resolved again when the features are restricted
+static dispatch_entry_t* DispatchEntries = NULL;
+
+static int satisfies(const cpu_features_t* features, const cpu_features_ext_t* features_ext, const dispatch_candidate_t* candidate)
+{
+	if((features->edx.value & candidate->features.edx.value) != candidate->features.edx.value)
+		return 0;
+
+	if((features->ecx.value & candidate->features.ecx.value) != candidate->features.ecx.value)
+		return 0;
+
+	if((features_ext->ebx.value & candidate->features_ext.ebx.value) != candidate->features_ext.ebx.value)
+		return 0;
+
+	if((features_ext->ecx.value & candidate->features_ext.ecx.value) != candidate->features_ext.ecx.value)
+		return 0;
+
+	return 1;
+}
+
+int dispatch_supported(const dispatch_candidate_t* candidate)
+{
+	cpu_features_t features;
+	cpu_features_ext_t features_ext;
+
+	// get the features validated against the xcr0 state
+	archinfo_features(&features, &features_ext);
+
+	return satisfies(&features, &features_ext, candidate);
+}
+
+const dispatch_candidate_t* dispatch_select(const dispatch_candidate_t* candidates, uint32_t candidates_cnt)
+{
+	// the candidates are ordered from the best to the baseline
+	for(uint32_t i = 0; i + 1 < candidates_cnt; ++i)
+		if(dispatch_supported(&candidates[i]))
+			return &candidates[i];
+
+	return &candidates[candidates_cnt - 1];
+}
+
+void dispatch_resolve(dispatch_entry_t* table, uint32_t entries_cnt)
+{
+	for(uint32_t i = 0; i < entries_cnt; ++i)
+	{
+		const dispatch_candidate_t* candidate = dispatch_select(table[i].candidates, table[i].candidates_cnt);
+
+		__atomic_store_n(table[i].slot, candidate->fn, __ATOMIC_RELEASE);
+	}
+}
+
+dispatch_fn_t dispatch_link(dispatch_entry_t* entry)
+{
+	uint32_t linked = 0;
+
+	// the first caller links the entry, the others wait for it
+	if(__atomic_compare_exchange_n(&entry->linked, &linked, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+	{
+		dispatch_entry_t* head = __atomic_load_n(&DispatchEntries, __ATOMIC_RELAXED);
+
+		do
+			entry->next = head;
+		while(!__atomic_compare_exchange_n(&DispatchEntries, &head, entry, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+		__atomic_store_n(&entry->linked, 2, __ATOMIC_RELEASE);
+	}
+	else
+	{
+		while(__atomic_load_n(&entry->linked, __ATOMIC_ACQUIRE) != 2)
+			__builtin_ia32_pause();
+	}
+
+	// the features are read after the link, so a restriction either sees the entry or is seen here
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	dispatch_fn_t fn = dispatch_select(entry->candidates, entry->candidates_cnt)->fn;
+	dispatch_fn_t patched = NULL;
+
+	// keep the candidate of a restriction that patched the pointer meanwhile
+	if(!__atomic_compare_exchange_n(entry->slot, &patched, fn, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		return patched;
+
+	return fn;
+}
+
+void dispatch_relink()
+{
+	// the entries are read after the features have been narrowed
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	for(dispatch_entry_t* entry = __atomic_load_n(&DispatchEntries, __ATOMIC_ACQUIRE); entry != NULL; entry = entry->next)
+		__atomic_store_n(entry->slot, dispatch_select(entry->candidates, entry->candidates_cnt)->fn, __ATOMIC_RELEASE);
+}
+
+const dispatch_candidate_t* dispatch_select_for(const archinfo_t* info, const dispatch_candidate_t* candidates, uint32_t candidates_cnt)
+{
+	// the snapshot features are validated against its own xcr0
+	for(uint32_t i = 0; i + 1 < candidates_cnt; ++i)
+		if(satisfies(&info->features, &info->features_ext, &candidates[i]))
+			return &candidates[i];
+
+	return &candidates[candidates_cnt - 1];
+}
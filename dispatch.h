@@ -0,0 +1,87 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "archinfo.h"
+
+// generic function pointer of a dispatched implementation
+typedef void (*dispatch_fn_t)();
+
+// implementation of a dispatched function and the features it requires
+typedef struct
+{
+	const char* name;
+	dispatch_fn_t fn;
+
+	cpu_features_t features;
+	cpu_features_ext_t features_ext;
+
+} dispatch_candidate_t;
+
+// dispatched function: a patched pointer and its candidates ordered from the best to the baseline
+typedef struct dispatch_entry
+{
+	const char* name;
+	dispatch_fn_t* slot;
+
+	const dispatch_candidate_t* candidates;
+	uint32_t candidates_cnt;
+
+	// link of the functions resolved again when the features are restricted
+	uint32_t linked;
+	struct dispatch_entry* next;
+
+} dispatch_entry_t;
+
+#define DISPATCH_COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+// define a function resolved on its first call to its best candidate, params and args are parenthesized lists
+// the function pointer is patched again by archinfo_features_restrict(), a gnu ifunc could not be
+#define DISPATCH_FUNCTION(ret, name, params, args, candidates) \
+	static ret (*name##_fn) params = 0; \
+	static dispatch_entry_t name##_entry = { #name, (dispatch_fn_t*)&name##_fn, candidates, DISPATCH_COUNT(candidates), 0, 0 }; \
+	ret name params \
+	{ \
+		ret (*fn) params = __atomic_load_n(&name##_fn, __ATOMIC_ACQUIRE); \
+		if(!fn) \
+			fn = (ret (*) params)dispatch_link(&name##_entry); \
+		return fn args; \
+	}
+
+// check if the validated cpu features satisfy the requirements of a candidate
+int dispatch_supported(const dispatch_candidate_t* candidate);
+
+// select the first supported candidate, the last one is the baseline
+const dispatch_candidate_t* dispatch_select(const dispatch_candidate_t* candidates, uint32_t candidates_cnt);
+
+// select the first candidate supported by the cpu of a snapshot, such as one replayed from a dump
+const dispatch_candidate_t* dispatch_select_for(const archinfo_t* info, const dispatch_candidate_t* candidates, uint32_t candidates_cnt);
+
+// patch the pointer of every entry of a function table with its best candidate
+// the tables are not linked, resolve them again after archinfo_features_restrict()
+void dispatch_resolve(dispatch_entry_t* table, uint32_t entries_cnt);
+
+// link the entry of a dispatched function and patch its pointer, returns the candidate in use
+dispatch_fn_t dispatch_link(dispatch_entry_t* entry);
+
+// patch the pointer of every linked function again with the features published now
+void dispatch_relink();
@@ -0,0 +1,421 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "dump.h"
+
+// highest leaves and subleaves walked by the capture
+#define DUMP_MAX_LEAVES    0x100
+#define DUMP_MAX_SUBLEAVES 64
+
+#define DUMP_HEADER "# archinfo cpuid dump"
+
+static int append(cpuid_dump_cpu_t* cpu, uint32_t* capacity, const cpuid_record_t* record)
+{
+	if(cpu->records_cnt == *capacity)
+	{
+		uint32_t grown_capacity = (*capacity != 0) ? *capacity * 2 : 128;
+		cpuid_record_t* grown = realloc(cpu->records, grown_capacity * sizeof(cpuid_record_t));
+
+		if(grown == NULL)
+			return 0;
+
+		cpu->records = grown;
+		*capacity = grown_capacity;
+	}
+
+	cpu->records[cpu->records_cnt++] = *record;
+
+	return 1;
+}
+
+// number of subleaves to walk, given the subleaf 0 of a leaf
+static uint32_t subleaves_cnt(uint32_t leaf, const cpuid_record_t* first)
+{
+	switch(leaf)
+	{
+		// the maximum subleaf is enumerated in eax
+		case 0x7:
+		case 0x14:
+		case 0x17:
+		case 0x18:
+		case 0x1D:
+		case 0x20:
+		case 0x23:
+			return (first->eax < DUMP_MAX_SUBLEAVES) ? first->eax + 1 : DUMP_MAX_SUBLEAVES;
+
+		// the subleaves of the unsupported state components and resources are zero
+		case 0xD:
+			return DUMP_MAX_SUBLEAVES;
+
+		case 0xF:
+		case 0x10:
+			return 8;
+
+		case 0x12:
+			return 16;
+
+		// walked until a subleaf of null type
+		case 0x4:
+		case 0xB:
+		case 0x1F:
+		case 0x8000001D:
+		case 0x80000026:
+			return DUMP_MAX_SUBLEAVES;
+
+		default:
+			return 1;
+	}
+}
+
+// check if a subleaf terminates the enumeration of its leaf
+static int null_subleaf(uint32_t leaf, const cpuid_record_t* record)
+{
+	switch(leaf)
+	{
+		// cache type
+		case 0x4:
+		case 0x8000001D:
+			return (record->eax & 0x1F) == 0;
+
+		// topology level type
+		case 0xB:
+		case 0x1F:
+		case 0x80000026:
+			return ((record->ecx >> 8) & 0xFF) == 0;
+
+		default:
+			return 0;
+	}
+}
+
+static int capture_leaf(cpuid_dump_cpu_t* cpu, uint32_t* capacity, uint32_t leaf)
+{
+	uint32_t cnt = 1;
+
+	for(uint32_t subleaf = 0; subleaf < cnt; ++subleaf)
+	{
+		cpuid_record_t record = { leaf, subleaf };
+
+		CPUID_EXT(leaf, subleaf, record.eax, record.ebx, record.ecx, record.edx);
+
+		if(subleaf == 0)
+			cnt = subleaves_cnt(leaf, &record);
+
+		if(null_subleaf(leaf, &record))
+			break;
+
+		// the missing records are replayed as zero
+		if((record.eax | record.ebx | record.ecx | record.edx) == 0)
+			continue;
+
+		if(!append(cpu, capacity, &record))
+			return 0;
+	}
+
+	return 1;
+}
+
+static void capture_cpu(cpu_logical_t* logical, uint32_t index, void* arg)
+{
+	cpuid_dump_cpu_t* cpu = &((cpuid_dump_cpu_t*)arg)[index];
+	uint32_t capacity = 0;
+	uint32_t max_leaf, max_ext_leaf, ebx, ecx, edx;
+
+	CPUID(0x0, max_leaf, ebx, ecx, edx);
+	CPUID(0x80000000, max_ext_leaf, ebx, ecx, edx);
+
+	if(max_leaf >= DUMP_MAX_LEAVES)
+		max_leaf = DUMP_MAX_LEAVES - 1;
+
+	if(max_ext_leaf >= 0x80000000 + DUMP_MAX_LEAVES)
+		max_ext_leaf = 0x80000000 + DUMP_MAX_LEAVES - 1;
+
+	int captured = 1;
+
+	for(uint32_t leaf = 0x0; captured && leaf <= max_leaf; ++leaf)
+		captured = capture_leaf(cpu, &capacity, leaf);
+
+	// the extended leaves are valid only if the maximum one is in their range
+	for(uint32_t leaf = 0x80000000; captured && max_ext_leaf >= 0x80000000 && leaf <= max_ext_leaf; ++leaf)
+		captured = capture_leaf(cpu, &capacity, leaf);
+
+	// a partial capture is dropped like a cpu that cannot be visited
+	if(!captured)
+	{
+		free(cpu->records);
+
+		cpu->records = NULL;
+		cpu->records_cnt = 0;
+	}
+}
+
+static uint64_t xcr0_state()
+{
+	uint32_t eax, ebx, ecx, edx;
+
+	// check the osxsave feature
+	CPUID(0x1, eax, ebx, ecx, edx);
+
+	if(!((ecx >> 27) & 1))
+		return 0;
+
+	__asm__
+	(
+		"xorl %%ecx, %%ecx\n\t"
+		"xgetbv\n\t"
+		: "=a"(eax), "=d"(edx)
+		:
+		: "ecx"
+	);
+
+	return ((uint64_t)edx << 32) | eax;
+}
+
+// drop the cpus without records
+static void compact(cpuid_dump_t* dump)
+{
+	uint32_t cnt = 0;
+
+	for(uint32_t i = 0; i < dump->cpus_cnt; ++i)
+		if(dump->cpus[i].records_cnt != 0)
+			dump->cpus[cnt++] = dump->cpus[i];
+
+	dump->cpus_cnt = cnt;
+}
+
+cpuid_dump_t* dump_capture(uint32_t flags)
+{
+	if(!cpuid_available())
+		return NULL;
+
+	uint32_t cpus_cnt = 0;
+	cpu_logical_t* cpus = percpu_collect(&cpus_cnt, flags);
+	cpuid_dump_t* dump = calloc(1, sizeof(cpuid_dump_t));
+
+	if(cpus == NULL || dump == NULL || (dump->cpus = calloc(cpus_cnt + 1, sizeof(cpuid_dump_cpu_t))) == NULL)
+	{
+		free(cpus);
+		free(dump);
+
+		return NULL;
+	}
+
+	dump->cpus_cnt = cpus_cnt;
+
+	for(uint32_t i = 0; i < cpus_cnt; ++i)
+		dump->cpus[i].cpu = cpus[i].cpu;
+
+	// walk the leaves on every cpu, they can differ in the apic ids and on hybrid cpus
+	percpu_run(cpus, cpus_cnt, flags, capture_cpu, dump->cpus);
+
+	free(cpus);
+
+	compact(dump);
+
+	dump->xcr0 = xcr0_state();
+
+	if(dump->cpus_cnt == 0)
+	{
+		dump_free(dump);
+
+		return NULL;
+	}
+
+	return dump;
+}
+
+int dump_write(const cpuid_dump_t* dump, FILE* file)
+{
+	fprintf(file, "%s\n", DUMP_HEADER);
+	fprintf(file, "xcr0 0x%016" PRIx64 "\n", dump->xcr0);
+
+	for(uint32_t i = 0; i < dump->cpus_cnt; ++i)
+	{
+		const cpuid_dump_cpu_t* cpu = &dump->cpus[i];
+
+		fprintf(file, "cpu %u\n", cpu->cpu);
+
+		for(uint32_t r = 0; r < cpu->records_cnt; ++r)
+		{
+			const cpuid_record_t* record = &cpu->records[r];
+
+			fprintf(file, "%08x %08x %08x %08x %08x %08x\n", record->leaf, record->subleaf, record->eax, record->ebx, record->ecx, record->edx);
+		}
+	}
+
+	return !ferror(file);
+}
+
+static int compare_records(const void* a, const void* b)
+{
+	const cpuid_record_t* ra = a;
+	const cpuid_record_t* rb = b;
+
+	if(ra->leaf != rb->leaf)
+		return (ra->leaf < rb->leaf) ? -1 : 1;
+
+	if(ra->subleaf != rb->subleaf)
+		return (ra->subleaf < rb->subleaf) ? -1 : 1;
+
+	return 0;
+}
+
+static cpuid_dump_cpu_t* add_cpu(cpuid_dump_t* dump, uint32_t* capacity, uint32_t number)
+{
+	if(dump->cpus_cnt == *capacity)
+	{
+		uint32_t grown_capacity = (*capacity != 0) ? *capacity * 2 : 16;
+		cpuid_dump_cpu_t* grown = realloc(dump->cpus, grown_capacity * sizeof(cpuid_dump_cpu_t));
+
+		if(grown == NULL)
+			return NULL;
+
+		dump->cpus = grown;
+		*capacity = grown_capacity;
+	}
+
+	cpuid_dump_cpu_t* cpu = &dump->cpus[dump->cpus_cnt++];
+
+	memset(cpu, 0, sizeof(cpuid_dump_cpu_t));
+	cpu->cpu = number;
+
+	return cpu;
+}
+
+cpuid_dump_t* dump_read(FILE* file)
+{
+	cpuid_dump_t* dump = calloc(1, sizeof(cpuid_dump_t));
+
+	if(dump == NULL)
+		return NULL;
+
+	uint32_t cpus_capacity = 0;
+	uint32_t records_capacity = 0;
+	cpuid_dump_cpu_t* cpu = NULL;
+
+	int has_xcr0 = 0;
+	int valid = 1;
+	char line[256];
+
+	while(valid && fgets(line, sizeof(line), file) != NULL)
+	{
+		cpuid_record_t record;
+		uint32_t number;
+
+		// the lines that are not records are skipped, so other tools can comment their dumps
+		if(sscanf(line, "xcr0 %" SCNx64, &dump->xcr0) == 1)
+		{
+			has_xcr0 = 1;
+		}
+		else if(sscanf(line, "cpu %u", &number) == 1 || sscanf(line, "CPU %u:", &number) == 1)
+		{
+			cpu = add_cpu(dump, &cpus_capacity, number);
+			records_capacity = 0;
+			valid = (cpu != NULL);
+		}
+		else if(sscanf(line, " 0x%x 0x%x: eax=0x%x ebx=0x%x ecx=0x%x edx=0x%x", &record.leaf, &record.subleaf, &record.eax, &record.ebx, &record.ecx, &record.edx) == 6 ||
+		        sscanf(line, "%x %x %x %x %x %x", &record.leaf, &record.subleaf, &record.eax, &record.ebx, &record.ecx, &record.edx) == 6)
+		{
+			// the records before the first cpu line belong to cpu 0
+			if(cpu == NULL)
+				cpu = add_cpu(dump, &cpus_capacity, 0);
+
+			valid = (cpu != NULL) && append(cpu, &records_capacity, &record);
+		}
+	}
+
+	compact(dump);
+
+	if(!valid || dump->cpus_cnt == 0)
+	{
+		dump_free(dump);
+
+		return NULL;
+	}
+
+	for(uint32_t i = 0; i < dump->cpus_cnt; ++i)
+		qsort(dump->cpus[i].records, dump->cpus[i].records_cnt, sizeof(cpuid_record_t), compare_records);
+
+	// without xcr0 assume the os enables every state component the cpu supports
+	if(!has_xcr0)
+	{
+		uint32_t leaf_1[4], leaf_d[4];
+
+		dump_leaf(dump, 0, 0x1, 0x0, leaf_1);
+		dump_leaf(dump, 0, 0xD, 0x0, leaf_d);
+
+		if((leaf_1[2] >> 27) & 1)
+			dump->xcr0 = ((uint64_t)leaf_d[3] << 32) | leaf_d[0];
+	}
+
+	return dump;
+}
+
+void dump_free(cpuid_dump_t* dump)
+{
+	if(dump == NULL)
+		return;
+
+	for(uint32_t i = 0; i < dump->cpus_cnt; ++i)
+		free(dump->cpus[i].records);
+
+	free(dump->cpus);
+	free(dump);
+}
+
+void dump_leaf(const cpuid_dump_t* dump, uint32_t cpu, uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+{
+	regs[0] = regs[1] = regs[2] = regs[3] = 0;
+
+	if(cpu >= dump->cpus_cnt)
+		return;
+
+	const cpuid_record_t* records = dump->cpus[cpu].records;
+	uint32_t first = 0;
+	uint32_t last = dump->cpus[cpu].records_cnt;
+	cpuid_record_t key = { leaf, subleaf };
+
+	// binary search of the sorted records
+	while(first < last)
+	{
+		uint32_t middle = first + (last - first) / 2;
+		int order = compare_records(&records[middle], &key);
+
+		if(order == 0)
+		{
+			regs[0] = records[middle].eax;
+			regs[1] = records[middle].ebx;
+			regs[2] = records[middle].ecx;
+			regs[3] = records[middle].edx;
+
+			return;
+		}
+
+		if(order < 0)
+			first = middle + 1;
+		else
+			last = middle;
+	}
+}
@@ -0,0 +1,75 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <stdio.h>
+
+#include "archinfo.h"
+
+// registers of a leaf and subleaf
+typedef struct
+{
+	uint32_t leaf;
+	uint32_t subleaf;
+
+	uint32_t eax;
+	uint32_t ebx;
+	uint32_t ecx;
+	uint32_t edx;
+
+} cpuid_record_t;
+
+// leaves of a logical processor, sorted by leaf and subleaf
+typedef struct
+{
+	uint32_t cpu;
+
+	cpuid_record_t* records;
+	uint32_t records_cnt;
+
+} cpuid_dump_cpu_t;
+
+struct cpuid_dump
+{
+	// xcr0 of the os that captured the dump
+	uint64_t xcr0;
+
+	cpuid_dump_cpu_t* cpus;
+	uint32_t cpus_cnt;
+};
+
+// capture every valid leaf and subleaf of the online logical processors using the ARCHINFO_* flags
+// returns NULL on failure
+cpuid_dump_t* dump_capture(uint32_t flags);
+
+// write a dump as text, one "leaf subleaf eax ebx ecx edx" line per record, returns 0 on failure
+int dump_write(const cpuid_dump_t* dump, FILE* file);
+
+// read a dump written by dump_write() or by "cpuid -r", returns NULL if the file has no records
+// the xcr0 of a dump without one is the set of state components enumerated by leaf 0xD
+cpuid_dump_t* dump_read(FILE* file);
+
+// release a dump
+void dump_free(cpuid_dump_t* dump);
+
+// get the registers of a leaf of the n-th cpu of a dump, zero if the dump does not have it
+void dump_leaf(const cpuid_dump_t* dump, uint32_t cpu, uint32_t leaf, uint32_t subleaf, uint32_t regs[4]);
@@ -0,0 +1,231 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <immintrin.h>
+
+#include "kernels.h"
+
+static float sum_scalar(const float* v, size_t n)
+{
+	float sum = 0.0f;
+
+	for(size_t i = 0; i < n; ++i)
+		sum += v[i];
+
+	return sum;
+}
+
+static float dot_scalar(const float* x, const float* y, size_t n)
+{
+	float sum = 0.0f;
+
+	for(size_t i = 0; i < n; ++i)
+		sum += x[i] * y[i];
+
+	return sum;
+}
+
+__attribute__((target("sse4.2")))
+static float hsum_sse(__m128 v)
+{
+	v = _mm_hadd_ps(v, v);
+	v = _mm_hadd_ps(v, v);
+
+	return _mm_cvtss_f32(v);
+}
+
+__attribute__((target("sse4.2")))
+static float sum_sse42(const float* v, size_t n)
+{
+	__m128 acc0 = _mm_setzero_ps();
+	__m128 acc1 = _mm_setzero_ps();
+	size_t i = 0;
+
+	// two independent accumulators hide the latency of the additions
+	for(; i + 8 <= n; i += 8)
+	{
+		acc0 = _mm_add_ps(acc0, _mm_loadu_ps(v + i));
+		acc1 = _mm_add_ps(acc1, _mm_loadu_ps(v + i + 4));
+	}
+
+	float sum = hsum_sse(_mm_add_ps(acc0, acc1));
+
+	for(; i < n; ++i)
+		sum += v[i];
+
+	return sum;
+}
+
+__attribute__((target("sse4.2")))
+static float dot_sse42(const float* x, const float* y, size_t n)
+{
+	__m128 acc0 = _mm_setzero_ps();
+	__m128 acc1 = _mm_setzero_ps();
+	size_t i = 0;
+
+	for(; i + 8 <= n; i += 8)
+	{
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+		acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(y + i + 4)));
+	}
+
+	float sum = hsum_sse(_mm_add_ps(acc0, acc1));
+
+	for(; i < n; ++i)
+		sum += x[i] * y[i];
+
+	return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static float hsum_avx(__m256 v)
+{
+	__m128 lo = _mm256_castps256_ps128(v);
+	__m128 hi = _mm256_extractf128_ps(v, 1);
+
+	lo = _mm_add_ps(lo, hi);
+	lo = _mm_hadd_ps(lo, lo);
+	lo = _mm_hadd_ps(lo, lo);
+
+	return _mm_cvtss_f32(lo);
+}
+
+__attribute__((target("avx2,fma")))
+static float sum_avx2(const float* v, size_t n)
+{
+	__m256 acc0 = _mm256_setzero_ps();
+	__m256 acc1 = _mm256_setzero_ps();
+	size_t i = 0;
+
+	for(; i + 16 <= n; i += 16)
+	{
+		acc0 = _mm256_add_ps(acc0, _mm256_loadu_ps(v + i));
+		acc1 = _mm256_add_ps(acc1, _mm256_loadu_ps(v + i + 8));
+	}
+
+	float sum = hsum_avx(_mm256_add_ps(acc0, acc1));
+
+	for(; i < n; ++i)
+		sum += v[i];
+
+	return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_avx2(const float* x, const float* y, size_t n)
+{
+	__m256 acc0 = _mm256_setzero_ps();
+	__m256 acc1 = _mm256_setzero_ps();
+	size_t i = 0;
+
+	for(; i + 16 <= n; i += 16)
+	{
+		acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), acc0);
+		acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8), acc1);
+	}
+
+	float sum = hsum_avx(_mm256_add_ps(acc0, acc1));
+
+	for(; i < n; ++i)
+		sum += x[i] * y[i];
+
+	return sum;
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static float sum_avx512(const float* v, size_t n)
+{
+	__m512 acc0 = _mm512_setzero_ps();
+	__m512 acc1 = _mm512_setzero_ps();
+	size_t i = 0;
+
+	for(; i + 32 <= n; i += 32)
+	{
+		acc0 = _mm512_add_ps(acc0, _mm512_loadu_ps(v + i));
+		acc1 = _mm512_add_ps(acc1, _mm512_loadu_ps(v + i + 16));
+	}
+
+	for(; i + 16 <= n; i += 16)
+		acc0 = _mm512_add_ps(acc0, _mm512_loadu_ps(v + i));
+
+	// the tail is loaded with a mask instead of a scalar loop
+	if(i < n)
+	{
+		__mmask16 mask = (__mmask16)((1u << (n - i)) - 1);
+
+		acc1 = _mm512_add_ps(acc1, _mm512_maskz_loadu_ps(mask, v + i));
+	}
+
+	return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static float dot_avx512(const float* x, const float* y, size_t n)
+{
+	__m512 acc0 = _mm512_setzero_ps();
+	__m512 acc1 = _mm512_setzero_ps();
+	size_t i = 0;
+
+	for(; i + 32 <= n; i += 32)
+	{
+		acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), acc0);
+		acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 16), _mm512_loadu_ps(y + i + 16), acc1);
+	}
+
+	for(; i + 16 <= n; i += 16)
+		acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), acc0);
+
+	if(i < n)
+	{
+		__mmask16 mask = (__mmask16)((1u << (n - i)) - 1);
+
+		acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, x + i), _mm512_maskz_loadu_ps(mask, y + i), acc1);
+	}
+
+	return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+#define AVX512_FEATURES .features_ext.ebx = { .avx512f = 1, .avx512bw = 1, .avx512vl = 1 }
+#define AVX2_FEATURES   .features.ecx = { .avx = 1, .fma = 1 }, .features_ext.ebx = { .avx2 = 1 }
+#define SSE42_FEATURES  .features.ecx = { .sse3 = 1, .sse4_2 = 1 }
+
+static const dispatch_candidate_t SumCandidates[KERNEL_CANDIDATES] =
+{
+	{ "AVX-512",  (dispatch_fn_t)sum_avx512, AVX512_FEATURES },
+	{ "AVX2+FMA", (dispatch_fn_t)sum_avx2,   AVX2_FEATURES   },
+	{ "SSE4.2",   (dispatch_fn_t)sum_sse42,  SSE42_FEATURES  },
+	{ "Scalar",   (dispatch_fn_t)sum_scalar                  }
+};
+
+static const dispatch_candidate_t DotCandidates[KERNEL_CANDIDATES] =
+{
+	{ "AVX-512",  (dispatch_fn_t)dot_avx512, AVX512_FEATURES },
+	{ "AVX2+FMA", (dispatch_fn_t)dot_avx2,   AVX2_FEATURES   },
+	{ "SSE4.2",   (dispatch_fn_t)dot_sse42,  SSE42_FEATURES  },
+	{ "Scalar",   (dispatch_fn_t)dot_scalar                  }
+};
+
+const dispatch_candidate_t* const KernelSumCandidates = SumCandidates;
+const dispatch_candidate_t* const KernelDotCandidates = DotCandidates;
+
+DISPATCH_FUNCTION(float, kernel_sum, (const float* v, size_t n), (v, n), SumCandidates)
+
+DISPATCH_FUNCTION(float, kernel_dot, (const float* x, const float* y, size_t n), (x, y, n), DotCandidates)
@@ -0,0 +1,38 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include "dispatch.h"
+
+#define KERNEL_CANDIDATES 4
+
+// implementations of the sample kernels, ordered from the best to the scalar baseline
+extern const dispatch_candidate_t* const KernelSumCandidates;
+extern const dispatch_candidate_t* const KernelDotCandidates;
+
+// sum of a vector, dispatched to the best implementation
+float kernel_sum(const float* v, size_t n);
+
+// dot product of two vectors, dispatched to the best implementation
+float kernel_dot(const float* x, const float* y, size_t n);
@@ -0,0 +1,568 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "archinfo.h"
+#include "dump.h"
+#include "snapshot.h"
+#include "output.h"
+#include "commands.h"
+
+typedef struct
+{
+	const char* name;
+	int (*run)(int argc, char* argv[]);
+	const char* description;
+
+} command_t;
+
+// writer of the machine readable formats, too large for the stack
+static writer_t Output;
+
+void print_vendor(const archinfo_t* info)
+{
+	// print the vendor id
+	printf("Vendor ID: %s\n\n", info->vendor.id);
+}
+
+void print_sign_brand_features(const archinfo_t* info)
+{
+	const cpu_signature_t* signature = &info->signature;
+
+	// print the brand string
+	printf("Brand: %s\n\n", info->brand);
+
+	// print the stepping id, model and family of the cpu
+	printf("Stepping ID: %X\n", signature->stepping);
+	printf("Model: %X\n", signature->model);
+	printf("Family: %X\n", signature->family);
+
+	// check the extended model number
+	if(signature->family == 0x6 || signature->family == 0xF)
+		printf("Extended Model: %X\n", info->model_num);
+
+	// the family with the extended family added, which only applies to the family 0xF of amd and netburst cpus
+	printf("Extended Family: %X\n", info->family_num);
+
+	printf("\n");
+
+	// print informations about the microarchitecture
+	printf("Microarchitecture: %s\n\n", microarch_name(info->vendor_num, info->family_num, info->model_num));
+
+	printf("Features:\n");
+
+	// print the features encoded in edx
+	for(uint32_t i = 0; i < EDX_FEATURES_SIZE; ++i)
+		if(info->features.edx.value & EdxFeatures[i].mask)
+			printf("%s ", EdxFeatures[i].name);
+
+	// print the features encoded in ecx
+	for(uint32_t i = 0; i < ECX_FEATURES_SIZE; ++i)
+		if(info->features.ecx.value & EcxFeatures[i].mask)
+			printf("%s ", EcxFeatures[i].name);
+
+	printf("\n\n");
+}
+
+void print_ext_features(const archinfo_t* info)
+{
+	// check the maximum cpuid leaf
+	if(info->max_leaf < 0x7)
+		return;
+
+	printf("Extended Features:\n");
+
+	// print the extended features encoded in ebx
+	for(uint32_t i = 0; i < EBX_EXT_FEATURES_SIZE; ++i)
+		if(info->features_ext.ebx.value & EbxExtFeatures[i].mask)
+			printf("%s ", EbxExtFeatures[i].name);
+
+	// print the extended features encoded in ecx
+	for(uint32_t i = 0; i < ECX_EXT_FEATURES_SIZE; ++i)
+		if(info->features_ext.ecx.value & EcxExtFeatures[i].mask)
+			printf("%s ", EcxExtFeatures[i].name);
+
+	printf("\n\n");
+}
+
+void print_xsave(const archinfo_t* info)
+{
+	const cpu_xsave_t* xsave = &info->xsave;
+
+	// check the xsave state components leaf
+	if(xsave->enabled_size == 0)
+		return;
+
+	printf("XSAVE:%s%s%s%s%s, %u bytes for XCR0 0x%llx\n\n", xsave->xsaveopt ? " XSAVEOPT" : "", xsave->xsavec ? " XSAVEC" : "",
+	       xsave->xgetbv1 ? " XGETBV1" : "", xsave->xsaves ? " XSAVES" : "", xsave->xfd ? " XFD" : "",
+	       xsave->enabled_size, (unsigned long long)info->xcr0);
+}
+
+void print_outliers(const archinfo_t* info)
+{
+	// the features above are read on a single logical processor
+	if(info->outliers_cnt == 0)
+		return;
+
+	printf("Heterogeneous features: %u of %u logical processors differ from the others, see archinfo scan\n\n", info->outliers_cnt, info->topology.threads_cnt);
+}
+
+void print_rdt(const archinfo_t* info)
+{
+	const cpu_rdt_t* rdt = &info->rdt;
+
+	// check the resource director technology leaves
+	if(rdt->rmids == 0 && rdt->l3.cbm_length == 0 && rdt->l2.cbm_length == 0 && rdt->mba_max == 0)
+		return;
+
+	// separate the resources with commas
+	const char* separator = "RDT: ";
+
+	if(rdt->l3.cbm_length != 0)
+	{
+		printf("%sL3 CAT %u ways %u CLOS%s", separator, rdt->l3.cbm_length, rdt->l3.closids, rdt->l3.cdp ? " CDP" : "");
+		separator = ", ";
+	}
+
+	if(rdt->l2.cbm_length != 0)
+	{
+		printf("%sL2 CAT %u ways %u CLOS%s", separator, rdt->l2.cbm_length, rdt->l2.closids, rdt->l2.cdp ? " CDP" : "");
+		separator = ", ";
+	}
+
+	if(rdt->mba_max != 0)
+	{
+		printf("%sMBA %u CLOS", separator, rdt->mba_closids);
+		separator = ", ";
+	}
+
+	if(rdt->rmids != 0)
+		printf("%s%u RMIDs%s%s%s", separator, rdt->rmids, rdt->llc_occupancy ? " CMT" : "", rdt->mbm_total ? " MBM-total" : "", rdt->mbm_local ? " MBM-local" : "");
+
+	printf("\n\n");
+}
+
+void print_pmu(const archinfo_t* info)
+{
+	const cpu_pmu_t* pmu = &info->pmu;
+
+	// check the performance monitoring leaves
+	if(pmu->counters == 0)
+		return;
+
+	printf("PMU: ");
+
+	if(pmu->version != 0)
+		printf("version %u, ", pmu->version);
+
+	printf("%u counters %u bits", pmu->counters, pmu->counter_width);
+
+	if(pmu->fixed_counters != 0)
+		printf(", %u fixed counters %u bits", pmu->fixed_counters, pmu->fixed_width);
+
+	printf("\n\n");
+}
+
+void print_frequencies(const archinfo_t* info)
+{
+	// check the maximum cpuid leaf
+	if(info->max_leaf < 0x16)
+		return;
+
+	if(info->frequencies.base != 0)
+		printf("Cpu base frequency: %f GHz\n", (float)info->frequencies.base / 1000.0f);
+
+	if(info->frequencies.max != 0)
+		printf("Cpu maximum frequency: %f GHz\n", (float)info->frequencies.max / 1000.0f);
+
+	if(info->frequencies.bus != 0)
+		printf("Bus (reference) frequency: %f MHz\n", (float)info->frequencies.bus);
+
+	printf("\n");
+}
+
+void print_tsc(const archinfo_t* info)
+{
+	printf("Invariant TSC: %s\n", info->tsc.invariant ? "yes" : "no");
+
+	if(info->tsc.frequency != 0)
+		printf("TSC frequency: %f GHz, %u/%u of the crystal clock\n", (double)info->tsc.frequency / 1e9, info->tsc.numerator, info->tsc.denominator);
+
+	printf("\n");
+}
+
+void print_cache_info(const cpu_cache_t* cache)
+{
+	printf("Cache Level %u %s:\n", cache->level, CacheTypeStrings[cache->type]);
+	printf("Size: %u KB, %u partitions\n", cache->size >> 10, cache->partitions);
+	printf("%u sets, %u-way set associative, %u byte line size\n\n", cache->sets, cache->ways, cache->line_size);
+}
+
+void print_single_core_topology(const archinfo_t* info)
+{
+	// print the number of cores and the number of threads
+	printf("Cores: %u\n", 1);
+	printf("Threads: %u\n\n", 1);
+
+	// print the details of all the caches
+	for(uint32_t i = 0; i < info->caches_cnt; ++i)
+		print_cache_info(&info->caches[i]);
+}
+
+void print_multi_core_topology(const archinfo_t* info)
+{
+	const cpu_topology_t* topology = &info->topology;
+
+	// print the number of packages, cores and threads
+	if(topology->packages_cnt > 1)
+		printf("Packages: %u\n", topology->packages_cnt);
+
+	printf("Cores: %u\n", topology->cores_cnt);
+	printf("Threads: %u\n\n", topology->threads_cnt);
+
+	// print the unshared caches of each core
+	for(uint32_t i = 0; i < topology->cores_cnt; ++i)
+	{
+		printf("Core #%u\n", topology->cores_ids[i]);
+
+		for(uint32_t k = 0; k < info->caches_cnt; ++k)
+			if(!info->caches[k].shared)
+				printf("   Cache Level %u %s\n", info->caches[k].level, CacheTypeStrings[info->caches[k].type]);
+	}
+
+	uint32_t shared_caches_cnt = 0;
+
+	// count the caches shared between more cores
+	for(uint32_t k = 0; k < info->caches_cnt; ++k)
+		if(info->caches[k].shared)
+			shared_caches_cnt++;
+
+	if(shared_caches_cnt != 0)
+	{
+		printf("\nShared Caches:\n");
+
+		// print the shared caches and the logical processors sharing each instance
+		for(uint32_t k = 0; k < info->caches_cnt; ++k)
+		{
+			const cpu_cache_t* cache = &info->caches[k];
+
+			if(!cache->shared)
+				continue;
+
+			printf("   Cache Level %u %s\n", cache->level, CacheTypeStrings[cache->type]);
+
+			// the l3 instances of an amd cpu are its core complexes, grouped in dies when the cpu enumerates them
+			const char* instance = (info->vendor_num == VENDOR_AMD && cache->level == 3) ? "CCX" : "Instance";
+			int dies = topology->shifts[TOPOLOGY_DIE] != topology->pkg_shift;
+
+			for(uint32_t j = 0; j < cache->instances_cnt; ++j)
+			{
+				char list[256];
+				cpulist_format(cache->instances[j].cpus, cache->instances[j].cpus_cnt, list, sizeof(list));
+
+				if(dies)
+					printf("      %s #%u, Die #%u, Package #%u: CPUs %s\n", instance, j, cache->instances[j].die_id, cache->instances[j].package_id, list);
+				else
+					printf("      %s #%u, Package #%u: CPUs %s\n", instance, j, cache->instances[j].package_id, list);
+			}
+		}
+	}
+
+	printf("\n");
+
+	// print the details of all the unshared caches
+	for(uint32_t i = 0; i < info->caches_cnt; ++i)
+		if(!info->caches[i].shared)
+			print_cache_info(&info->caches[i]);
+
+	// print the details of all the shared caches
+	for(uint32_t i = 0; i < info->caches_cnt; ++i)
+		if(info->caches[i].shared)
+			print_cache_info(&info->caches[i]);
+}
+
+void print_cache_tlb(const archinfo_t* info)
+{
+	// check the maximum cpuid leaf
+	if(info->max_leaf < 0x2)
+		return;
+
+	printf("Cache and TLB informations:\n");
+
+	for(uint32_t i = 0; i < info->tlb_descriptors_cnt; ++i)
+		printf("%s\n", CacheTlbDescriptors[info->tlb_descriptors[i]]);
+
+	printf("\n");
+}
+
+// print a size with the largest binary unit it is a multiple of
+static void print_bytes(uint64_t bytes)
+{
+	static const char* units[] = { "B", "KB", "MB", "GB", "TB" };
+	uint32_t unit = 0;
+
+	while(unit + 1 < sizeof(units) / sizeof(units[0]) && bytes >= 1024 && bytes % 1024 == 0)
+	{
+		bytes /= 1024;
+		unit++;
+	}
+
+	printf("%llu %s", (unsigned long long)bytes, units[unit]);
+}
+
+void print_hybrid(const archinfo_t* info)
+{
+	// only the hybrid cpus have core types
+	if(info->core_types_cnt == 0)
+		return;
+
+	printf("Hybrid:\n");
+
+	for(uint32_t t = 0; t < info->core_types_cnt; ++t)
+	{
+		const cpu_core_type_t* type = &info->core_types[t];
+
+		printf("   %-6s %3u cores, %3u threads, native model 0x%06x, L1d ", CoreTypeStrings[type->type], type->cores_cnt, type->cpus_cnt, type->native_model);
+		print_bytes(type->l1d_size);
+		printf(", L2 ");
+		print_bytes(type->l2_size);
+		printf("\n");
+	}
+
+	printf("\n");
+}
+
+void print_tlbs(const archinfo_t* info)
+{
+	// only the cpus with leaf 0x18 enumerate their tlbs
+	if(info->tlbs_cnt == 0)
+		return;
+
+	printf("TLBs:\n");
+
+	for(uint32_t i = 0; i < info->tlbs_cnt; ++i)
+	{
+		const cpu_tlb_t* tlb = &info->tlbs[i];
+
+		printf("L%u %s TLB:", tlb->level, TlbTypeStrings[tlb->type]);
+
+		for(uint32_t k = 0; k < TLB_PAGE_SIZES; ++k)
+			if(tlb->pages & (1 << k))
+				printf(" %s", TlbPageStrings[k]);
+
+		if(tlb->fully_associative)
+			printf(" pages, %u entries, fully associative", tlb->entries);
+		else
+			printf(" pages, %u entries, %u-way set associative", tlb->entries, tlb->ways);
+
+		if(tlb->sharing > 1)
+			printf(", shared by %u threads", tlb->sharing);
+
+		printf("\n");
+	}
+
+	// the memory the data tlbs map without a page walk
+	printf("\nTLB reach:");
+
+	for(uint32_t k = 0, printed = 0; k < TLB_PAGE_SIZES; ++k)
+	{
+		uint64_t reach = archinfo_tlb_reach(info, 0, 1 << k);
+
+		if(reach == 0)
+			continue;
+
+		printf("%s %s ", printed++ ? "," : "", TlbPageStrings[k]);
+		print_bytes(reach);
+	}
+
+	printf("\n\n");
+}
+
+void print_info(const archinfo_t* info)
+{
+	// print the cpu vendor id
+	print_vendor(info);
+
+	// print the signature, the brand and the features of the cpu
+	print_sign_brand_features(info);
+
+	// print the extended features of the cpu
+	print_ext_features(info);
+
+	// print the logical processors whose features differ
+	print_outliers(info);
+
+	// print the xsave extensions and the size of the enabled state
+	print_xsave(info);
+
+	// print the cache and memory bandwidth allocation and monitoring capabilities
+	print_rdt(info);
+
+	// print the performance monitoring counters
+	print_pmu(info);
+
+	// print the cpu base and maximum frequencies and the bus frequency
+	print_frequencies(info);
+
+	// print the time stamp counter invariance and frequency
+	print_tsc(info);
+
+	// print informations about the cpu topology
+	if(info->topology.threads_cnt <= 1)
+		print_single_core_topology(info);
+	else
+		print_multi_core_topology(info);
+
+	// print the cores and the private caches of every core type of a hybrid cpu
+	print_hybrid(info);
+
+	// print informations about the cache and the tlb
+	print_cache_tlb(info);
+
+	// print the deterministic tlb parameters and their reach
+	print_tlbs(info);
+}
+
+int info_command(int argc, char* argv[])
+{
+	archinfo_t info;
+	uint32_t flags = 0;
+	const char* replay = NULL;
+	int cached = 0;
+	output_format_t format = OUTPUT_TEXT;
+
+	// collect the per-cpu leaves serially, decode a dump or map the snapshot cache if requested
+	for(int i = 1; i < argc; ++i)
+	{
+		if(strcmp(argv[i], "--serial") == 0)
+			flags |= ARCHINFO_SERIAL;
+		else if(strcmp(argv[i], "--cached") == 0)
+			cached = 1;
+		else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+			replay = argv[++i];
+		else if(strncmp(argv[i], "--format=", 9) == 0 && !output_format_parse(argv[i] + 9, &format))
+		{
+			printf("Unknown format: %s\n", argv[i] + 9);
+
+			return 1;
+		}
+	}
+
+	cpuid_dump_t* dump = NULL;
+
+	if(replay != NULL && (dump = load_dump(replay)) == NULL)
+		return 1;
+
+	// check if the cpuid instruction is available and gather the cpu informations
+	int queried;
+
+	if(dump != NULL)
+		queried = archinfo_query_dump(&info, dump);
+	else if(cached)
+		queried = archinfo_query_cached(&info, NULL, flags);
+	else
+		queried = archinfo_query_ex(&info, flags);
+
+	if(!queried)
+	{
+		printf("CPUID is not supported\n");
+
+		return 1;
+	}
+
+	int status = 0;
+
+	// the machine readable formats go through a single buffered writer
+	if(format == OUTPUT_TEXT)
+	{
+		print_info(&info);
+	}
+	else
+	{
+		writer_init(&Output, stdout);
+
+		status = !((format == OUTPUT_JSON) ? output_json(&info, &Output) : output_binary(&info, &Output));
+	}
+
+	archinfo_free(&info);
+	dump_free(dump);
+
+	return status;
+}
+
+int help_command(int argc, char* argv[]);
+
+const command_t Commands[] =
+{
+	{ "info",      info_command,      "print the cpu informations (default), --serial migrates a single thread, --replay <file> decodes a dump, --cached maps the snapshot cache, --format=json|binary" },
+	{ "dispatch",  dispatch_command,  "benchmark the dispatched kernels against the scalar baseline, --replay <file> only selects them" },
+	{ "collect",   collect_command,   "compare the serial and parallel per-cpu collection times" },
+	{ "place",     place_command,     "plan the cpus of n workers with a placement policy" },
+	{ "config",    config_command,    "print openmp, taskset, numactl, dpdk and jvm settings for a placement" },
+	{ "latency",   latency_command,   "measure the load latency over working sets, [max MB] [--hugepages]" },
+	{ "bandwidth", bandwidth_command, "measure the memory bandwidth per level and over threads, [threads] [policy] [--hugepages]" },
+	{ "c2c",       c2c_command,       "measure the cache line round trip latency of every pair of cpus, [round trips] [--cas]" },
+	{ "tsc",       tsc_command,       "validate the tsc frequency and compare the cost of the clocks" },
+	{ "dump",      dump_command,      "write every cpuid leaf of every cpu to a file or the standard output, [file] [--serial]" },
+	{ "fleet",     fleet_command,     "decode a directory of dumps into a report of the common isa and distributions, <directory> [workers]" },
+	{ "snapshot",  snapshot_command,  "compare the live discovery time with loading the snapshot cache, [file]" },
+	{ "publish",   publish_command,   "publish the snapshot and the online cpus and frequencies in shared memory, [interval ms] [--name <name>] [--detach]" },
+	{ "shared",    shared_command,    "print the published snapshot and the cost of a lock-free read, [--name <name>]" },
+	{ "hugepages", hugepages_command, "measure random access over 4K, THP, 2M and 1G pages and advise a backing, [working set MB]" },
+	{ "xsave",     xsave_command,     "decode the xsave state components and measure the save and restore cost of dirty vector state" },
+	{ "rdt",       rdt_command,       "decode the resource director technology, plan <name>:<share>[:<mba>][@<cpus>]... partitions the l3 over resctrl, --apply writes the groups" },
+	{ "hybrid",    hybrid_command,    "summarize the core types of a hybrid cpu and place latency critical workers on the performance cores, --replay <file> decodes a dump" },
+	{ "scan",      scan_command,      "compare the feature leaves 1, 7 and 0xD of every logical processor, print the common features and the outliers, --replay <file> scans a dump" },
+	{ "pmu",       pmu_command,       "decode the performance monitoring counters and measure a region with rdpmc against read(), --replay <file> decodes a dump" },
+	{ "help",      help_command,      "print this help" }
+};
+
+#define COMMANDS_SIZE (sizeof(Commands) / sizeof(Commands[0]))
+
+int help_command(int argc, char* argv[])
+{
+	printf("Usage: archinfo [command] [options]\n\n");
+
+	for(uint32_t i = 0; i < COMMANDS_SIZE; ++i)
+		printf("   %-10s %s\n", Commands[i].name, Commands[i].description);
+
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	// print the cpu informations when no command is given
+	if(argc < 2)
+		return info_command(argc, argv);
+
+	// run the command with its own arguments
+	for(uint32_t i = 0; i < COMMANDS_SIZE; ++i)
+		if(strcmp(argv[1], Commands[i].name) == 0)
+			return Commands[i].run(argc - 1, argv + 1);
+
+	printf("Unknown command: %s\n\n", argv[1]);
+
+	help_command(argc, argv);
+
+	return 1;
+}
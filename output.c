@@ -0,0 +1,683 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "output.h"
+
+const char* OutputFormatStrings[OUTPUT_FORMATS] =
+{
+	"text",
+	"json",
+	"binary"
+};
+
+int output_format_parse(const char* name, output_format_t* format)
+{
+	for(uint32_t i = 0; i < OUTPUT_FORMATS; ++i)
+	{
+		if(strcmp(name, OutputFormatStrings[i]) == 0)
+		{
+			*format = (output_format_t)i;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void json_features(writer_t* writer, const feature_t* table, uint32_t size, uint32_t value)
+{
+	for(uint32_t i = 0; i < size; ++i)
+		if(value & table[i].mask)
+			json_string(writer, NULL, table[i].name);
+}
+
+static void json_xsave(writer_t* writer, const archinfo_t* info)
+{
+	const cpu_xsave_t* xsave = &info->xsave;
+
+	json_begin_object(writer, "xsave");
+
+	json_uint(writer, "supported", xsave->supported);
+	json_uint(writer, "supported_xss", xsave->supported_xss);
+	json_uint(writer, "enabled_size", xsave->enabled_size);
+	json_uint(writer, "compacted_size", xsave->compacted_size);
+	json_uint(writer, "max_size", xsave->max_size);
+	json_bool(writer, "xsaveopt", xsave->xsaveopt);
+	json_bool(writer, "xsavec", xsave->xsavec);
+	json_bool(writer, "xgetbv1", xsave->xgetbv1);
+	json_bool(writer, "xsaves", xsave->xsaves);
+	json_bool(writer, "xfd", xsave->xfd);
+
+	json_begin_array(writer, "components");
+
+	for(uint32_t i = 0; i < XSAVE_COMPONENTS; ++i)
+	{
+		const cpu_xsave_component_t* component = &xsave->components[i];
+
+		if(!(((xsave->supported | xsave->supported_xss) >> i) & 0x1))
+			continue;
+
+		json_begin_object(writer, NULL);
+
+		json_uint(writer, "index", i);
+		json_string(writer, "name", XsaveComponentStrings[i]);
+		json_uint(writer, "size", component->size);
+		json_uint(writer, "offset", component->offset);
+		json_bool(writer, "enabled", (info->xcr0 >> i) & 0x1);
+		json_bool(writer, "supervisor", component->supervisor);
+		json_bool(writer, "aligned", component->aligned);
+		json_bool(writer, "xfd", component->xfd);
+
+		json_end_object(writer);
+	}
+
+	json_end_array(writer);
+
+	json_end_object(writer);
+}
+
+static void json_rdt_cat(writer_t* writer, const char* name, const cpu_rdt_cat_t* cat)
+{
+	json_begin_object(writer, name);
+
+	json_uint(writer, "cbm_length", cat->cbm_length);
+	json_uint(writer, "shared_mask", cat->shared_mask);
+	json_uint(writer, "closids", cat->closids);
+	json_bool(writer, "cdp", cat->cdp);
+	json_bool(writer, "noncontiguous", cat->noncontiguous);
+
+	json_end_object(writer);
+}
+
+static void json_rdt(writer_t* writer, const archinfo_t* info)
+{
+	const cpu_rdt_t* rdt = &info->rdt;
+
+	json_begin_object(writer, "rdt");
+
+	json_begin_object(writer, "monitoring");
+	json_uint(writer, "rmids", rdt->rmids);
+	json_uint(writer, "upscaling", rdt->upscaling);
+	json_uint(writer, "counter_width", rdt->counter_width);
+	json_bool(writer, "llc_occupancy", rdt->llc_occupancy);
+	json_bool(writer, "mbm_total", rdt->mbm_total);
+	json_bool(writer, "mbm_local", rdt->mbm_local);
+	json_end_object(writer);
+
+	json_rdt_cat(writer, "l3", &rdt->l3);
+	json_rdt_cat(writer, "l2", &rdt->l2);
+
+	json_begin_object(writer, "mba");
+	json_uint(writer, "max", rdt->mba_max);
+	json_bool(writer, "linear", rdt->mba_linear);
+	json_uint(writer, "closids", rdt->mba_closids);
+	json_end_object(writer);
+
+	json_end_object(writer);
+}
+
+static void json_pmu(writer_t* writer, const archinfo_t* info)
+{
+	const cpu_pmu_t* pmu = &info->pmu;
+
+	json_begin_object(writer, "pmu");
+	json_uint(writer, "version", pmu->version);
+	json_uint(writer, "counters", pmu->counters);
+	json_uint(writer, "counter_width", pmu->counter_width);
+	json_uint(writer, "fixed_counters", pmu->fixed_counters);
+	json_uint(writer, "fixed_width", pmu->fixed_width);
+	json_uint(writer, "fixed_mask", pmu->fixed_mask);
+
+	json_begin_array(writer, "events");
+
+	for(uint32_t e = 0; e < PMU_EVENTS; ++e)
+		if((pmu->events >> e) & 0x1)
+			json_string(writer, NULL, PmuEventStrings[e]);
+
+	json_end_array(writer);
+
+	json_end_object(writer);
+}
+
+static void json_topology(writer_t* writer, const archinfo_t* info)
+{
+	const cpu_topology_t* topology = &info->topology;
+
+	json_begin_object(writer, "topology");
+
+	json_uint(writer, "leaf", topology->leaf);
+	json_uint(writer, "packages", topology->packages_cnt);
+	json_uint(writer, "cores", topology->cores_cnt);
+	json_uint(writer, "threads", topology->threads_cnt);
+
+	json_begin_array(writer, "cores_ids");
+
+	for(uint32_t i = 0; topology->cores_ids != NULL && i < topology->cores_cnt; ++i)
+		json_uint(writer, NULL, topology->cores_ids[i]);
+
+	json_end_array(writer);
+
+	json_begin_array(writer, "cpus");
+
+	for(uint32_t i = 0; topology->cpus != NULL && i < topology->threads_cnt; ++i)
+	{
+		const cpu_logical_t* cpu = &topology->cpus[i];
+
+		json_begin_object(writer, NULL);
+
+		json_uint(writer, "cpu", cpu->cpu);
+		json_uint(writer, "apic_id", cpu->apic_id);
+		json_uint(writer, "core_id", cpu->core_id);
+		json_uint(writer, "die_id", cpu->die_id);
+		json_uint(writer, "package_id", cpu->package_id);
+
+		if(info->hybrid)
+		{
+			json_string(writer, "core_type", CoreTypeStrings[cpu->core_type]);
+			json_uint(writer, "native_model", cpu->native_model);
+		}
+
+		// index of the instance of each cache, in the order of the caches array
+		json_begin_array(writer, "cache_instances");
+
+		for(uint32_t k = 0; k < info->caches_cnt; ++k)
+			json_uint(writer, NULL, cpu->cache_instances[k]);
+
+		json_end_array(writer);
+
+		json_end_object(writer);
+	}
+
+	json_end_array(writer);
+
+	json_end_object(writer);
+}
+
+static void json_caches(writer_t* writer, const archinfo_t* info)
+{
+	json_begin_array(writer, "caches");
+
+	for(uint32_t i = 0; i < info->caches_cnt; ++i)
+	{
+		const cpu_cache_t* cache = &info->caches[i];
+
+		json_begin_object(writer, NULL);
+
+		json_uint(writer, "level", cache->level);
+		json_string(writer, "type", CacheTypeStrings[cache->type & 0x3]);
+		json_uint(writer, "size", cache->size);
+		json_uint(writer, "line_size", cache->line_size);
+		json_uint(writer, "partitions", cache->partitions);
+		json_uint(writer, "ways", cache->ways);
+		json_uint(writer, "sets", cache->sets);
+		json_bool(writer, "shared", cache->shared);
+
+		json_begin_array(writer, "instances");
+
+		for(uint32_t k = 0; cache->instances != NULL && k < cache->instances_cnt; ++k)
+		{
+			const cpu_cache_instance_t* instance = &cache->instances[k];
+
+			json_begin_object(writer, NULL);
+
+			json_uint(writer, "id", instance->id);
+			json_uint(writer, "die_id", instance->die_id);
+			json_uint(writer, "package_id", instance->package_id);
+
+			json_begin_array(writer, "cpus");
+
+			for(uint32_t j = 0; j < instance->cpus_cnt; ++j)
+				json_uint(writer, NULL, instance->cpus[j]);
+
+			json_end_array(writer);
+
+			json_end_object(writer);
+		}
+
+		json_end_array(writer);
+
+		json_end_object(writer);
+	}
+
+	json_end_array(writer);
+}
+
+static void json_core_types(writer_t* writer, const archinfo_t* info)
+{
+	json_begin_array(writer, "core_types");
+
+	for(uint32_t t = 0; t < info->core_types_cnt; ++t)
+	{
+		const cpu_core_type_t* type = &info->core_types[t];
+
+		json_begin_object(writer, NULL);
+
+		json_string(writer, "type", CoreTypeStrings[type->type]);
+		json_uint(writer, "native_model", type->native_model);
+		json_uint(writer, "cpus", type->cpus_cnt);
+		json_uint(writer, "cores", type->cores_cnt);
+		json_uint(writer, "first_cpu", type->cpu);
+		json_uint(writer, "l1d_size", type->l1d_size);
+		json_uint(writer, "l2_size", type->l2_size);
+
+		json_end_object(writer);
+	}
+
+	json_end_array(writer);
+}
+
+static void json_tlbs(writer_t* writer, const archinfo_t* info)
+{
+	json_begin_array(writer, "tlbs");
+
+	for(uint32_t i = 0; i < info->tlbs_cnt; ++i)
+	{
+		const cpu_tlb_t* tlb = &info->tlbs[i];
+
+		json_begin_object(writer, NULL);
+
+		json_uint(writer, "level", tlb->level);
+		json_string(writer, "type", TlbTypeStrings[tlb->type]);
+
+		json_begin_array(writer, "pages");
+
+		for(uint32_t k = 0; k < TLB_PAGE_SIZES; ++k)
+			if(tlb->pages & (1 << k))
+				json_string(writer, NULL, TlbPageStrings[k]);
+
+		json_end_array(writer);
+
+		json_uint(writer, "entries", tlb->entries);
+		json_uint(writer, "ways", tlb->ways);
+		json_uint(writer, "sets", tlb->sets);
+		json_bool(writer, "fully_associative", tlb->fully_associative);
+		json_uint(writer, "partitioning", tlb->partitioning);
+		json_uint(writer, "sharing", tlb->sharing);
+
+		json_end_object(writer);
+	}
+
+	json_end_array(writer);
+
+	// bytes mapped by the data tlbs for each page size
+	json_begin_object(writer, "tlb_reach");
+
+	for(uint32_t k = 0; k < TLB_PAGE_SIZES; ++k)
+		json_uint(writer, TlbPageStrings[k], archinfo_tlb_reach(info, 0, 1 << k));
+
+	json_end_object(writer);
+}
+
+int output_json(const archinfo_t* info, writer_t* writer)
+{
+	const cpu_signature_t* signature = &info->signature;
+
+	json_begin_object(writer, NULL);
+
+	json_string(writer, "vendor", (const char*)info->vendor.id);
+	json_string(writer, "brand", info->brand);
+	json_uint(writer, "max_leaf", info->max_leaf);
+	json_uint(writer, "max_ext_leaf", info->max_ext_leaf);
+
+	json_begin_object(writer, "signature");
+	json_uint(writer, "value", signature->value);
+	json_uint(writer, "stepping", signature->stepping);
+	json_uint(writer, "model", signature->model);
+	json_uint(writer, "family", signature->family);
+	json_uint(writer, "extended_model", info->model_num);
+	json_uint(writer, "extended_family", info->family_num);
+	json_end_object(writer);
+
+	json_string(writer, "microarchitecture", microarch_name(info->vendor_num, info->family_num, info->model_num));
+
+	// the features by name and the raw registers for the bits without a name
+	json_begin_array(writer, "features");
+	json_features(writer, EdxFeatures, EDX_FEATURES_SIZE, info->features.edx.value);
+	json_features(writer, EcxFeatures, ECX_FEATURES_SIZE, info->features.ecx.value);
+	json_end_array(writer);
+
+	json_begin_array(writer, "ext_features");
+	json_features(writer, EbxExtFeatures, EBX_EXT_FEATURES_SIZE, info->features_ext.ebx.value);
+	json_features(writer, EcxExtFeatures, ECX_EXT_FEATURES_SIZE, info->features_ext.ecx.value);
+	json_end_array(writer);
+
+	json_begin_object(writer, "registers");
+	json_uint(writer, "edx", info->features.edx.value);
+	json_uint(writer, "ecx", info->features.ecx.value);
+	json_uint(writer, "ext_ebx", info->features_ext.ebx.value);
+	json_uint(writer, "ext_ecx", info->features_ext.ecx.value);
+	json_uint(writer, "xcr0", info->xcr0);
+	json_end_object(writer);
+
+	json_xsave(writer, info);
+
+	json_rdt(writer, info);
+
+	json_pmu(writer, info);
+
+	json_begin_object(writer, "frequencies");
+	json_uint(writer, "base", info->frequencies.base);
+	json_uint(writer, "max", info->frequencies.max);
+	json_uint(writer, "bus", info->frequencies.bus);
+	json_end_object(writer);
+
+	json_begin_object(writer, "tsc");
+	json_bool(writer, "invariant", info->tsc.invariant);
+	json_uint(writer, "numerator", info->tsc.numerator);
+	json_uint(writer, "denominator", info->tsc.denominator);
+	json_uint(writer, "crystal", info->tsc.crystal);
+	json_uint(writer, "frequency", info->tsc.frequency);
+	json_end_object(writer);
+
+	json_topology(writer, info);
+	json_caches(writer, info);
+	json_core_types(writer, info);
+
+	json_begin_object(writer, "words");
+	json_uint(writer, "outliers", info->outliers_cnt);
+
+	json_begin_array(writer, "common");
+
+	for(uint32_t w = 0; w < CPU_WORDS; ++w)
+		json_uint(writer, NULL, info->words_common[w]);
+
+	json_end_array(writer);
+
+	json_end_object(writer);
+
+	json_begin_array(writer, "tlb_descriptors");
+
+	for(uint32_t i = 0; i < info->tlb_descriptors_cnt; ++i)
+		json_string(writer, NULL, CacheTlbDescriptors[info->tlb_descriptors[i]]);
+
+	json_end_array(writer);
+
+	json_tlbs(writer, info);
+
+	json_end_object(writer);
+
+	return writer_flush(writer);
+}
+
+static void binary_string(writer_t* writer, const char* text)
+{
+	size_t length = (text != NULL) ? strlen(text) : 0;
+
+	writer_varint(writer, length);
+	writer_bytes(writer, text, length);
+}
+
+// write a section built in a writer without a file, prefixed by its tag and length
+static void binary_section(writer_t* writer, uint8_t tag, writer_t* section)
+{
+	if(section->error)
+		writer->error = 1;
+
+	writer_bytes(writer, &tag, 1);
+	size_t size;
+	const void* bytes = writer_memory(section, &size);
+
+	writer_varint(writer, size);
+	writer_bytes(writer, bytes, size);
+
+	writer_release(section);
+}
+
+int output_binary(const archinfo_t* info, writer_t* writer)
+{
+	const cpu_topology_t* topology = &info->topology;
+	writer_t* section = malloc(sizeof(writer_t));
+
+	if(section == NULL)
+		return 0;
+
+	writer_init(section, NULL);
+
+	writer_bytes(writer, "ARCB", 4);
+	writer_bytes(writer, &(uint8_t){ OUTPUT_BINARY_VERSION }, 1);
+
+	binary_string(section, (const char*)info->vendor.id);
+	binary_string(section, info->brand);
+	binary_string(section, microarch_name(info->vendor_num, info->family_num, info->model_num));
+	writer_varint(section, info->max_leaf);
+	writer_varint(section, info->max_ext_leaf);
+	writer_varint(section, info->signature.value);
+	writer_varint(section, info->model_num);
+	binary_section(writer, OUTPUT_SECTION_IDENTITY, section);
+
+	writer_varint(section, info->features.edx.value);
+	writer_varint(section, info->features.ecx.value);
+	writer_varint(section, info->features_ext.ebx.value);
+	writer_varint(section, info->features_ext.ecx.value);
+	writer_varint(section, info->xcr0);
+	binary_section(writer, OUTPUT_SECTION_FEATURES, section);
+
+	writer_varint(section, info->frequencies.base);
+	writer_varint(section, info->frequencies.max);
+	writer_varint(section, info->frequencies.bus);
+	writer_varint(section, info->tsc.invariant);
+	writer_varint(section, info->tsc.numerator);
+	writer_varint(section, info->tsc.denominator);
+	writer_varint(section, info->tsc.crystal);
+	writer_varint(section, info->tsc.frequency);
+	binary_section(writer, OUTPUT_SECTION_CLOCKS, section);
+
+	uint32_t cores_cnt = (topology->cores_ids != NULL) ? topology->cores_cnt : 0;
+	uint32_t threads_cnt = (topology->cpus != NULL) ? topology->threads_cnt : 0;
+
+	writer_varint(section, topology->leaf);
+	writer_varint(section, topology->packages_cnt);
+	writer_varint(section, topology->cores_cnt);
+	writer_varint(section, topology->threads_cnt);
+	writer_varint(section, topology->pkg_shift);
+	writer_varint(section, topology->pkg_mask);
+	writer_varint(section, TOPOLOGY_LEVELS);
+
+	for(uint32_t i = 0; i < TOPOLOGY_LEVELS; ++i)
+		writer_varint(section, topology->shifts[i]);
+
+	writer_varint(section, cores_cnt);
+
+	for(uint32_t i = 0; i < cores_cnt; ++i)
+		writer_varint(section, topology->cores_ids[i]);
+
+	writer_varint(section, threads_cnt);
+
+	for(uint32_t i = 0; i < threads_cnt; ++i)
+	{
+		const cpu_logical_t* cpu = &topology->cpus[i];
+
+		writer_varint(section, cpu->cpu);
+		writer_varint(section, cpu->apic_id);
+		writer_varint(section, cpu->core_id);
+		writer_varint(section, cpu->die_id);
+		writer_varint(section, cpu->package_id);
+		writer_varint(section, info->caches_cnt);
+
+		for(uint32_t k = 0; k < info->caches_cnt; ++k)
+			writer_varint(section, cpu->cache_instances[k]);
+	}
+
+	binary_section(writer, OUTPUT_SECTION_TOPOLOGY, section);
+
+	writer_varint(section, info->hybrid);
+	writer_varint(section, info->core_types_cnt);
+
+	for(uint32_t t = 0; t < info->core_types_cnt; ++t)
+	{
+		const cpu_core_type_t* type = &info->core_types[t];
+
+		writer_varint(section, type->type);
+		writer_varint(section, type->native_model);
+		writer_varint(section, type->cpus_cnt);
+		writer_varint(section, type->cores_cnt);
+		writer_varint(section, type->cpu);
+		writer_varint(section, type->l1d_size);
+		writer_varint(section, type->l2_size);
+	}
+
+	writer_varint(section, threads_cnt);
+
+	for(uint32_t i = 0; i < threads_cnt; ++i)
+	{
+		writer_varint(section, topology->cpus[i].core_type);
+		writer_varint(section, topology->cpus[i].native_model);
+	}
+
+	binary_section(writer, OUTPUT_SECTION_HYBRID, section);
+
+	writer_varint(section, info->outliers_cnt);
+	writer_varint(section, CPU_WORDS);
+
+	for(uint32_t w = 0; w < CPU_WORDS; ++w)
+		writer_varint(section, info->words_common[w]);
+
+	writer_varint(section, threads_cnt);
+
+	for(uint32_t i = 0; i < threads_cnt; ++i)
+		for(uint32_t w = 0; w < CPU_WORDS; ++w)
+			writer_varint(section, topology->cpus[i].words[w]);
+
+	binary_section(writer, OUTPUT_SECTION_WORDS, section);
+
+	writer_varint(section, info->caches_cnt);
+
+	for(uint32_t i = 0; i < info->caches_cnt; ++i)
+	{
+		const cpu_cache_t* cache = &info->caches[i];
+		uint32_t instances_cnt = (cache->instances != NULL) ? cache->instances_cnt : 0;
+
+		writer_varint(section, cache->level);
+		writer_varint(section, cache->type);
+		writer_varint(section, cache->size);
+		writer_varint(section, cache->line_size);
+		writer_varint(section, cache->partitions);
+		writer_varint(section, cache->ways);
+		writer_varint(section, cache->sets);
+		writer_varint(section, cache->shared);
+		writer_varint(section, instances_cnt);
+
+		for(uint32_t k = 0; k < instances_cnt; ++k)
+		{
+			const cpu_cache_instance_t* instance = &cache->instances[k];
+
+			writer_varint(section, instance->id);
+			writer_varint(section, instance->package_id);
+			writer_varint(section, instance->die_id);
+			writer_varint(section, instance->cpus_cnt);
+
+			for(uint32_t j = 0; j < instance->cpus_cnt; ++j)
+				writer_varint(section, instance->cpus[j]);
+		}
+	}
+
+	binary_section(writer, OUTPUT_SECTION_CACHES, section);
+
+	writer_varint(section, info->tlb_descriptors_cnt);
+	writer_bytes(section, info->tlb_descriptors, info->tlb_descriptors_cnt);
+	binary_section(writer, OUTPUT_SECTION_TLB, section);
+
+	writer_varint(section, info->tlbs_cnt);
+
+	for(uint32_t i = 0; i < info->tlbs_cnt; ++i)
+	{
+		const cpu_tlb_t* tlb = &info->tlbs[i];
+
+		writer_varint(section, tlb->level);
+		writer_varint(section, tlb->type);
+		writer_varint(section, tlb->pages);
+		writer_varint(section, tlb->entries);
+		writer_varint(section, tlb->ways);
+		writer_varint(section, tlb->sets);
+		writer_varint(section, tlb->fully_associative);
+		writer_varint(section, tlb->partitioning);
+		writer_varint(section, tlb->sharing);
+	}
+
+	binary_section(writer, OUTPUT_SECTION_TLBS, section);
+
+	const cpu_xsave_t* xsave = &info->xsave;
+
+	writer_varint(section, xsave->supported);
+	writer_varint(section, xsave->supported_xss);
+	writer_varint(section, xsave->enabled_size);
+	writer_varint(section, xsave->max_size);
+	writer_varint(section, xsave->compacted_size);
+	writer_varint(section, xsave->xsaveopt | (xsave->xsavec << 1) | (xsave->xgetbv1 << 2) | (xsave->xsaves << 3) | (xsave->xfd << 4));
+	writer_varint(section, XSAVE_COMPONENTS);
+
+	for(uint32_t i = 0; i < XSAVE_COMPONENTS; ++i)
+	{
+		const cpu_xsave_component_t* component = &xsave->components[i];
+
+		writer_varint(section, component->size);
+		writer_varint(section, component->offset);
+		writer_varint(section, component->supervisor | (component->aligned << 1) | (component->xfd << 2));
+	}
+
+	binary_section(writer, OUTPUT_SECTION_XSAVE, section);
+
+	const cpu_rdt_t* rdt = &info->rdt;
+
+	writer_varint(section, rdt->rmids);
+	writer_varint(section, rdt->upscaling);
+	writer_varint(section, rdt->counter_width);
+	writer_varint(section, rdt->llc_occupancy | (rdt->mbm_total << 1) | (rdt->mbm_local << 2));
+
+	const cpu_rdt_cat_t* cats[] = { &rdt->l3, &rdt->l2 };
+
+	for(uint32_t i = 0; i < 2; ++i)
+	{
+		writer_varint(section, cats[i]->cbm_length);
+		writer_varint(section, cats[i]->shared_mask);
+		writer_varint(section, cats[i]->closids);
+		writer_varint(section, (cats[i]->cdp << 2) | (cats[i]->noncontiguous << 3));
+	}
+
+	writer_varint(section, rdt->mba_max);
+	writer_varint(section, rdt->mba_linear);
+	writer_varint(section, rdt->mba_closids);
+
+	binary_section(writer, OUTPUT_SECTION_RDT, section);
+
+	const cpu_pmu_t* pmu = &info->pmu;
+
+	writer_varint(section, pmu->version);
+	writer_varint(section, pmu->counters);
+	writer_varint(section, pmu->counter_width);
+	writer_varint(section, pmu->fixed_counters);
+	writer_varint(section, pmu->fixed_width);
+	writer_varint(section, pmu->fixed_mask);
+	writer_varint(section, pmu->events);
+
+	binary_section(writer, OUTPUT_SECTION_PMU, section);
+
+	// an empty end section closes the snapshot
+	binary_section(writer, OUTPUT_SECTION_END, section);
+
+	free(section);
+
+	return writer_flush(writer);
+}
@@ -0,0 +1,102 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "archinfo.h"
+#include "writer.h"
+
+// machine readable encodings of a snapshot
+typedef enum
+{
+	OUTPUT_TEXT,
+	OUTPUT_JSON,
+	OUTPUT_BINARY,
+
+	OUTPUT_FORMATS
+
+} output_format_t;
+
+extern const char* OutputFormatStrings[OUTPUT_FORMATS];
+
+// parse the name of an output format, returns 0 if the name is unknown
+int output_format_parse(const char* name, output_format_t* format);
+
+// binary encoding version, bumped when a field of a section changes meaning
+#define OUTPUT_BINARY_VERSION 2
+
+// sections of the binary encoding, unknown ones are skipped by their length
+enum
+{
+	OUTPUT_SECTION_END,
+
+	// vendor, brand, microarchitecture, max leaf, max extended leaf, signature, extended model
+	OUTPUT_SECTION_IDENTITY,
+
+	// leaf 1 edx, leaf 1 ecx, leaf 7 ebx, leaf 7 ecx, xcr0
+	OUTPUT_SECTION_FEATURES,
+
+	// base, max and bus MHz, tsc invariant, numerator, denominator, crystal Hz and frequency Hz
+	OUTPUT_SECTION_CLOCKS,
+
+	// leaf, packages, cores, threads, package shift and mask, levels and their shifts, cores then their ids,
+	// cpus then cpu, apic id, core id, die id, package id, caches and their instances of every cpu
+	OUTPUT_SECTION_TOPOLOGY,
+
+	// caches then level, type, size, line size, partitions, ways, sets, shared and instances of every cache,
+	// then id, package id, die id, cpus and their numbers of every instance
+	OUTPUT_SECTION_CACHES,
+
+	// descriptors then their one byte codes
+	OUTPUT_SECTION_TLB,
+
+	// tlbs then level, type, page sizes mask, entries, ways, sets, fully associative, partitioning and sharing of every tlb
+	OUTPUT_SECTION_TLBS,
+
+	// supported xcr0 and IA32_XSS components, enabled and max sizes, compacted size of the xcr0 and IA32_XSS components as leaf 0xD subleaf 1 ebx,
+	// extensions as leaf 0xD subleaf 1 eax bits, components then size, offset and flags as leaf 0xD ecx bits of every component
+	OUTPUT_SECTION_XSAVE,
+
+	// rmids, upscaling, counter width, monitoring events as leaf 0xF subleaf 1 edx bits,
+	// cbm length, shared mask, closids and flags as leaf 0x10 ecx bits of the l3 then the l2,
+	// maximum throttling, linear and closids of the memory bandwidth allocation
+	OUTPUT_SECTION_RDT,
+
+	// hybrid, core types then CORE_TYPE_* type, native model, cpus, cores, first cpu, l1d and l2 sizes of every type,
+	// cpus then core type and native model of every cpu in the order of the topology section
+	OUTPUT_SECTION_HYBRID,
+
+	// outliers, words then the CPU_WORD_* registers every cpu reports, cpus then the words of every cpu
+	OUTPUT_SECTION_WORDS,
+
+	// version, counters, counter width, fixed counters, fixed width, fixed mask and the PMU_EVENT_* mask of the available events
+	OUTPUT_SECTION_PMU
+};
+
+// write a snapshot as a single line json object
+// returns 0 if a write failed
+int output_json(const archinfo_t* info, writer_t* writer);
+
+// write a snapshot in the compact binary encoding: the "ARCB" magic and the version byte,
+// then every section as a tag byte, the varint length of its payload and the payload
+// the payloads are varints and the strings a varint length followed by the bytes
+// returns 0 if a write failed
+int output_binary(const archinfo_t* info, writer_t* writer);
@@ -0,0 +1,552 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if   defined(_WIN32)
+	#include <windows.h>
+#elif defined(__linux__)
+	#define _GNU_SOURCE
+	#include <unistd.h>
+	#include <sched.h>
+	#include <pthread.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "archinfo.h"
+#include "dump.h"
+
+// maximum number of collector threads, each one handles a strided part of the cpus
+#define PERCPU_MAX_WORKERS 64
+
+// stack size of the collector threads
+#define PERCPU_STACK_SIZE (64 * 1024)
+
+// apic id of the logical processors the collector could not run on
+#define APIC_ID_INVALID 0xFFFFFFFF
+
+// the 32 bit x2apic id if the extended topology leaf is valid, otherwise the 8 bit apic id
+static uint32_t apic_id(const uint32_t leaf_1[4], const uint32_t leaf_b[4], uint32_t max_leaf)
+{
+	if(max_leaf >= 0xB && leaf_b[1] != 0)
+		return leaf_b[3];
+
+	return leaf_1[1] >> 24;
+}
+
+// the core type and native model id of leaf 0x1A, which is zero on the cpus that are not hybrid
+static void core_type(cpu_logical_t* cpu, const uint32_t leaf_1a[4])
+{
+	switch(leaf_1a[0] >> 24)
+	{
+	case 0x20:
+		cpu->core_type = CORE_TYPE_EFFICIENT;
+		break;
+	case 0x40:
+		cpu->core_type = CORE_TYPE_PERFORMANCE;
+		break;
+
+	default:
+		cpu->core_type = CORE_TYPE_NONE;
+		break;
+	}
+
+	cpu->native_model = leaf_1a[0] & 0xFFFFFF;
+}
+
+// the feature registers compared between the logical processors
+static void words(cpu_logical_t* cpu, const uint32_t leaf_1[4], const uint32_t leaf_7[4], const uint32_t leaf_d[4], const uint32_t leaf_d1[4])
+{
+	cpu->words[CPU_WORD_1_EDX] = leaf_1[3];
+	cpu->words[CPU_WORD_1_ECX] = leaf_1[2];
+	cpu->words[CPU_WORD_7_EBX] = leaf_7[1];
+	cpu->words[CPU_WORD_7_ECX] = leaf_7[2];
+	cpu->words[CPU_WORD_7_EDX] = leaf_7[3];
+	cpu->words[CPU_WORD_D_EAX] = leaf_d[0];
+	cpu->words[CPU_WORD_D_EDX] = leaf_d[3];
+	cpu->words[CPU_WORD_D1_EAX] = leaf_d1[0];
+}
+
+static void percpu_leaves(cpu_logical_t* cpu, uint32_t index, void* arg)
+{
+	uint32_t max_leaf = *(const uint32_t*)arg;
+	uint32_t leaf_1[4] = { 0 };
+	uint32_t leaf_7[4] = { 0 };
+	uint32_t leaf_b[4] = { 0 };
+	uint32_t leaf_d[4] = { 0 };
+	uint32_t leaf_d1[4] = { 0 };
+	uint32_t leaf_1a[4] = { 0 };
+
+	// get the apic id leaves of the current logical processor
+	CPUID(0x1, leaf_1[0], leaf_1[1], leaf_1[2], leaf_1[3]);
+
+	if(max_leaf >= 0xB)
+		CPUID_EXT(0xB, 0x0, leaf_b[0], leaf_b[1], leaf_b[2], leaf_b[3]);
+
+	// get the feature leaves, which may differ between the logical processors
+	if(max_leaf >= 0x7)
+		CPUID_EXT(0x7, 0x0, leaf_7[0], leaf_7[1], leaf_7[2], leaf_7[3]);
+
+	if(max_leaf >= 0xD)
+	{
+		CPUID_EXT(0xD, 0x0, leaf_d[0], leaf_d[1], leaf_d[2], leaf_d[3]);
+		CPUID_EXT(0xD, 0x1, leaf_d1[0], leaf_d1[1], leaf_d1[2], leaf_d1[3]);
+	}
+
+	// get the core type of a hybrid cpu
+	if(max_leaf >= 0x1A)
+		CPUID_EXT(0x1A, 0x0, leaf_1a[0], leaf_1a[1], leaf_1a[2], leaf_1a[3]);
+
+	cpu->apic_id = apic_id(leaf_1, leaf_b, max_leaf);
+
+	core_type(cpu, leaf_1a);
+	words(cpu, leaf_1, leaf_7, leaf_d, leaf_d1);
+}
+
+static uint32_t max_leaf()
+{
+	uint32_t eax, ebx, ecx, edx;
+
+	CPUID(0x0, eax, ebx, ecx, edx);
+
+	return eax;
+}
+
+static uint32_t compact(cpu_logical_t* cpus, uint32_t cpus_cnt)
+{
+	uint32_t cnt = 0;
+
+	// drop the logical processors that could not be visited
+	for(uint32_t i = 0; i < cpus_cnt; ++i)
+		if(cpus[i].apic_id != APIC_ID_INVALID)
+			cpus[cnt++] = cpus[i];
+
+	return cnt;
+}
+
+uint32_t* cpulist_parse(const char* list, uint32_t* cpus_cnt)
+{
+	uint32_t capacity = 64;
+	uint32_t* cpus = malloc(capacity * sizeof(uint32_t));
+	uint32_t cnt = 0;
+
+	if(cpus == NULL)
+		return NULL;
+
+	const char* p = list;
+
+	while(*p != '\0' && *p != '\n')
+	{
+		char* end;
+
+		// parse a single cpu or a range
+		uint32_t first = strtoul(p, &end, 10);
+		uint32_t last = first;
+
+		if(end == p)
+			break;
+
+		if(*end == '-')
+		{
+			p = end + 1;
+			last = strtoul(p, &end, 10);
+
+			if(end == p || last < first)
+				break;
+		}
+
+		for(uint32_t cpu = first; cpu <= last; ++cpu)
+		{
+			if(cnt == capacity)
+			{
+				capacity *= 2;
+
+				uint32_t* grown = realloc(cpus, capacity * sizeof(uint32_t));
+
+				if(grown == NULL)
+				{
+					free(cpus);
+
+					return NULL;
+				}
+
+				cpus = grown;
+			}
+
+			cpus[cnt++] = cpu;
+		}
+
+		p = (*end == ',') ? end + 1 : end;
+	}
+
+	*cpus_cnt = cnt;
+
+	return cpus;
+}
+
+uint32_t cpulist_format(const uint32_t* cpus, uint32_t cpus_cnt, char* list, uint32_t size)
+{
+	uint32_t length = 0;
+
+	if(size != 0)
+		list[0] = '\0';
+
+	for(uint32_t i = 0; i < cpus_cnt; ++i)
+	{
+		uint32_t first = cpus[i];
+
+		// extend the range while the cpu numbers are contiguous
+		while(i + 1 < cpus_cnt && cpus[i + 1] == cpus[i] + 1)
+			++i;
+
+		char range[32];
+
+		if(cpus[i] == first)
+			snprintf(range, sizeof(range), "%s%u", length ? "," : "", first);
+		else
+			snprintf(range, sizeof(range), "%s%u-%u", length ? "," : "", first, cpus[i]);
+
+		if(length < size)
+			snprintf(list + length, size - length, "%s", range);
+
+		length += strlen(range);
+	}
+
+	return length;
+}
+
+#if   defined(_WIN32)
+
+static void percpu_serial(cpu_logical_t* cpus, uint32_t cpus_cnt, percpu_fn_t fn, void* arg)
+{
+	// get the main thread handle
+	HANDLE thread = GetCurrentThread();
+
+	// save the previous affinity mask
+	DWORD_PTR prev_affinity_mask = SetThreadAffinityMask(thread, 1);
+
+	// for each logical processor get the per-cpu leaves
+	for(uint32_t i = 0; i < cpus_cnt; ++i)
+	{
+		// set the affinity to a logical processor
+		if(SetThreadAffinityMask(thread, (DWORD_PTR)1 << cpus[i].cpu) != 0)
+			fn(&cpus[i], i, arg);
+	}
+
+	// set the previous affinity mask
+	SetThreadAffinityMask(thread, prev_affinity_mask);
+}
+
+void percpu_run(cpu_logical_t* cpus, uint32_t cpus_cnt, uint32_t flags, percpu_fn_t fn, void* arg)
+{
+	// the threads are always migrated serially
+	percpu_serial(cpus, cpus_cnt, fn, arg);
+}
+
+cpu_logical_t* percpu_collect(uint32_t* cpus_cnt, uint32_t flags)
+{
+	// get the number of logical processors, limited to the bits of an affinity mask
+	SYSTEM_INFO sysinfo;
+	GetSystemInfo(&sysinfo);
+	uint32_t cnt = sysinfo.dwNumberOfProcessors;
+
+	if(cnt > sizeof(DWORD_PTR) * 8)
+		cnt = sizeof(DWORD_PTR) * 8;
+
+	cpu_logical_t* cpus = calloc(cnt, sizeof(cpu_logical_t));
+
+	if(cpus == NULL)
+		return NULL;
+
+	for(uint32_t i = 0; i < cnt; ++i)
+	{
+		cpus[i].cpu = i;
+		cpus[i].apic_id = APIC_ID_INVALID;
+	}
+
+	uint32_t max = max_leaf();
+
+	percpu_run(cpus, cnt, 0, percpu_leaves, &max);
+
+	*cpus_cnt = compact(cpus, cnt);
+
+	return cpus;
+}
+
+#elif defined(__linux__)
+
+typedef struct
+{
+	cpu_logical_t* cpus;
+	uint32_t cpus_cnt;
+
+	percpu_fn_t fn;
+	void* arg;
+
+	// size of the dynamically allocated cpu sets
+	size_t set_size;
+
+	uint32_t first;
+	uint32_t stride;
+
+} percpu_worker_t;
+
+static int pin_thread(pthread_t thread, uint32_t cpu, size_t set_size)
+{
+	cpu_set_t* cpu_set = CPU_ALLOC(set_size * 8);
+
+	if(cpu_set == NULL)
+		return 0;
+
+	CPU_ZERO_S(set_size, cpu_set);
+	CPU_SET_S(cpu, set_size, cpu_set);
+
+	int error = pthread_setaffinity_np(thread, set_size, cpu_set);
+
+	CPU_FREE(cpu_set);
+
+	return error == 0;
+}
+
+static void percpu_serial(cpu_logical_t* cpus, uint32_t cpus_cnt, percpu_fn_t fn, void* arg, size_t set_size)
+{
+	// get the main thread handle
+	pthread_t thread = pthread_self();
+
+	// save the previous affinity
+	cpu_set_t* prev_cpu_set = CPU_ALLOC(set_size * 8);
+
+	if(prev_cpu_set == NULL)
+		return;
+
+	int saved = pthread_getaffinity_np(thread, set_size, prev_cpu_set) == 0;
+
+	// for each logical procesor get the per-cpu leaves
+	for(uint32_t i = 0; i < cpus_cnt; ++i)
+	{
+		// set the affinity to a logical processor
+		if(pin_thread(thread, cpus[i].cpu, set_size))
+			fn(&cpus[i], i, arg);
+	}
+
+	// set the previous affinity
+	if(saved)
+		pthread_setaffinity_np(thread, set_size, prev_cpu_set);
+
+	CPU_FREE(prev_cpu_set);
+}
+
+static void* percpu_worker(void* arg)
+{
+	percpu_worker_t* worker = (percpu_worker_t*)arg;
+
+	// the worker is created on its first cpu, the following ones need a migration
+	for(uint32_t i = worker->first; i < worker->cpus_cnt; i += worker->stride)
+	{
+		if(i == worker->first || pin_thread(pthread_self(), worker->cpus[i].cpu, worker->set_size))
+			worker->fn(&worker->cpus[i], i, worker->arg);
+	}
+
+	return NULL;
+}
+
+static void percpu_parallel(cpu_logical_t* cpus, uint32_t cpus_cnt, percpu_fn_t fn, void* arg, size_t set_size)
+{
+	uint32_t workers_cnt = (cpus_cnt < PERCPU_MAX_WORKERS) ? cpus_cnt : PERCPU_MAX_WORKERS;
+
+	pthread_t threads[PERCPU_MAX_WORKERS];
+	percpu_worker_t workers[PERCPU_MAX_WORKERS];
+	uint32_t started = 0;
+
+	cpu_set_t* cpu_set = CPU_ALLOC(set_size * 8);
+
+	if(cpu_set == NULL)
+	{
+		percpu_serial(cpus, cpus_cnt, fn, arg, set_size);
+
+		return;
+	}
+
+	for(uint32_t w = 0; w < workers_cnt; ++w)
+	{
+		workers[w].cpus = cpus;
+		workers[w].cpus_cnt = cpus_cnt;
+		workers[w].fn = fn;
+		workers[w].arg = arg;
+		workers[w].set_size = set_size;
+		workers[w].first = w;
+		workers[w].stride = workers_cnt;
+
+		// create the worker directly on its first cpu with a small stack
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+		pthread_attr_setstacksize(&attr, PERCPU_STACK_SIZE);
+
+		CPU_ZERO_S(set_size, cpu_set);
+		CPU_SET_S(cpus[w].cpu, set_size, cpu_set);
+		pthread_attr_setaffinity_np(&attr, set_size, cpu_set);
+
+		int error = pthread_create(&threads[w], &attr, percpu_worker, &workers[w]);
+
+		pthread_attr_destroy(&attr);
+
+		if(error != 0)
+			break;
+
+		started++;
+	}
+
+	CPU_FREE(cpu_set);
+
+	// the workers meet here once every cpu has been visited
+	for(uint32_t w = 0; w < started; ++w)
+		pthread_join(threads[w], NULL);
+
+	// fall back to the serial path if the threads cannot be created
+	// the cpus a started worker has visited are visited again
+	if(started != workers_cnt)
+		percpu_serial(cpus, cpus_cnt, fn, arg, set_size);
+}
+
+static uint32_t* online_cpus(uint32_t* cpus_cnt)
+{
+	FILE* file = fopen("/sys/devices/system/cpu/online", "r");
+
+	if(file != NULL)
+	{
+		char list[4096];
+		uint32_t* cpus = NULL;
+
+		if(fgets(list, sizeof(list), file) != NULL)
+			cpus = cpulist_parse(list, cpus_cnt);
+
+		fclose(file);
+
+		if(cpus != NULL && *cpus_cnt != 0)
+			return cpus;
+
+		free(cpus);
+	}
+
+	// assume the online logical processors are numbered contiguously
+	uint32_t cnt = sysconf(_SC_NPROCESSORS_ONLN);
+	uint32_t* cpus = malloc(cnt * sizeof(uint32_t));
+
+	if(cpus == NULL)
+		return NULL;
+
+	for(uint32_t i = 0; i < cnt; ++i)
+		cpus[i] = i;
+
+	*cpus_cnt = cnt;
+
+	return cpus;
+}
+
+void percpu_run(cpu_logical_t* cpus, uint32_t cpus_cnt, uint32_t flags, percpu_fn_t fn, void* arg)
+{
+	if(cpus_cnt == 0)
+		return;
+
+	// the cpu sets are sized for the configured cpus instead of CPU_SETSIZE
+	uint32_t max_cpus = sysconf(_SC_NPROCESSORS_CONF);
+
+	for(uint32_t i = 0; i < cpus_cnt; ++i)
+		if(max_cpus < cpus[i].cpu + 1)
+			max_cpus = cpus[i].cpu + 1;
+
+	size_t set_size = CPU_ALLOC_SIZE(max_cpus);
+
+	if((flags & ARCHINFO_SERIAL) || cpus_cnt == 1)
+		percpu_serial(cpus, cpus_cnt, fn, arg, set_size);
+	else
+		percpu_parallel(cpus, cpus_cnt, fn, arg, set_size);
+}
+
+cpu_logical_t* percpu_collect(uint32_t* cpus_cnt, uint32_t flags)
+{
+	uint32_t cnt;
+	uint32_t* online = online_cpus(&cnt);
+
+	if(online == NULL)
+		return NULL;
+
+	cpu_logical_t* cpus = calloc(cnt, sizeof(cpu_logical_t));
+
+	if(cpus == NULL)
+	{
+		free(online);
+
+		return NULL;
+	}
+
+	// the cpus that cannot be visited keep an invalid apic id
+	for(uint32_t i = 0; i < cnt; ++i)
+	{
+		cpus[i].cpu = online[i];
+		cpus[i].apic_id = APIC_ID_INVALID;
+	}
+
+	free(online);
+
+	uint32_t max = max_leaf();
+
+	percpu_run(cpus, cnt, flags, percpu_leaves, &max);
+
+	*cpus_cnt = compact(cpus, cnt);
+
+	return cpus;
+}
+
+#endif
+
+cpu_logical_t* percpu_replay(const cpuid_dump_t* dump, uint32_t* cpus_cnt)
+{
+	cpu_logical_t* cpus = calloc(dump->cpus_cnt + 1, sizeof(cpu_logical_t));
+
+	if(cpus == NULL)
+		return NULL;
+
+	for(uint32_t i = 0; i < dump->cpus_cnt; ++i)
+	{
+		uint32_t leaf_0[4], leaf_1[4], leaf_7[4], leaf_b[4], leaf_d[4], leaf_d1[4], leaf_1a[4];
+
+		// the same leaves the collector reads, taken from the cpu of the dump
+		dump_leaf(dump, i, 0x0, 0x0, leaf_0);
+		dump_leaf(dump, i, 0x1, 0x0, leaf_1);
+		dump_leaf(dump, i, 0x7, 0x0, leaf_7);
+		dump_leaf(dump, i, 0xB, 0x0, leaf_b);
+		dump_leaf(dump, i, 0xD, 0x0, leaf_d);
+		dump_leaf(dump, i, 0xD, 0x1, leaf_d1);
+		dump_leaf(dump, i, 0x1A, 0x0, leaf_1a);
+
+		cpus[i].cpu = dump->cpus[i].cpu;
+		cpus[i].apic_id = apic_id(leaf_1, leaf_b, leaf_0[0]);
+
+		core_type(&cpus[i], leaf_1a);
+		words(&cpus[i], leaf_1, leaf_7, leaf_d, leaf_d1);
+	}
+
+	*cpus_cnt = dump->cpus_cnt;
+
+	return cpus;
+}
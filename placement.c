@@ -0,0 +1,263 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if defined(__linux__)
+	#define _GNU_SOURCE
+	#include <unistd.h>
+	#include <sched.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "placement.h"
+
+#define PLACEMENT_KEYS 4
+
+// logical processor and its sort keys for a policy
+typedef struct
+{
+	uint32_t cpu;
+	uint32_t keys[PLACEMENT_KEYS];
+
+} placement_slot_t;
+
+const char* PlacementPolicyStrings[PLACEMENT_POLICIES] =
+{
+	"compact",
+	"scatter",
+	"cores",
+	"l3",
+	"package",
+	"performance"
+};
+
+int placement_policy_parse(const char* name, placement_policy_t* policy)
+{
+	for(uint32_t i = 0; i < PLACEMENT_POLICIES; ++i)
+	{
+		if(strcmp(name, PlacementPolicyStrings[i]) == 0)
+		{
+			*policy = (placement_policy_t)i;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static int compare_slots(const void* a, const void* b)
+{
+	const placement_slot_t* x = (const placement_slot_t*)a;
+	const placement_slot_t* y = (const placement_slot_t*)b;
+
+	for(uint32_t i = 0; i < PLACEMENT_KEYS; ++i)
+		if(x->keys[i] != y->keys[i])
+			return (x->keys[i] < y->keys[i]) ? -1 : 1;
+
+	return (x->cpu < y->cpu) ? -1 : (x->cpu > y->cpu);
+}
+
+int placement_llc(const archinfo_t* info)
+{
+	int llc = -1;
+
+	// the data or unified cache with the highest level, instruction caches are skipped
+	for(uint32_t i = 0; i < info->caches_cnt; ++i)
+		if(info->caches[i].type != 2 && info->caches[i].instances != NULL)
+			if(llc < 0 || info->caches[i].level >= info->caches[llc].level)
+				llc = i;
+
+	return llc;
+}
+
+static uint32_t llc_instance(const cpu_logical_t* cpu, int llc)
+{
+	// the package stands for the last level cache if there is none
+	return (llc < 0) ? cpu->package_id : cpu->cache_instances[llc];
+}
+
+uint32_t* placement_plan(const archinfo_t* info, placement_policy_t policy, uint32_t workers_cnt)
+{
+	const cpu_topology_t* topology = &info->topology;
+	uint32_t threads_cnt = topology->threads_cnt;
+
+	if(threads_cnt == 0 || workers_cnt == 0)
+		return NULL;
+
+	placement_slot_t* slots = calloc(threads_cnt, sizeof(placement_slot_t));
+	uint32_t* smt_ranks = calloc(threads_cnt, sizeof(uint32_t));
+	uint32_t* core_ranks = calloc(threads_cnt, sizeof(uint32_t));
+	uint32_t* cpus = malloc(workers_cnt * sizeof(uint32_t));
+
+	if(slots == NULL || smt_ranks == NULL || core_ranks == NULL || cpus == NULL)
+	{
+		free(slots);
+		free(smt_ranks);
+		free(core_ranks);
+		free(cpus);
+
+		return NULL;
+	}
+
+	int llc = placement_llc(info);
+
+	for(uint32_t i = 0; i < threads_cnt; ++i)
+	{
+		const cpu_logical_t* cpu = &topology->cpus[i];
+
+		// rank of the logical processor among the smt siblings of its core
+		for(uint32_t j = 0; j < i; ++j)
+			if(topology->cpus[j].core_id == cpu->core_id)
+				smt_ranks[i]++;
+
+		// rank of the core among the cores of its last level cache instance
+		for(uint32_t j = 0; j < i; ++j)
+		{
+			const cpu_logical_t* other = &topology->cpus[j];
+
+			if(other->core_id == cpu->core_id)
+			{
+				core_ranks[i] = core_ranks[j];
+
+				break;
+			}
+
+			if(smt_ranks[j] == 0 && llc_instance(other, llc) == llc_instance(cpu, llc))
+				core_ranks[i]++;
+		}
+	}
+
+	uint32_t slots_cnt = 0;
+
+	for(uint32_t i = 0; i < threads_cnt; ++i)
+	{
+		const cpu_logical_t* cpu = &topology->cpus[i];
+
+		uint32_t package = cpu->package_id;
+		uint32_t cache = llc_instance(cpu, llc);
+		uint32_t cache_rank = 0;
+
+		// rank of the last level cache instance among the ones of its package
+		if(llc >= 0)
+			for(uint32_t k = 0; k < cache; ++k)
+				if(info->caches[llc].instances[k].package_id == package)
+					cache_rank++;
+
+		// the cores policy skips the smt siblings
+		if(policy == PLACEMENT_CORES && smt_ranks[i] != 0)
+			continue;
+
+		placement_slot_t* slot = &slots[slots_cnt++];
+		slot->cpu = cpu->cpu;
+
+		switch(policy)
+		{
+		case PLACEMENT_SCATTER:
+			slot->keys[0] = smt_ranks[i];
+			slot->keys[1] = core_ranks[i];
+			slot->keys[2] = cache_rank;
+			slot->keys[3] = package;
+			break;
+
+		case PLACEMENT_L3:
+			slot->keys[0] = package;
+			slot->keys[1] = cache;
+			slot->keys[2] = smt_ranks[i];
+			slot->keys[3] = core_ranks[i];
+			break;
+
+		case PLACEMENT_PACKAGE:
+			slot->keys[0] = package;
+			slot->keys[1] = smt_ranks[i];
+			slot->keys[2] = core_ranks[i];
+			slot->keys[3] = cache_rank;
+			break;
+
+		// a logical processor of a non hybrid cpu counts as a performance core
+		case PLACEMENT_PERFORMANCE:
+			slot->keys[0] = smt_ranks[i];
+			slot->keys[1] = cpu->core_type == CORE_TYPE_EFFICIENT;
+			slot->keys[2] = package;
+			slot->keys[3] = cache;
+			break;
+
+		default:
+			slot->keys[0] = package;
+			slot->keys[1] = cache;
+			slot->keys[2] = core_ranks[i];
+			slot->keys[3] = smt_ranks[i];
+			break;
+		}
+	}
+
+	qsort(slots, slots_cnt, sizeof(placement_slot_t), compare_slots);
+
+	// the workers wrap around the allowed cpus
+	for(uint32_t w = 0; w < workers_cnt; ++w)
+		cpus[w] = slots[w % slots_cnt].cpu;
+
+	free(slots);
+	free(smt_ranks);
+	free(core_ranks);
+
+	return cpus;
+}
+
+#if defined(__linux__)
+
+int placement_pin_thread(pthread_t thread, uint32_t cpu)
+{
+	// the cpu set is sized for the configured cpus instead of CPU_SETSIZE
+	uint32_t max_cpus = sysconf(_SC_NPROCESSORS_CONF);
+
+	if(max_cpus < cpu + 1)
+		max_cpus = cpu + 1;
+
+	cpu_set_t* cpu_set = CPU_ALLOC(max_cpus);
+
+	if(cpu_set == NULL)
+		return 0;
+
+	size_t set_size = CPU_ALLOC_SIZE(max_cpus);
+
+	CPU_ZERO_S(set_size, cpu_set);
+	CPU_SET_S(cpu, set_size, cpu_set);
+
+	int error = pthread_setaffinity_np(thread, set_size, cpu_set);
+
+	CPU_FREE(cpu_set);
+
+	return error == 0;
+}
+
+uint32_t placement_apply(const pthread_t* threads, const uint32_t* cpus, uint32_t threads_cnt)
+{
+	uint32_t pinned = 0;
+
+	for(uint32_t i = 0; i < threads_cnt; ++i)
+		pinned += placement_pin_thread(threads[i], cpus[i]);
+
+	return pinned;
+}
+
+#endif
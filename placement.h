@@ -0,0 +1,76 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#if defined(__linux__)
+	#include <pthread.h>
+#endif
+
+#include "archinfo.h"
+
+// thread placement policies
+typedef enum
+{
+	// fill the smt siblings of a core, then the next core of the same cache and package
+	PLACEMENT_COMPACT,
+
+	// spread over the packages, then over their last level caches and cores, smt siblings last
+	PLACEMENT_SCATTER,
+
+	// one thread per core, smt siblings are never used
+	PLACEMENT_CORES,
+
+	// fill the cores of a last level cache instance, then its smt siblings, then the next instance
+	PLACEMENT_L3,
+
+	// fill the cores of a package, then its smt siblings, then the next package
+	PLACEMENT_PACKAGE,
+
+	// one thread per performance core, then the efficient cores, smt siblings last, for latency critical threads
+	PLACEMENT_PERFORMANCE,
+
+	PLACEMENT_POLICIES
+
+} placement_policy_t;
+
+extern const char* PlacementPolicyStrings[PLACEMENT_POLICIES];
+
+// parse the name of a placement policy, returns 0 if the name is unknown
+int placement_policy_parse(const char* name, placement_policy_t* policy);
+
+// get the index of the last level data or unified cache, -1 if there is none
+int placement_llc(const archinfo_t* info);
+
+// plan the cpus of the workers following a policy
+// the workers wrap around the cpus allowed by the policy when they are more than them
+// returns an allocated array of workers_cnt cpu numbers or NULL
+uint32_t* placement_plan(const archinfo_t* info, placement_policy_t policy, uint32_t workers_cnt);
+
+#if defined(__linux__)
+
+// pin a thread to a logical processor, returns 0 on failure
+int placement_pin_thread(pthread_t thread, uint32_t cpu);
+
+// pin every thread to the cpu planned for it, returns the number of pinned threads
+uint32_t placement_apply(const pthread_t* threads, const uint32_t* cpus, uint32_t threads_cnt);
+
+#endif
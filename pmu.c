@@ -0,0 +1,186 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if defined(__linux__)
+	#include <unistd.h>
+	#include <errno.h>
+	#include <sys/mman.h>
+	#include <sys/syscall.h>
+#endif
+
+#include <string.h>
+
+#include "pmu.h"
+
+#if defined(__linux__)
+
+// perf event type and config of every PMU_EVENT_* event
+static const struct
+{
+	uint32_t type;
+	uint64_t config;
+}
+PmuEvents[PMU_EVENTS] =
+{
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+
+	// the slots have no generic event, this is the intel encoding of the fixed counter 3
+	{ PERF_TYPE_RAW, 0x0400 }
+};
+
+// the raw slots encoding is another event on amd and on intel cpus whose leaf 0xA does not list it
+static int slots_supported()
+{
+	cpu_pmu_t pmu;
+
+	return archinfo_pmu(&pmu) == VENDOR_INTEL && (pmu.events & (1u << PMU_EVENT_TOPDOWN_SLOTS));
+}
+
+static int perf_event_open(struct perf_event_attr* attr, int group_fd)
+{
+	return syscall(SYS_perf_event_open, attr, 0, -1, group_fd, 0);
+}
+
+int pmu_open(pmu_t* pmu, const uint32_t* events, uint32_t events_cnt)
+{
+	memset(pmu, 0, sizeof(pmu_t));
+
+	pmu->counters_cnt = (events_cnt < PMU_MAX_COUNTERS) ? events_cnt : PMU_MAX_COUNTERS;
+
+	long page_size = sysconf(_SC_PAGESIZE);
+	int group_fd = -1;
+
+	for(uint32_t i = 0; i < pmu->counters_cnt; ++i)
+	{
+		pmu_counter_t* counter = &pmu->counters[i];
+
+		counter->event = events[i];
+		counter->fd = -1;
+
+		if(events[i] >= PMU_EVENTS || (events[i] == PMU_EVENT_TOPDOWN_SLOTS && !slots_supported()))
+		{
+			if(pmu->error == 0)
+				pmu->error = EINVAL;
+
+			continue;
+		}
+
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+
+		attr.size = sizeof(attr);
+		attr.type = PmuEvents[events[i]].type;
+		attr.config = PmuEvents[events[i]].config;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		// a pinned leader keeps the group on the pmu instead of multiplexing it with other events
+		attr.pinned = (group_fd == -1);
+
+		counter->fd = perf_event_open(&attr, group_fd);
+
+		if(counter->fd == -1)
+		{
+			if(pmu->error == 0)
+				pmu->error = errno;
+
+			continue;
+		}
+
+		if(group_fd == -1)
+			group_fd = counter->fd;
+
+		pmu->opened_cnt++;
+
+		// the first page of the mapping exposes the counter index and offset to rdpmc
+		void* page = mmap(NULL, page_size, PROT_READ, MAP_SHARED, counter->fd, 0);
+
+		if(page == MAP_FAILED)
+			continue;
+
+		counter->page = page;
+
+		if(((struct perf_event_mmap_page*)page)->cap_user_rdpmc)
+			pmu->rdpmc_cnt++;
+	}
+
+	return pmu->opened_cnt != 0;
+}
+
+void pmu_close(pmu_t* pmu)
+{
+	long page_size = sysconf(_SC_PAGESIZE);
+
+	// close the members before the leader of the group
+	for(uint32_t i = pmu->counters_cnt; i-- > 0;)
+	{
+		pmu_counter_t* counter = &pmu->counters[i];
+
+		if(counter->page != NULL)
+			munmap(counter->page, page_size);
+
+		if(counter->fd != -1)
+			close(counter->fd);
+
+		counter->page = NULL;
+		counter->fd = -1;
+	}
+
+	pmu->opened_cnt = 0;
+	pmu->rdpmc_cnt = 0;
+}
+
+uint64_t pmu_read_syscall(const pmu_counter_t* counter)
+{
+	uint64_t count;
+
+	if(counter->fd == -1 || read(counter->fd, &count, sizeof(count)) != sizeof(count))
+		return 0;
+
+	return count;
+}
+
+#else
+
+// perf events are only available on linux
+int pmu_open(pmu_t* pmu, const uint32_t* events, uint32_t events_cnt)
+{
+	memset(pmu, 0, sizeof(pmu_t));
+
+	return 0;
+}
+
+void pmu_close(pmu_t* pmu)
+{
+}
+
+uint64_t pmu_read_syscall(const pmu_counter_t* counter)
+{
+	return 0;
+}
+
+#endif
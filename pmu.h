@@ -0,0 +1,119 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <x86intrin.h>
+
+#if defined(__linux__)
+	#include <linux/perf_event.h>
+#endif
+
+#include "archinfo.h"
+
+#define PMU_MAX_COUNTERS 8
+
+// a perf event counting user space events of the calling thread
+typedef struct
+{
+	// PMU_EVENT_* event and perf event file descriptor, -1 if the event could not be opened
+	uint32_t event;
+	int fd;
+
+	// mapped perf_event_mmap_page of the event, NULL if it is only read with read()
+	void* page;
+
+} pmu_counter_t;
+
+// a group of counters scheduled on the pmu together
+typedef struct
+{
+	pmu_counter_t counters[PMU_MAX_COUNTERS];
+	uint32_t counters_cnt;
+
+	// counters opened and counters the kernel lets user space read with rdpmc
+	uint32_t opened_cnt;
+	uint32_t rdpmc_cnt;
+
+	// errno of the first counter that could not be opened
+	int error;
+
+} pmu_t;
+
+// open a pinned group of PMU_EVENT_* counters on the calling thread, enabled and excluding the kernel
+// the counters follow the order of the events, the ones that cannot be opened read 0
+// the topdown slots are only opened on intel cpus listing them in leaf 0xA, elsewhere they fail with EINVAL
+// returns 0 if no counter was opened
+int pmu_open(pmu_t* pmu, const uint32_t* events, uint32_t events_cnt);
+
+// close the counters of a group
+void pmu_close(pmu_t* pmu);
+
+// read a counter with the read() system call, 0 if it is not opened or not scheduled
+uint64_t pmu_read_syscall(const pmu_counter_t* counter);
+
+// read a counter with rdpmc, falling back to read() if the kernel does not allow it or the counter is not scheduled
+static inline uint64_t pmu_read(const pmu_counter_t* counter)
+{
+#if defined(__linux__)
+	const volatile struct perf_event_mmap_page* page = counter->page;
+
+	if(page != NULL)
+	{
+		uint32_t seq, index;
+		uint64_t count;
+
+		// the kernel bumps the lock around updates of the page, retry if it changed during the read
+		do
+		{
+			seq = page->lock;
+			__atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+			index = page->cap_user_rdpmc ? page->index : 0;
+			count = page->offset;
+
+			// sign extend the counter to 64 bits before adding it to the offset
+			if(index != 0)
+			{
+				uint32_t shift = 64 - page->pmc_width;
+
+				count += (uint64_t)((int64_t)(__rdpmc(index - 1) << shift) >> shift);
+			}
+
+			__atomic_signal_fence(__ATOMIC_SEQ_CST);
+		}
+		while(page->lock != seq);
+
+		if(index != 0)
+			return count;
+	}
+#endif
+
+	return pmu_read_syscall(counter);
+}
+
+// read every counter of a group into an array of counters_cnt values
+static inline void pmu_sample(const pmu_t* pmu, uint64_t* values)
+{
+	for(uint32_t i = 0; i < pmu->counters_cnt; ++i)
+		values[i] = pmu_read(&pmu->counters[i]);
+}
@@ -0,0 +1,463 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if defined(__linux__)
+	#include <sys/stat.h>
+	#include <errno.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "resctrl.h"
+
+const char* ResctrlStatusStrings[RESCTRL_STATUSES] =
+{
+	"ok",
+	"the l3 cannot be partitioned",
+	"more classes than classes of service",
+	"the classes do not fit in the l3 ways",
+	"memory bandwidth allocation is not available",
+	"memory bandwidth is not allocated in percentages",
+	"cannot write the resctrl groups"
+};
+
+// format the path of a file of a directory, returns 0 if it does not fit
+static int file_path(char* path, size_t size, const char* directory, const char* name)
+{
+	int length = snprintf(path, size, "%s/%s", directory, name);
+
+	return length >= 0 && (size_t)length < size;
+}
+
+// read a number from a file of the resctrl mount
+static int read_value(const resctrl_t* resctrl, const char* name, int hex, uint32_t* value)
+{
+	char path[512];
+
+	if(!file_path(path, sizeof(path), resctrl->path, name))
+		return 0;
+
+	FILE* file = fopen(path, "r");
+
+	if(file == NULL)
+		return 0;
+
+	int read = fscanf(file, hex ? "%x" : "%u", value);
+
+	fclose(file);
+
+	return read == 1;
+}
+
+// read the domains of the l3 from the schemata of the default group, and whether its bandwidth is a percentage
+static void read_domains(resctrl_t* resctrl)
+{
+	char path[512];
+
+	if(!file_path(path, sizeof(path), resctrl->path, "schemata"))
+		return;
+
+	FILE* file = fopen(path, "r");
+
+	if(file == NULL)
+		return;
+
+	char line[1024];
+
+	while(fgets(line, sizeof(line), file) != NULL)
+	{
+		// the resource names are padded to the longest one
+		char* resource = line + strspn(line, " \t");
+
+		if(strncmp(resource, "L3CODE:", 7) == 0)
+			resctrl->cdp = 1;
+
+		// the default group is not throttled, its bandwidth is the maximum of the unit
+		if(strncmp(resource, "MB:", 3) == 0)
+		{
+			char* value = strchr(resource, '=');
+
+			resctrl->mba_percent = (value != NULL && strtoul(value + 1, NULL, 10) == 100);
+		}
+
+		if(strncmp(resource, "L3:", 3) != 0 && strncmp(resource, "L3CODE:", 7) != 0)
+			continue;
+
+		// every domain is an id and a mask separated by semicolons
+		char* domain = strchr(resource, ':') + 1;
+		resctrl->domains_cnt = 0;
+
+		while(resctrl->domains_cnt < RESCTRL_MAX_DOMAINS)
+		{
+			char* end;
+			uint32_t id = strtoul(domain, &end, 10);
+
+			if(end == domain || *end != '=')
+				break;
+
+			resctrl->domains[resctrl->domains_cnt++] = id;
+
+			if((domain = strchr(end, ';')) == NULL)
+				break;
+
+			++domain;
+		}
+	}
+
+	fclose(file);
+}
+
+// check if resctrl is mounted at a path with the bandwidth in MBps
+static int mounted_mbps(const char* path)
+{
+	FILE* file = fopen("/proc/mounts", "r");
+
+	if(file == NULL)
+		return 0;
+
+	char line[1024];
+	int mbps = 0;
+
+	while(!mbps && fgets(line, sizeof(line), file) != NULL)
+	{
+		char point[512], type[64], options[512];
+
+		if(sscanf(line, "%*s %511s %63s %511s", point, type, options) == 3)
+			mbps = strcmp(type, "resctrl") == 0 && strcmp(point, path) == 0 && strstr(options, "mba_MBps") != NULL;
+	}
+
+	fclose(file);
+
+	return mbps;
+}
+
+int resctrl_open(resctrl_t* resctrl, const char* path, const archinfo_t* info)
+{
+	memset(resctrl, 0, sizeof(resctrl_t));
+	snprintf(resctrl->path, sizeof(resctrl->path), "%s", (path != NULL) ? path : RESCTRL_DEFAULT_PATH);
+
+	// the kernel exposes the resources it enabled, with closids already halved by code and data prioritization
+	if(read_value(resctrl, "info/L3/cbm_mask", 1, &resctrl->cbm_mask) && read_value(resctrl, "info/L3/num_closids", 0, &resctrl->closids))
+	{
+		resctrl->mounted = 1;
+
+		if(!read_value(resctrl, "info/L3/min_cbm_bits", 0, &resctrl->min_cbm_bits))
+			resctrl->min_cbm_bits = 1;
+
+		read_value(resctrl, "info/L3/shareable_bits", 1, &resctrl->shareable_bits);
+
+		if(read_value(resctrl, "info/MB/num_closids", 0, &resctrl->mba_closids))
+		{
+			read_value(resctrl, "info/MB/min_bandwidth", 0, &resctrl->mba_min);
+			read_value(resctrl, "info/MB/bandwidth_gran", 0, &resctrl->mba_gran);
+		}
+
+		read_domains(resctrl);
+
+		if(mounted_mbps(resctrl->path))
+			resctrl->mba_percent = 0;
+	}
+
+	// otherwise derive the resources from the cpuid leaves as the kernel would
+	else if(info->rdt.l3.cbm_length != 0)
+	{
+		resctrl->cbm_mask = (info->rdt.l3.cbm_length < 32) ? (1u << info->rdt.l3.cbm_length) - 1 : 0xFFFFFFFF;
+		resctrl->min_cbm_bits = 1;
+		resctrl->shareable_bits = info->rdt.l3.shared_mask;
+		resctrl->closids = info->rdt.l3.closids;
+
+		// the minimum bandwidth and the granularity are both 100 minus the maximum throttling value
+		if(info->rdt.mba_max != 0 && info->rdt.mba_linear)
+		{
+			resctrl->mba_closids = info->rdt.mba_closids;
+			resctrl->mba_min = 100 - info->rdt.mba_max;
+			resctrl->mba_gran = 100 - info->rdt.mba_max;
+			resctrl->mba_percent = 1;
+		}
+	}
+
+	else
+		return 0;
+
+	// a domain for every l3 instance if the schemata did not list them
+	if(resctrl->domains_cnt == 0)
+	{
+		for(uint32_t i = 0; i < info->caches_cnt; ++i)
+		{
+			if(info->caches[i].level != 3)
+				continue;
+
+			for(uint32_t j = 0; j < info->caches[i].instances_cnt && resctrl->domains_cnt < RESCTRL_MAX_DOMAINS; ++j)
+				resctrl->domains[resctrl->domains_cnt++] = info->caches[i].instances[j].id;
+		}
+
+		if(resctrl->domains_cnt == 0)
+			resctrl->domains[resctrl->domains_cnt++] = 0;
+	}
+
+	if(resctrl->mba_gran == 0)
+		resctrl->mba_gran = 1;
+
+	return resctrl->cbm_mask != 0;
+}
+
+static uint32_t popcount(uint32_t mask)
+{
+	uint32_t count = 0;
+
+	for(; mask != 0; mask &= mask - 1)
+		++count;
+
+	return count;
+}
+
+resctrl_status_t resctrl_plan(const resctrl_t* resctrl, resctrl_class_t* classes, uint32_t classes_cnt, uint32_t* default_mask)
+{
+	if(resctrl->cbm_mask == 0)
+		return RESCTRL_UNSUPPORTED;
+
+	// the default group keeps a class of service
+	if(classes_cnt + 1 > resctrl->closids || classes_cnt > RESCTRL_MAX_CLASSES)
+		return RESCTRL_TOO_MANY_CLASSES;
+
+	uint32_t ways = popcount(resctrl->cbm_mask);
+	uint32_t min_ways = (resctrl->min_cbm_bits != 0) ? resctrl->min_cbm_bits : 1;
+
+	// the classes take the ways below the shared ones, which stay with the default group
+	uint32_t limit = ways;
+
+	for(uint32_t i = 0; i < ways; ++i)
+	{
+		if(resctrl->shareable_bits & (1u << i))
+		{
+			limit = i;
+			break;
+		}
+	}
+
+	// a class without a share keeps the ways of the default group
+	uint32_t limited = 0;
+
+	for(uint32_t i = 0; i < classes_cnt; ++i)
+		limited += classes[i].share != 0;
+
+	if(ways <= min_ways && limited != 0)
+		return RESCTRL_OVERSUBSCRIBED;
+
+	// the default group needs the minimum ways too
+	uint32_t capacity = (ways <= min_ways) ? 0 : (limit < ways - min_ways) ? limit : ways - min_ways;
+
+	// ways in proportion to the shares, at least the minimum ways
+	uint32_t total = 0, shares = 0;
+
+	for(uint32_t i = 0; i < classes_cnt; ++i)
+	{
+		classes[i].ways = (classes[i].share * ways + 50) / 100;
+
+		if(classes[i].share != 0 && classes[i].ways < min_ways)
+			classes[i].ways = min_ways;
+
+		total += classes[i].ways;
+		shares += classes[i].share;
+	}
+
+	// scale the shares down to the capacity if they are oversubscribed
+	if(total > capacity && shares != 0)
+	{
+		total = 0;
+
+		for(uint32_t i = 0; i < classes_cnt; ++i)
+		{
+			classes[i].ways = classes[i].share * capacity / shares;
+
+			if(classes[i].share != 0 && classes[i].ways < min_ways)
+				classes[i].ways = min_ways;
+
+			total += classes[i].ways;
+		}
+	}
+
+	if(total > capacity)
+		return RESCTRL_OVERSUBSCRIBED;
+
+	// contiguous masks from the lowest way
+	uint32_t offset = 0;
+
+	for(uint32_t i = 0; i < classes_cnt; ++i)
+	{
+		classes[i].mask = ((1u << classes[i].ways) - 1) << offset;
+		offset += classes[i].ways;
+	}
+
+	*default_mask = resctrl->cbm_mask & ~((1u << offset) - 1);
+
+	for(uint32_t i = 0; i < classes_cnt; ++i)
+	{
+		if(classes[i].share == 0)
+		{
+			classes[i].ways = popcount(*default_mask);
+			classes[i].mask = *default_mask;
+		}
+	}
+
+	// round the bandwidth up to the granularity, within the minimum and 100
+	for(uint32_t i = 0; i < classes_cnt; ++i)
+	{
+		classes[i].mba_planned = 0;
+
+		if(classes[i].mba == 0 || classes[i].mba >= 100)
+			continue;
+
+		if(resctrl->mba_closids == 0)
+			return RESCTRL_MBA_UNSUPPORTED;
+
+		if(!resctrl->mba_percent)
+			return RESCTRL_MBA_UNITS;
+
+		if(classes_cnt + 1 > resctrl->mba_closids)
+			return RESCTRL_TOO_MANY_CLASSES;
+
+		uint32_t mba = (classes[i].mba + resctrl->mba_gran - 1) / resctrl->mba_gran * resctrl->mba_gran;
+
+		if(mba < resctrl->mba_min)
+			mba = resctrl->mba_min;
+
+		classes[i].mba_planned = (mba < 100) ? mba : 100;
+	}
+
+	return RESCTRL_OK;
+}
+
+static void append(char* out, uint32_t size, uint32_t* length, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+
+	// keep counting the length past the end of the buffer
+	int written = vsnprintf((*length < size) ? out + *length : NULL, (*length < size) ? size - *length : 0, format, args);
+
+	va_end(args);
+
+	if(written > 0)
+		*length += written;
+}
+
+uint32_t resctrl_schemata(const resctrl_t* resctrl, uint32_t mask, uint32_t mba, char* out, uint32_t size)
+{
+	static const char* Resources[] = { "L3", "L3CODE", "L3DATA" };
+
+	uint32_t length = 0;
+
+	if(size != 0)
+		out[0] = '\0';
+
+	// with code and data prioritization both masks are the same
+	for(uint32_t r = resctrl->cdp ? 1 : 0; r < (resctrl->cdp ? 3u : 1u); ++r)
+	{
+		append(out, size, &length, "%s:", Resources[r]);
+
+		for(uint32_t i = 0; i < resctrl->domains_cnt; ++i)
+			append(out, size, &length, "%s%u=%x", (i != 0) ? ";" : "", resctrl->domains[i], mask);
+
+		append(out, size, &length, "\n");
+	}
+
+	// the groups that are not throttled keep the bandwidth of the unit the kernel uses
+	if(resctrl->mba_closids != 0 && mba != 0)
+	{
+		append(out, size, &length, "MB:");
+
+		for(uint32_t i = 0; i < resctrl->domains_cnt; ++i)
+			append(out, size, &length, "%s%u=%u", (i != 0) ? ";" : "", resctrl->domains[i], mba);
+
+		append(out, size, &length, "\n");
+	}
+
+	return length;
+}
+
+#if defined(__linux__)
+
+static int write_file(const char* directory, const char* name, const char* content)
+{
+	char path[512];
+
+	if(!file_path(path, sizeof(path), directory, name))
+		return 0;
+
+	FILE* file = fopen(path, "w");
+
+	if(file == NULL)
+		return 0;
+
+	// the kernel reports a rejected schemata when the file is written out
+	int written = fputs(content, file) >= 0;
+
+	return (fclose(file) == 0) && written;
+}
+
+resctrl_status_t resctrl_apply(const resctrl_t* resctrl, const resctrl_class_t* classes, uint32_t classes_cnt, uint32_t default_mask)
+{
+	char schemata[4096];
+
+	for(uint32_t i = 0; i < classes_cnt; ++i)
+	{
+		char group[512];
+
+		if(!file_path(group, sizeof(group), resctrl->path, classes[i].name))
+			return RESCTRL_WRITE_FAILED;
+
+		// reuse the group of a previous plan
+		if(mkdir(group, 0755) != 0 && errno != EEXIST)
+			return RESCTRL_WRITE_FAILED;
+
+		if(resctrl_schemata(resctrl, classes[i].mask, classes[i].mba_planned, schemata, sizeof(schemata)) >= sizeof(schemata))
+			return RESCTRL_WRITE_FAILED;
+
+		if(!write_file(group, "schemata", schemata))
+			return RESCTRL_WRITE_FAILED;
+
+		if(classes[i].cpus[0] != '\0' && !write_file(group, "cpus_list", classes[i].cpus))
+			return RESCTRL_WRITE_FAILED;
+	}
+
+	// the default group loses the ways of the classes last, so that no way is left without a group
+	if(resctrl_schemata(resctrl, default_mask, 0, schemata, sizeof(schemata)) >= sizeof(schemata))
+		return RESCTRL_WRITE_FAILED;
+
+	if(!write_file(resctrl->path, "schemata", schemata))
+		return RESCTRL_WRITE_FAILED;
+
+	return RESCTRL_OK;
+}
+
+#else
+
+// resctrl is a linux filesystem
+resctrl_status_t resctrl_apply(const resctrl_t* resctrl, const resctrl_class_t* classes, uint32_t classes_cnt, uint32_t default_mask)
+{
+	return RESCTRL_UNSUPPORTED;
+}
+
+#endif
@@ -0,0 +1,114 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "archinfo.h"
+
+// mount point of the resctrl filesystem used when no path is given
+#define RESCTRL_DEFAULT_PATH "/sys/fs/resctrl"
+
+#define RESCTRL_MAX_CLASSES 32
+#define RESCTRL_MAX_DOMAINS 64
+
+// outcome of planning or applying a partitioning
+typedef enum
+{
+	RESCTRL_OK,
+	RESCTRL_UNSUPPORTED,
+	RESCTRL_TOO_MANY_CLASSES,
+	RESCTRL_OVERSUBSCRIBED,
+	RESCTRL_MBA_UNSUPPORTED,
+	RESCTRL_MBA_UNITS,
+	RESCTRL_WRITE_FAILED,
+
+	RESCTRL_STATUSES
+
+} resctrl_status_t;
+
+extern const char* ResctrlStatusStrings[RESCTRL_STATUSES];
+
+// l3 and memory bandwidth allocation resources, from a mounted resctrl or from the cpuid leaves
+typedef struct
+{
+	char path[256];
+
+	// set if the values come from the info directory of a mounted resctrl
+	uint32_t mounted;
+
+	// every way of the l3, the minimum ways of a mask, the ways shared with other agents
+	uint32_t cbm_mask;
+	uint32_t min_cbm_bits;
+	uint32_t shareable_bits;
+	uint32_t closids;
+
+	// code and data prioritization is enabled, the masks are written to both resources
+	uint32_t cdp;
+
+	// memory bandwidth allocation percentages, 0 closids if it is not available
+	uint32_t mba_min;
+	uint32_t mba_gran;
+	uint32_t mba_closids;
+
+	// the MB schemata is a percentage, not MBps of a mount with mba_MBps or the 1/8 GB/s units of amd cpus
+	uint32_t mba_percent;
+
+	// l3 cache ids
+	uint32_t domains[RESCTRL_MAX_DOMAINS];
+	uint32_t domains_cnt;
+
+} resctrl_t;
+
+// a workload class and its resctrl group
+typedef struct
+{
+	char name[64];
+
+	// requested percentage of the l3 ways, 0 to share the mask of the default group,
+	// and of the memory bandwidth, 0 for no throttling
+	uint32_t share;
+	uint32_t mba;
+
+	// cpus moved to the group, empty to leave them in the default group
+	char cpus[256];
+
+	// planned ways, mask and bandwidth percentage, 0 if the bandwidth is not throttled
+	uint32_t ways;
+	uint32_t mask;
+	uint32_t mba_planned;
+
+} resctrl_class_t;
+
+// read the resources of a resctrl mount, a NULL path is RESCTRL_DEFAULT_PATH
+// without the info directory the resources are derived from the cpuid leaves and the l3 instances of a snapshot
+// returns 0 if the l3 cannot be partitioned
+int resctrl_open(resctrl_t* resctrl, const char* path, const archinfo_t* info);
+
+// give every class contiguous exclusive ways in proportion to its share, scaled down if the shares do not fit,
+// and round its bandwidth to the granularity, the default group keeps the remaining ways and the shared ones
+resctrl_status_t resctrl_plan(const resctrl_t* resctrl, resctrl_class_t* classes, uint32_t classes_cnt, uint32_t* default_mask);
+
+// format the schemata of a group for every domain, without a MB line if mba is 0
+// returns the length of the schemata, which is truncated to the size of the buffer
+uint32_t resctrl_schemata(const resctrl_t* resctrl, uint32_t mask, uint32_t mba, char* out, uint32_t size);
+
+// create the group of every class, write its schemata and cpus, then the schemata of the default group
+resctrl_status_t resctrl_apply(const resctrl_t* resctrl, const resctrl_class_t* classes, uint32_t classes_cnt, uint32_t default_mask);
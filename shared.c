@@ -0,0 +1,461 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if defined(__linux__)
+	#include <unistd.h>
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <signal.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shared.h"
+#include "snapshot.h"
+#include "timer.h"
+
+// "ARCHINFO" in little endian
+#define SHARED_MAGIC 0x4F464E4948435241ull
+
+// reads of a sequence left odd by a publisher that died while writing
+#define SHARED_RETRIES (1u << 20)
+
+// the segment: this header, then the snapshot image at a page aligned offset
+typedef struct
+{
+	// written last, a reader never sees a partial segment
+	uint64_t magic;
+	uint32_t version;
+
+	// set when a fresh snapshot replaces this one
+	uint32_t retired;
+
+	uint64_t publisher;
+
+	uint64_t image_offset;
+	uint64_t image_size;
+
+	// odd while the publisher writes the dynamic data
+	uint32_t sequence __attribute__((aligned(64)));
+
+	shared_dynamic_t dynamic;
+
+} shared_segment_t;
+
+#if defined(__linux__)
+
+// mark the cpus of the online list
+static uint32_t online_mask(const char* list, uint64_t* online)
+{
+	uint32_t cpus_cnt, cnt = 0;
+	uint32_t* cpus = cpulist_parse(list, &cpus_cnt);
+
+	if(cpus == NULL)
+		return 0;
+
+	for(uint32_t i = 0; i < cpus_cnt; ++i)
+	{
+		if(cpus[i] >= SHARED_MAX_CPUS)
+			continue;
+
+		online[cpus[i] / 64] |= 1ull << (cpus[i] % 64);
+		++cnt;
+	}
+
+	free(cpus);
+
+	return cnt;
+}
+
+// current frequencies of the online cpus, cpufreq reports kHz, /proc/cpuinfo MHz
+static void frequencies(shared_dynamic_t* dynamic)
+{
+	char path[128], line[256];
+	uint32_t found = 0;
+
+	for(uint32_t cpu = 0; cpu < SHARED_MAX_CPUS; ++cpu)
+	{
+		if(!(dynamic->online[cpu / 64] & (1ull << (cpu % 64))))
+			continue;
+
+		dynamic->frequencies_cnt = cpu + 1;
+
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cpufreq/scaling_cur_freq", cpu);
+		snapshot_read_line(path, line, sizeof(line));
+
+		if(line[0] != '\0')
+		{
+			dynamic->frequencies[cpu] = strtoul(line, NULL, 10) / 1000;
+			++found;
+		}
+	}
+
+	// virtual machines usually have no cpufreq driver
+	FILE* file = (found == 0) ? fopen("/proc/cpuinfo", "r") : NULL;
+
+	if(file == NULL)
+		return;
+
+	uint32_t cpu = SHARED_MAX_CPUS;
+
+	while(fgets(line, sizeof(line), file) != NULL)
+	{
+		const char* value = strchr(line, ':');
+
+		if(value == NULL)
+			continue;
+
+		if(strncmp(line, "processor", 9) == 0)
+			cpu = strtoul(value + 1, NULL, 10);
+		else if(strncmp(line, "cpu MHz", 7) == 0 && cpu < SHARED_MAX_CPUS)
+			dynamic->frequencies[cpu] = (uint32_t)strtod(value + 1, NULL);
+	}
+
+	fclose(file);
+}
+
+// publish the dynamic data with the sequence odd while it is written
+static void store(shared_segment_t* segment, const shared_dynamic_t* dynamic)
+{
+	uint32_t sequence = segment->sequence;
+
+	__atomic_store_n(&segment->sequence, sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	memcpy(&segment->dynamic, dynamic, sizeof(shared_dynamic_t));
+
+	__atomic_store_n(&segment->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+static void refresh(shared_publisher_t* publisher, const char* online)
+{
+	shared_dynamic_t dynamic;
+
+	memset(&dynamic, 0, sizeof(shared_dynamic_t));
+
+	dynamic.updates = ++publisher->updates;
+	dynamic.online_cnt = online_mask(online, dynamic.online);
+
+	frequencies(&dynamic);
+
+	dynamic.timestamp = timer_ns();
+
+	store(publisher->segment, &dynamic);
+}
+
+// check if a segment belongs to a live publisher
+static int alive(const char* name)
+{
+	int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+	struct stat st;
+
+	if(fd < 0)
+		return 0;
+
+	const shared_segment_t* segment = MAP_FAILED;
+
+	if(fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(shared_segment_t))
+		segment = mmap(NULL, sizeof(shared_segment_t), PROT_READ, MAP_SHARED, fd, 0);
+
+	close(fd);
+
+	if(segment == MAP_FAILED)
+		return 0;
+
+	int live = __atomic_load_n(&segment->magic, __ATOMIC_ACQUIRE) == SHARED_MAGIC && !segment->retired &&
+	           (kill((pid_t)segment->publisher, 0) == 0 || errno == EPERM);
+
+	munmap((void*)segment, sizeof(shared_segment_t));
+
+	return live;
+}
+
+static int create(const char* name)
+{
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+
+	// a segment left by a process that is gone is replaced
+	if(fd < 0 && errno == EEXIST && !alive(name))
+	{
+		shm_unlink(name);
+
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	}
+
+	// the readers of other users do not depend on the umask
+	if(fd >= 0)
+		fchmod(fd, 0644);
+
+	return fd;
+}
+
+static int publish(shared_publisher_t* publisher)
+{
+	char online[4096];
+	archinfo_t info;
+
+	snapshot_read_line("/sys/devices/system/cpu/online", online, sizeof(online));
+
+	publisher->online_hash = snapshot_hash(online);
+	publisher->microcode = snapshot_microcode();
+
+	// the only discovery, every reader maps its result
+	if(!archinfo_query_ex(&info, publisher->flags))
+		return 0;
+
+	size_t image_size;
+	void* image = snapshot_image(&info, &image_size);
+
+	archinfo_free(&info);
+
+	if(image == NULL)
+		return 0;
+
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t offset = (sizeof(shared_segment_t) + page - 1) / page * page;
+	size_t size = offset + image_size;
+
+	int fd = create(publisher->name);
+	uint8_t* base = MAP_FAILED;
+
+	if(fd >= 0)
+	{
+		if(ftruncate(fd, size) == 0)
+			base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+		close(fd);
+
+		if(base == MAP_FAILED)
+			shm_unlink(publisher->name);
+	}
+
+	if(base == MAP_FAILED)
+	{
+		free(image);
+
+		return 0;
+	}
+
+	memcpy(base + offset, image, image_size);
+	free(image);
+
+	shared_segment_t* segment = (shared_segment_t*)base;
+
+	segment->version = SHARED_VERSION;
+	segment->publisher = getpid();
+	segment->image_offset = offset;
+	segment->image_size = image_size;
+
+	publisher->segment = segment;
+	publisher->segment_size = size;
+
+	refresh(publisher, online);
+
+	__atomic_store_n(&segment->magic, SHARED_MAGIC, __ATOMIC_RELEASE);
+
+	return 1;
+}
+
+static void retire(shared_publisher_t* publisher)
+{
+	shared_segment_t* segment = publisher->segment;
+
+	// attached readers keep their mappings and see the flag
+	__atomic_store_n(&segment->retired, 1, __ATOMIC_RELEASE);
+
+	shm_unlink(publisher->name);
+	munmap(segment, publisher->segment_size);
+
+	publisher->segment = NULL;
+	publisher->segment_size = 0;
+}
+
+int shared_publish(shared_publisher_t* publisher, const char* name, uint32_t flags)
+{
+	memset(publisher, 0, sizeof(shared_publisher_t));
+
+	if(name == NULL)
+		name = SHARED_DEFAULT_NAME;
+
+	if(strlen(name) >= sizeof(publisher->name))
+		return 0;
+
+	strcpy(publisher->name, name);
+	publisher->flags = flags;
+
+	return publish(publisher);
+}
+
+int shared_refresh(shared_publisher_t* publisher)
+{
+	char online[4096];
+
+	if(publisher->segment == NULL)
+		return 0;
+
+	snapshot_read_line("/sys/devices/system/cpu/online", online, sizeof(online));
+
+	// the topology or the features may have changed, discover them again
+	if(snapshot_hash(online) != publisher->online_hash || snapshot_microcode() != publisher->microcode)
+	{
+		retire(publisher);
+
+		return publish(publisher);
+	}
+
+	refresh(publisher, online);
+
+	return 1;
+}
+
+void shared_unpublish(shared_publisher_t* publisher)
+{
+	if(publisher->segment != NULL)
+		retire(publisher);
+}
+
+int shared_attach(shared_reader_t* reader, const char* name)
+{
+	memset(reader, 0, sizeof(shared_reader_t));
+
+	if(name == NULL)
+		name = SHARED_DEFAULT_NAME;
+
+	int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+
+	if(fd < 0)
+		return 0;
+
+	struct stat st;
+	const shared_segment_t* segment = MAP_FAILED;
+
+	// only trust a segment published by this user or root
+	if(fstat(fd, &st) == 0 && (st.st_uid == getuid() || st.st_uid == 0) && (size_t)st.st_size >= sizeof(shared_segment_t))
+		segment = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+	if(segment == MAP_FAILED)
+	{
+		close(fd);
+
+		return 0;
+	}
+
+	size_t size = st.st_size;
+	size_t page = sysconf(_SC_PAGESIZE);
+
+	int valid = __atomic_load_n(&segment->magic, __ATOMIC_ACQUIRE) == SHARED_MAGIC && segment->version == SHARED_VERSION &&
+	            !segment->retired && segment->image_offset % page == 0 && segment->image_offset <= size &&
+	            segment->image_size <= size - segment->image_offset &&
+	            snapshot_map(&reader->info, fd, segment->image_offset, segment->image_size);
+
+	close(fd);
+
+	if(!valid)
+	{
+		munmap((void*)segment, size);
+
+		return 0;
+	}
+
+	reader->segment = segment;
+	reader->segment_size = size;
+
+	return 1;
+}
+
+int shared_read(const shared_reader_t* reader, shared_dynamic_t* dynamic)
+{
+	const shared_segment_t* segment = reader->segment;
+
+	for(uint32_t i = 0; i < SHARED_RETRIES; ++i)
+	{
+		uint32_t begin = __atomic_load_n(&segment->sequence, __ATOMIC_ACQUIRE);
+
+		if(begin & 1)
+		{
+			__builtin_ia32_pause();
+
+			continue;
+		}
+
+		memcpy(dynamic, &segment->dynamic, sizeof(shared_dynamic_t));
+
+		// the copy is valid if no write started meanwhile
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if(__atomic_load_n(&segment->sequence, __ATOMIC_RELAXED) == begin)
+			return !__atomic_load_n(&segment->retired, __ATOMIC_ACQUIRE);
+	}
+
+	// a publisher died while writing, no copy is valid
+	memset(dynamic, 0, sizeof(shared_dynamic_t));
+
+	return 0;
+}
+
+void shared_detach(shared_reader_t* reader)
+{
+	archinfo_free(&reader->info);
+
+	munmap((void*)reader->segment, reader->segment_size);
+
+	reader->segment = NULL;
+	reader->segment_size = 0;
+}
+
+#else
+
+// posix shared memory is only published on linux
+int shared_publish(shared_publisher_t* publisher, const char* name, uint32_t flags)
+{
+	return 0;
+}
+
+int shared_refresh(shared_publisher_t* publisher)
+{
+	return 0;
+}
+
+void shared_unpublish(shared_publisher_t* publisher)
+{
+}
+
+int shared_attach(shared_reader_t* reader, const char* name)
+{
+	return 0;
+}
+
+int shared_read(const shared_reader_t* reader, shared_dynamic_t* dynamic)
+{
+	memset(dynamic, 0, sizeof(shared_dynamic_t));
+
+	return 0;
+}
+
+void shared_detach(shared_reader_t* reader)
+{
+}
+
+#endif
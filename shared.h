@@ -0,0 +1,103 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "archinfo.h"
+
+// bumped whenever the layout of the segment changes
+#define SHARED_VERSION 1
+
+// posix shared memory object used when no name is given
+#define SHARED_DEFAULT_NAME "/archinfo"
+
+#define SHARED_MAX_CPUS 1024
+
+// data refreshed periodically by the publisher
+typedef struct
+{
+	// number of refreshes and time of the last one, CLOCK_MONOTONIC nanoseconds
+	uint64_t updates;
+	uint64_t timestamp;
+
+	// online logical processors by os index
+	uint32_t online_cnt;
+	uint64_t online[SHARED_MAX_CPUS / 64];
+
+	// current frequency of each logical processor in MHz, 0 if it is offline or unknown
+	uint32_t frequencies_cnt;
+	uint32_t frequencies[SHARED_MAX_CPUS];
+
+} shared_dynamic_t;
+
+// a published snapshot, owned by the daemon process
+typedef struct
+{
+	char name[64];
+	uint32_t flags;
+
+	void* segment;
+	size_t segment_size;
+
+	// values that trigger a new discovery when they change
+	uint64_t online_hash;
+	uint32_t microcode;
+
+	// refreshes published so far
+	uint64_t updates;
+
+} shared_publisher_t;
+
+// a process attached to a published snapshot
+typedef struct
+{
+	// the static snapshot, valid until shared_detach()
+	archinfo_t info;
+
+	const void* segment;
+	size_t segment_size;
+
+} shared_reader_t;
+
+// discover the snapshot once with the ARCHINFO_* flags and publish it with the dynamic data
+// fails if another live process is publishing the same name
+// returns 0 on failure
+int shared_publish(shared_publisher_t* publisher, const char* name, uint32_t flags);
+
+// refresh the online cpus and the frequencies, the readers see the new values atomically
+// a cpu going online or offline or a microcode update republishes a fresh snapshot
+// returns 0 on failure
+int shared_refresh(shared_publisher_t* publisher);
+
+// retire and remove the published snapshot
+void shared_unpublish(shared_publisher_t* publisher);
+
+// attach to a snapshot published by a process of this user or root, a NULL name is SHARED_DEFAULT_NAME
+// returns 0 if there is no valid snapshot, the caller should query the cpu instead
+int shared_attach(shared_reader_t* reader, const char* name);
+
+// copy the latest dynamic data without locks or system calls, retrying while the publisher writes it
+// returns 0 if the snapshot was retired, the reader should detach and attach again
+// the dynamic data is zeroed, with 0 updates, if the publisher died while writing it
+int shared_read(const shared_reader_t* reader, shared_dynamic_t* dynamic);
+
+// release the snapshot and the segment
+void shared_detach(shared_reader_t* reader);
@@ -0,0 +1,512 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#if defined(__linux__)
+	#define _GNU_SOURCE
+	#include <sched.h>
+	#include <unistd.h>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "snapshot.h"
+
+#define SNAPSHOT_MAGIC "ARCHSNAP"
+
+// key of the system a snapshot is valid for
+typedef struct
+{
+	char boot_id[40];
+
+	uint32_t signature;
+	uint32_t microcode;
+
+	// hash of the online cpus list
+	uint64_t online;
+
+	// hash of the cpus the process may run on, a cgroup or taskset restricted run sees fewer of them
+	uint64_t allowed;
+
+} snapshot_key_t;
+
+// fixed layout of the file: the header, then the arrays at 8 byte aligned offsets
+typedef struct
+{
+	char magic[8];
+	uint32_t version;
+
+	// size of the decoded structures, a different build of the library does not reuse the file
+	uint32_t layout;
+
+	uint64_t size;
+
+	snapshot_key_t key;
+
+	uint64_t cpus_offset;
+	uint64_t cores_ids_offset;
+
+	uint64_t instances_offset[MAX_CACHES];
+	uint64_t instances_cpus_offset[MAX_CACHES];
+	uint32_t instances_cpus_cnt[MAX_CACHES];
+
+	// the snapshot with every pointer cleared
+	archinfo_t info;
+
+} snapshot_header_t;
+
+static uint64_t hash_bytes(const void* data, size_t size)
+{
+	const uint8_t* bytes = data;
+	uint64_t h = 0xCBF29CE484222325ull;
+
+	for(size_t i = 0; i < size; ++i)
+	{
+		h ^= bytes[i];
+		h *= 0x100000001B3ull;
+	}
+
+	return h;
+}
+
+uint64_t snapshot_hash(const char* text)
+{
+	return hash_bytes(text, strlen(text));
+}
+
+int snapshot_read_line(const char* path, char* line, size_t size)
+{
+	FILE* file = fopen(path, "r");
+
+	line[0] = '\0';
+
+	if(file == NULL)
+		return 0;
+
+	int read = fgets(line, size, file) != NULL;
+
+	fclose(file);
+
+	if(!read)
+		line[0] = '\0';
+
+	line[strcspn(line, "\n")] = '\0';
+
+	return read;
+}
+
+uint32_t snapshot_microcode()
+{
+	char line[64];
+
+	snapshot_read_line("/sys/devices/system/cpu/cpu0/microcode/version", line, sizeof(line));
+
+	return strtoul(line, NULL, 16);
+}
+
+#if defined(__linux__)
+
+static uint32_t layout()
+{
+	return sizeof(archinfo_t) ^ (sizeof(cpu_logical_t) << 16) ^ (sizeof(cpu_cache_instance_t) << 24);
+}
+
+// hash of the affinity of the process, 0 if it cannot be read
+static uint64_t hash_affinity()
+{
+	// the cpu set is sized for the configured cpus instead of CPU_SETSIZE
+	uint32_t max_cpus = sysconf(_SC_NPROCESSORS_CONF);
+	cpu_set_t* cpu_set = CPU_ALLOC(max_cpus);
+	size_t set_size = CPU_ALLOC_SIZE(max_cpus);
+	uint64_t h = 0;
+
+	if(cpu_set == NULL)
+		return 0;
+
+	if(sched_getaffinity(0, set_size, cpu_set) == 0)
+		h = hash_bytes(cpu_set, set_size);
+
+	CPU_FREE(cpu_set);
+
+	return h;
+}
+
+static void current_key(snapshot_key_t* key)
+{
+	char line[4096];
+	uint32_t eax, ebx, ecx, edx;
+
+	memset(key, 0, sizeof(snapshot_key_t));
+
+	snapshot_read_line("/proc/sys/kernel/random/boot_id", key->boot_id, sizeof(key->boot_id));
+
+	CPUID(0x1, eax, ebx, ecx, edx);
+	key->signature = eax;
+
+	// a late microcode update does not need a reboot
+	key->microcode = snapshot_microcode();
+
+	// neither does a cpu going offline
+	snapshot_read_line("/sys/devices/system/cpu/online", line, sizeof(line));
+	key->online = snapshot_hash(line);
+	key->allowed = hash_affinity();
+}
+
+static const char* default_path(char* path, size_t size)
+{
+	const char* runtime = getenv("XDG_RUNTIME_DIR");
+
+	if(runtime != NULL && runtime[0] != '\0')
+		snprintf(path, size, "%s/archinfo.snapshot", runtime);
+	else
+		snprintf(path, size, "/tmp/archinfo-%u.snapshot", (unsigned)getuid());
+
+	return path;
+}
+
+// check that an array of a file is inside it
+static int inside(uint64_t offset, uint64_t cnt, size_t element_size, uint64_t size)
+{
+	return offset <= size && cnt <= (size - offset) / element_size;
+}
+
+int snapshot_load(archinfo_t* info, const char* path)
+{
+	char default_name[256];
+
+	if(path == NULL)
+		path = default_path(default_name, sizeof(default_name));
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+	if(fd < 0)
+		return 0;
+
+	struct stat st;
+
+	// only trust a regular file of this user
+	int mapped = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_uid == getuid() &&
+	             snapshot_map(info, fd, 0, st.st_size);
+
+	close(fd);
+
+	return mapped;
+}
+
+int snapshot_map(archinfo_t* info, int fd, size_t offset, size_t size)
+{
+	if(size < sizeof(snapshot_header_t))
+		return 0;
+
+	// the pages with the instances are patched privately, then the whole mapping becomes read-only
+	uint8_t* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, offset);
+
+	if(base == MAP_FAILED)
+		return 0;
+
+	snapshot_header_t* header = (snapshot_header_t*)base;
+	snapshot_key_t key;
+
+	current_key(&key);
+
+	int valid = memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) == 0 &&
+	            header->version == SNAPSHOT_VERSION && header->layout == layout() && header->size == size &&
+	            memcmp(&header->key, &key, sizeof(snapshot_key_t)) == 0;
+
+	const archinfo_t* cached = &header->info;
+	const cpu_topology_t* topology = &cached->topology;
+
+	valid = valid && cached->caches_cnt <= MAX_CACHES && cached->tlb_descriptors_cnt <= MAX_TLB_DESCRIPTORS && cached->tlbs_cnt <= MAX_TLBS &&
+	        cached->core_types_cnt <= CORE_TYPES &&
+	        topology->cores_cnt <= topology->threads_cnt &&
+	        inside(header->cpus_offset, topology->threads_cnt, sizeof(cpu_logical_t), size) &&
+	        inside(header->cores_ids_offset, topology->cores_cnt, sizeof(uint32_t), size);
+
+	// the core types index CoreTypeStrings
+	for(uint32_t t = 0; valid && t < cached->core_types_cnt; ++t)
+		valid = cached->core_types[t].type < CORE_TYPES;
+
+	const cpu_logical_t* cpus = (const cpu_logical_t*)(base + header->cpus_offset);
+
+	for(uint32_t i = 0; valid && i < topology->threads_cnt; ++i)
+		valid = cpus[i].core_type < CORE_TYPES;
+
+	for(uint32_t i = 0; valid && i < cached->caches_cnt; ++i)
+	{
+		const cpu_cache_t* cache = &cached->caches[i];
+
+		valid = inside(header->instances_offset[i], cache->instances_cnt, sizeof(cpu_cache_instance_t), size) &&
+		        inside(header->instances_cpus_offset[i], header->instances_cpus_cnt[i], sizeof(uint32_t), size);
+
+		// the instances store the index of their first cpu in place of the pointer
+		cpu_cache_instance_t* instances = (cpu_cache_instance_t*)(base + header->instances_offset[i]);
+		uint32_t* instances_cpus = (uint32_t*)(base + header->instances_cpus_offset[i]);
+
+		for(uint32_t k = 0; valid && k < cache->instances_cnt; ++k)
+		{
+			uintptr_t first = (uintptr_t)instances[k].cpus;
+
+			valid = first <= header->instances_cpus_cnt[i] && instances[k].cpus_cnt <= header->instances_cpus_cnt[i] - first;
+
+			if(valid)
+				instances[k].cpus = instances_cpus + first;
+		}
+	}
+
+	if(!valid || mprotect(base, size, PROT_READ) != 0)
+	{
+		munmap(base, size);
+
+		return 0;
+	}
+
+	*info = *cached;
+
+	info->topology.cpus = (cpu_logical_t*)(base + header->cpus_offset);
+	info->topology.cores_ids = (uint32_t*)(base + header->cores_ids_offset);
+
+	for(uint32_t i = 0; i < info->caches_cnt; ++i)
+	{
+		info->caches[i].instances = (cpu_cache_instance_t*)(base + header->instances_offset[i]);
+		info->caches[i].instances_cpus = (uint32_t*)(base + header->instances_cpus_offset[i]);
+	}
+
+	info->mapping = base;
+	info->mapping_size = size;
+
+	return 1;
+}
+
+static uint64_t reserve(uint64_t* size, uint64_t cnt, size_t element_size)
+{
+	uint64_t offset = *size;
+
+	*size = (offset + cnt * element_size + 7) & ~(uint64_t)7;
+
+	return offset;
+}
+
+static int write_all(int fd, const void* data, size_t size)
+{
+	const uint8_t* bytes = data;
+
+	while(size != 0)
+	{
+		ssize_t written = write(fd, bytes, size);
+
+		if(written <= 0)
+			return 0;
+
+		bytes += written;
+		size -= written;
+	}
+
+	return 1;
+}
+
+void* snapshot_image(const archinfo_t* info, size_t* image_size)
+{
+	// a replayed or mapped snapshot does not describe this system
+	if(info->dump != NULL || info->mapping != NULL)
+		return NULL;
+
+	snapshot_header_t* header = calloc(1, sizeof(snapshot_header_t));
+
+	if(header == NULL)
+		return NULL;
+
+	const cpu_topology_t* topology = &info->topology;
+	uint64_t size = (sizeof(snapshot_header_t) + 7) & ~(uint64_t)7;
+
+	memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+	header->version = SNAPSHOT_VERSION;
+	header->layout = layout();
+
+	current_key(&header->key);
+
+	header->cpus_offset = reserve(&size, topology->threads_cnt, sizeof(cpu_logical_t));
+	header->cores_ids_offset = reserve(&size, topology->cores_cnt, sizeof(uint32_t));
+
+	for(uint32_t i = 0; i < info->caches_cnt; ++i)
+	{
+		const cpu_cache_t* cache = &info->caches[i];
+
+		// every cpu belongs to an instance, so the instances cpus are as many as the cpus
+		header->instances_cpus_cnt[i] = (cache->instances != NULL) ? topology->threads_cnt : 0;
+
+		header->instances_offset[i] = reserve(&size, cache->instances_cnt, sizeof(cpu_cache_instance_t));
+		header->instances_cpus_offset[i] = reserve(&size, header->instances_cpus_cnt[i], sizeof(uint32_t));
+	}
+
+	header->size = size;
+	header->info = *info;
+
+	// the pointers are rebuilt from the offsets on load
+	header->info.topology.cpus = NULL;
+	header->info.topology.cores_ids = NULL;
+
+	for(uint32_t i = 0; i < info->caches_cnt; ++i)
+	{
+		header->info.caches[i].instances = NULL;
+		header->info.caches[i].instances_cpus = NULL;
+	}
+
+	uint8_t* image = calloc(1, size);
+
+	if(image == NULL)
+	{
+		free(header);
+
+		return NULL;
+	}
+
+	memcpy(image, header, sizeof(snapshot_header_t));
+
+	if(topology->cpus != NULL)
+		memcpy(image + header->cpus_offset, topology->cpus, topology->threads_cnt * sizeof(cpu_logical_t));
+
+	if(topology->cores_ids != NULL)
+		memcpy(image + header->cores_ids_offset, topology->cores_ids, topology->cores_cnt * sizeof(uint32_t));
+
+	for(uint32_t i = 0; i < info->caches_cnt; ++i)
+	{
+		const cpu_cache_t* cache = &info->caches[i];
+		cpu_cache_instance_t* instances = (cpu_cache_instance_t*)(image + header->instances_offset[i]);
+
+		if(cache->instances == NULL)
+			continue;
+
+		memcpy(instances, cache->instances, cache->instances_cnt * sizeof(cpu_cache_instance_t));
+		memcpy(image + header->instances_cpus_offset[i], cache->instances_cpus, header->instances_cpus_cnt[i] * sizeof(uint32_t));
+
+		// the pointer of an instance becomes the index of its first cpu
+		for(uint32_t k = 0; k < cache->instances_cnt; ++k)
+			instances[k].cpus = (uint32_t*)(uintptr_t)(cache->instances[k].cpus - cache->instances_cpus);
+	}
+
+	free(header);
+
+	*image_size = size;
+
+	return image;
+}
+
+int snapshot_save(const archinfo_t* info, const char* path)
+{
+	char default_name[256];
+	size_t size;
+
+	if(path == NULL)
+		path = default_path(default_name, sizeof(default_name));
+
+	uint8_t* image = snapshot_image(info, &size);
+
+	if(image == NULL)
+		return 0;
+
+	// write a private temporary file and rename it, so readers never map a partial file
+	char temporary[300];
+	snprintf(temporary, sizeof(temporary), "%s.%u", path, (unsigned)getpid());
+
+	int fd = open(temporary, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	int saved = 0;
+
+	if(fd >= 0)
+	{
+		saved = write_all(fd, image, size);
+		saved &= (close(fd) == 0);
+
+		if(saved)
+			saved = (rename(temporary, path) == 0);
+
+		if(!saved)
+			unlink(temporary);
+	}
+
+	free(image);
+
+	return saved;
+}
+
+void snapshot_release(archinfo_t* info)
+{
+	munmap(info->mapping, info->mapping_size);
+
+	info->mapping = NULL;
+	info->mapping_size = 0;
+
+	info->topology.cpus = NULL;
+	info->topology.cores_ids = NULL;
+
+	for(uint32_t i = 0; i < info->caches_cnt; ++i)
+	{
+		info->caches[i].instances = NULL;
+		info->caches[i].instances_cpus = NULL;
+	}
+}
+
+#else
+
+// the cache needs a boot id and file mappings, elsewhere every query is live
+int snapshot_load(archinfo_t* info, const char* path)
+{
+	return 0;
+}
+
+int snapshot_map(archinfo_t* info, int fd, size_t offset, size_t size)
+{
+	return 0;
+}
+
+void* snapshot_image(const archinfo_t* info, size_t* image_size)
+{
+	return NULL;
+}
+
+int snapshot_save(const archinfo_t* info, const char* path)
+{
+	return 0;
+}
+
+void snapshot_release(archinfo_t* info)
+{
+	info->mapping = NULL;
+}
+
+#endif
+
+int archinfo_query_cached(archinfo_t* info, const char* path, uint32_t flags)
+{
+	if(snapshot_load(info, path))
+		return 1;
+
+	if(!archinfo_query_ex(info, flags))
+		return 0;
+
+	// the cache is best effort, the live snapshot is returned anyway
+	snapshot_save(info, path);
+
+	return 1;
+}
@@ -0,0 +1,62 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include "archinfo.h"
+
+// bumped whenever the layout of the file or of the cached structures changes
+#define SNAPSHOT_VERSION 8
+
+// fill a snapshot from a cache file if it was written on this boot for the same online and allowed cpus and microcode,
+// otherwise query the cpu using the ARCHINFO_* flags and rewrite the file
+// a NULL path is $XDG_RUNTIME_DIR/archinfo.snapshot, or /tmp/archinfo-<uid>.snapshot
+// returns 0 if the cpuid instruction is not available
+int archinfo_query_cached(archinfo_t* info, const char* path, uint32_t flags);
+
+// map a cache file read-only, the arrays of the snapshot point into the mapping
+// returns 0 if the file is missing, invalid or stale
+int snapshot_load(archinfo_t* info, const char* path);
+
+// write a snapshot queried from the cpu to a cache file, replacing it atomically
+// returns 0 on failure
+int snapshot_save(const archinfo_t* info, const char* path);
+
+// map a snapshot image stored at a page aligned offset of a file or shared memory descriptor
+// returns 0 if the image is invalid or stale
+int snapshot_map(archinfo_t* info, int fd, size_t offset, size_t size);
+
+// encode a snapshot queried from the cpu into an image of the cache file layout
+// returns NULL on failure, the image is released with free()
+void* snapshot_image(const archinfo_t* info, size_t* image_size);
+
+// unmap a snapshot filled by snapshot_load() or snapshot_map(), called by archinfo_free()
+void snapshot_release(archinfo_t* info);
+
+// fnv-1a hash of a string, used to key a snapshot on the online cpus list
+uint64_t snapshot_hash(const char* text);
+
+// read the first line of a sysfs or procfs file without its newline
+// returns 0 if the file cannot be read, the line is left empty
+int snapshot_read_line(const char* path, char* line, size_t size);
+
+// microcode revision of the cpu 0, 0 if it is not exposed
+uint32_t snapshot_microcode();
@@ -0,0 +1,247 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "stream.h"
+
+static double read_scalar(double* a, const double* b, const double* c, double s, size_t n)
+{
+	double sum = 0.0;
+
+	for(size_t i = 0; i < n; ++i)
+		sum += b[i];
+
+	return sum;
+}
+
+static double write_scalar(double* a, const double* b, const double* c, double s, size_t n)
+{
+	for(size_t i = 0; i < n; ++i)
+		a[i] = s;
+
+	return 0.0;
+}
+
+static double copy_scalar(double* a, const double* b, const double* c, double s, size_t n)
+{
+	for(size_t i = 0; i < n; ++i)
+		a[i] = b[i];
+
+	return 0.0;
+}
+
+static double scale_scalar(double* a, const double* b, const double* c, double s, size_t n)
+{
+	for(size_t i = 0; i < n; ++i)
+		a[i] = s * b[i];
+
+	return 0.0;
+}
+
+static double add_scalar(double* a, const double* b, const double* c, double s, size_t n)
+{
+	for(size_t i = 0; i < n; ++i)
+		a[i] = b[i] + c[i];
+
+	return 0.0;
+}
+
+static double triad_scalar(double* a, const double* b, const double* c, double s, size_t n)
+{
+	for(size_t i = 0; i < n; ++i)
+		a[i] = b[i] + s * c[i];
+
+	return 0.0;
+}
+
+// the vector kernels are the same for every instruction set, only the vector type and the intrinsics change
+// the non-temporal stores need an aligned destination, the unaligned head uses regular stores
+#define STREAM_VECTOR_KERNELS(suffix, isa, vec_t, set1, loadu, storeu, stream, add, mul) \
+	__attribute__((target(isa))) \
+	static double read_##suffix(double* a, const double* b, const double* c, double s, size_t n) \
+	{ \
+		const size_t width = sizeof(vec_t) / sizeof(double); \
+		vec_t acc0 = set1(0.0), acc1 = set1(0.0), acc2 = set1(0.0), acc3 = set1(0.0); \
+		size_t i = 0; \
+		for(; i + 4 * width <= n; i += 4 * width) \
+		{ \
+			acc0 = add(acc0, loadu(b + i)); \
+			acc1 = add(acc1, loadu(b + i + width)); \
+			acc2 = add(acc2, loadu(b + i + 2 * width)); \
+			acc3 = add(acc3, loadu(b + i + 3 * width)); \
+		} \
+		double lanes[sizeof(vec_t) / sizeof(double)]; \
+		storeu(lanes, add(add(acc0, acc1), add(acc2, acc3))); \
+		double sum = 0.0; \
+		for(size_t l = 0; l < width; ++l) \
+			sum += lanes[l]; \
+		for(; i < n; ++i) \
+			sum += b[i]; \
+		return sum; \
+	} \
+	__attribute__((target(isa))) \
+	static double write_##suffix(double* a, const double* b, const double* c, double s, size_t n) \
+	{ \
+		const size_t width = sizeof(vec_t) / sizeof(double); \
+		vec_t vs = set1(s); \
+		size_t i = 0; \
+		for(; i + width <= n; i += width) \
+			storeu(a + i, vs); \
+		for(; i < n; ++i) \
+			a[i] = s; \
+		return 0.0; \
+	} \
+	__attribute__((target(isa))) \
+	static double copy_##suffix(double* a, const double* b, const double* c, double s, size_t n) \
+	{ \
+		const size_t width = sizeof(vec_t) / sizeof(double); \
+		size_t i = 0; \
+		for(; i + width <= n; i += width) \
+			storeu(a + i, loadu(b + i)); \
+		for(; i < n; ++i) \
+			a[i] = b[i]; \
+		return 0.0; \
+	} \
+	__attribute__((target(isa))) \
+	static double scale_##suffix(double* a, const double* b, const double* c, double s, size_t n) \
+	{ \
+		const size_t width = sizeof(vec_t) / sizeof(double); \
+		vec_t vs = set1(s); \
+		size_t i = 0; \
+		for(; i + width <= n; i += width) \
+			storeu(a + i, mul(vs, loadu(b + i))); \
+		for(; i < n; ++i) \
+			a[i] = s * b[i]; \
+		return 0.0; \
+	} \
+	__attribute__((target(isa))) \
+	static double add_##suffix(double* a, const double* b, const double* c, double s, size_t n) \
+	{ \
+		const size_t width = sizeof(vec_t) / sizeof(double); \
+		size_t i = 0; \
+		for(; i + width <= n; i += width) \
+			storeu(a + i, add(loadu(b + i), loadu(c + i))); \
+		for(; i < n; ++i) \
+			a[i] = b[i] + c[i]; \
+		return 0.0; \
+	} \
+	__attribute__((target(isa))) \
+	static double triad_##suffix(double* a, const double* b, const double* c, double s, size_t n) \
+	{ \
+		const size_t width = sizeof(vec_t) / sizeof(double); \
+		vec_t vs = set1(s); \
+		size_t i = 0; \
+		for(; i + width <= n; i += width) \
+			storeu(a + i, add(loadu(b + i), mul(vs, loadu(c + i)))); \
+		for(; i < n; ++i) \
+			a[i] = b[i] + s * c[i]; \
+		return 0.0; \
+	} \
+	__attribute__((target(isa))) \
+	static double write_nt_##suffix(double* a, const double* b, const double* c, double s, size_t n) \
+	{ \
+		const size_t width = sizeof(vec_t) / sizeof(double); \
+		vec_t vs = set1(s); \
+		size_t i = 0; \
+		for(; i < n && ((uintptr_t)(a + i) % sizeof(vec_t)) != 0; ++i) \
+			a[i] = s; \
+		for(; i + width <= n; i += width) \
+			stream(a + i, vs); \
+		for(; i < n; ++i) \
+			a[i] = s; \
+		_mm_sfence(); \
+		return 0.0; \
+	} \
+	__attribute__((target(isa))) \
+	static double copy_nt_##suffix(double* a, const double* b, const double* c, double s, size_t n) \
+	{ \
+		const size_t width = sizeof(vec_t) / sizeof(double); \
+		size_t i = 0; \
+		for(; i < n && ((uintptr_t)(a + i) % sizeof(vec_t)) != 0; ++i) \
+			a[i] = b[i]; \
+		for(; i + width <= n; i += width) \
+			stream(a + i, loadu(b + i)); \
+		for(; i < n; ++i) \
+			a[i] = b[i]; \
+		_mm_sfence(); \
+		return 0.0; \
+	} \
+	__attribute__((target(isa))) \
+	static double triad_nt_##suffix(double* a, const double* b, const double* c, double s, size_t n) \
+	{ \
+		const size_t width = sizeof(vec_t) / sizeof(double); \
+		vec_t vs = set1(s); \
+		size_t i = 0; \
+		for(; i < n && ((uintptr_t)(a + i) % sizeof(vec_t)) != 0; ++i) \
+			a[i] = b[i] + s * c[i]; \
+		for(; i + width <= n; i += width) \
+			stream(a + i, add(loadu(b + i), mul(vs, loadu(c + i)))); \
+		for(; i < n; ++i) \
+			a[i] = b[i] + s * c[i]; \
+		_mm_sfence(); \
+		return 0.0; \
+	}
+
+STREAM_VECTOR_KERNELS(sse2, "sse2", __m128d, _mm_set1_pd, _mm_loadu_pd, _mm_storeu_pd, _mm_stream_pd, _mm_add_pd, _mm_mul_pd)
+
+STREAM_VECTOR_KERNELS(avx2, "avx2", __m256d, _mm256_set1_pd, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_stream_pd, _mm256_add_pd, _mm256_mul_pd)
+
+STREAM_VECTOR_KERNELS(avx512, "avx512f", __m512d, _mm512_set1_pd, _mm512_loadu_pd, _mm512_storeu_pd, _mm512_stream_pd, _mm512_add_pd, _mm512_mul_pd)
+
+#define AVX512_FEATURES .features_ext.ebx = { .avx512f = 1 }
+#define AVX2_FEATURES   .features.ecx = { .avx = 1 }, .features_ext.ebx = { .avx2 = 1 }
+#define SSE2_FEATURES   .features.edx = { .sse2 = 1 }
+
+// the candidates of a kernel, the scalar baseline of the non-temporal kernels uses regular stores
+#define STREAM_CANDIDATES_OF(kernel, scalar) \
+	{ \
+		{ "AVX-512", (dispatch_fn_t)kernel##_avx512, AVX512_FEATURES }, \
+		{ "AVX2",    (dispatch_fn_t)kernel##_avx2,   AVX2_FEATURES   }, \
+		{ "SSE2",    (dispatch_fn_t)kernel##_sse2,   SSE2_FEATURES   }, \
+		{ "Scalar",  (dispatch_fn_t)scalar                           } \
+	}
+
+static const dispatch_candidate_t ReadCandidates[STREAM_CANDIDATES]    = STREAM_CANDIDATES_OF(read, read_scalar);
+static const dispatch_candidate_t WriteCandidates[STREAM_CANDIDATES]   = STREAM_CANDIDATES_OF(write, write_scalar);
+static const dispatch_candidate_t CopyCandidates[STREAM_CANDIDATES]    = STREAM_CANDIDATES_OF(copy, copy_scalar);
+static const dispatch_candidate_t ScaleCandidates[STREAM_CANDIDATES]   = STREAM_CANDIDATES_OF(scale, scale_scalar);
+static const dispatch_candidate_t AddCandidates[STREAM_CANDIDATES]     = STREAM_CANDIDATES_OF(add, add_scalar);
+static const dispatch_candidate_t TriadCandidates[STREAM_CANDIDATES]   = STREAM_CANDIDATES_OF(triad, triad_scalar);
+static const dispatch_candidate_t WriteNtCandidates[STREAM_CANDIDATES] = STREAM_CANDIDATES_OF(write_nt, write_scalar);
+static const dispatch_candidate_t CopyNtCandidates[STREAM_CANDIDATES]  = STREAM_CANDIDATES_OF(copy_nt, copy_scalar);
+static const dispatch_candidate_t TriadNtCandidates[STREAM_CANDIDATES] = STREAM_CANDIDATES_OF(triad_nt, triad_scalar);
+
+static const stream_kernel_t Kernels[STREAM_KERNELS] =
+{
+	{ "Read",     1, ReadCandidates    },
+	{ "Write",    1, WriteCandidates   },
+	{ "Copy",     2, CopyCandidates    },
+	{ "Scale",    2, ScaleCandidates   },
+	{ "Add",      3, AddCandidates     },
+	{ "Triad",    3, TriadCandidates   },
+	{ "NT-Write", 1, WriteNtCandidates },
+	{ "NT-Copy",  2, CopyNtCandidates  },
+	{ "NT-Triad", 3, TriadNtCandidates }
+};
+
+const stream_kernel_t* const StreamKernels = Kernels;
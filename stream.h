@@ -0,0 +1,63 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include "dispatch.h"
+
+#define STREAM_CANDIDATES 4
+
+// bandwidth kernels over arrays of doubles
+typedef enum
+{
+	STREAM_READ,      // sum of b
+	STREAM_WRITE,     // a = s
+	STREAM_COPY,      // a = b
+	STREAM_SCALE,     // a = s * b
+	STREAM_ADD,       // a = b + c
+	STREAM_TRIAD,     // a = b + s * c
+	STREAM_WRITE_NT,  // a = s with non-temporal stores
+	STREAM_COPY_NT,   // a = b with non-temporal stores
+	STREAM_TRIAD_NT,  // a = b + s * c with non-temporal stores
+
+	STREAM_KERNELS
+
+} stream_kernel_id_t;
+
+// a kernel returns the sum for STREAM_READ and 0 otherwise
+// the non-temporal kernels stream to a only from its first 64 byte aligned element
+typedef double (*stream_fn_t)(double* a, const double* b, const double* c, double s, size_t n);
+
+typedef struct
+{
+	const char* name;
+
+	// arrays touched by the kernel, every element moves arrays * 8 bytes
+	uint32_t arrays;
+
+	// implementations ordered from the best to the scalar baseline
+	const dispatch_candidate_t* candidates;
+
+} stream_kernel_t;
+
+extern const stream_kernel_t* const StreamKernels;
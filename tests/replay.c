@@ -0,0 +1,178 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "archinfo.h"
+#include "dump.h"
+#include "kernels.h"
+
+// number of failed checks of every dump
+static uint32_t Failures = 0;
+
+#define CHECK(dump, value, expected) \
+	do \
+	{ \
+		unsigned long long v = (value), e = (expected); \
+		if(v != e) \
+		{ \
+			printf("%s: %s is %llu instead of %llu\n", dump, #value, v, e); \
+			Failures++; \
+		} \
+	} \
+	while(0)
+
+#define CHECK_NAME(dump, name, expected) \
+	do \
+	{ \
+		if(strcmp(name, expected) != 0) \
+		{ \
+			printf("%s: %s is %s instead of %s\n", dump, #name, name, expected); \
+			Failures++; \
+		} \
+	} \
+	while(0)
+
+// data or unified cache of a level, NULL if the snapshot does not have it
+static const cpu_cache_t* cache(const archinfo_t* info, uint32_t level)
+{
+	for(uint32_t i = 0; i < info->caches_cnt; ++i)
+		if(info->caches[i].level == level && info->caches[i].type != 2)
+			return &info->caches[i];
+
+	return NULL;
+}
+
+// replay a dump of the fixture directory and check it, returns 0 if it cannot be decoded
+static int replay(const char* directory, const char* name, void (*check)(const char*, const archinfo_t*))
+{
+	char path[512];
+	snprintf(path, sizeof(path), "%s/%s", directory, name);
+
+	FILE* file = fopen(path, "r");
+	cpuid_dump_t* dump = (file != NULL) ? dump_read(file) : NULL;
+	archinfo_t info;
+
+	if(file != NULL)
+		fclose(file);
+
+	if(dump == NULL || !archinfo_query_dump(&info, dump))
+	{
+		printf("%s: cannot be replayed\n", path);
+		dump_free(dump);
+
+		return 0;
+	}
+
+	check(name, &info);
+
+	archinfo_free(&info);
+	dump_free(dump);
+
+	return 1;
+}
+
+// captured on a single cpu kvm guest of a sapphire rapids xeon
+static void check_xeon(const char* name, const archinfo_t* info)
+{
+	CHECK(name, info->vendor_num, VENDOR_INTEL);
+	CHECK(name, info->hybrid, 0);
+
+	CHECK(name, info->topology.packages_cnt, 1);
+	CHECK(name, info->topology.cores_cnt, 1);
+	CHECK(name, info->topology.threads_cnt, 1);
+
+	CHECK(name, info->caches_cnt, 4);
+	CHECK(name, cache(info, 1)->size, 48 << 10);
+	CHECK(name, cache(info, 2)->size, 2 << 20);
+
+	CHECK(name, info->xsave.enabled_size, 11008);
+
+	CHECK_NAME(name, dispatch_select_for(info, KernelSumCandidates, KERNEL_CANDIDATES)->name, "AVX-512");
+	CHECK_NAME(name, dispatch_select_for(info, KernelDotCandidates, KERNEL_CANDIDATES)->name, "AVX-512");
+}
+
+// zen 4 with two core complexes of 4 cores and 2 threads
+static void check_genoa(const char* name, const archinfo_t* info)
+{
+	CHECK(name, info->vendor_num, VENDOR_AMD);
+	CHECK(name, info->family_num, 0x19);
+
+	CHECK(name, info->topology.packages_cnt, 1);
+	CHECK(name, info->topology.cores_cnt, 8);
+	CHECK(name, info->topology.threads_cnt, 16);
+
+	CHECK(name, cache(info, 1)->size, 32 << 10);
+	CHECK(name, cache(info, 2)->size, 1 << 20);
+	CHECK(name, cache(info, 2)->instances_cnt, 8);
+	CHECK(name, cache(info, 3)->size, 32 << 20);
+	CHECK(name, cache(info, 3)->instances_cnt, 2);
+
+	CHECK_NAME(name, dispatch_select_for(info, KernelSumCandidates, KERNEL_CANDIDATES)->name, "AVX-512");
+}
+
+// alder lake with 8 p-cores of 2 threads and 8 e-cores sharing an l2 by 4
+static void check_alderlake(const char* name, const archinfo_t* info)
+{
+	CHECK(name, info->vendor_num, VENDOR_INTEL);
+	CHECK(name, info->hybrid, 1);
+
+	CHECK(name, info->topology.packages_cnt, 1);
+	CHECK(name, info->topology.cores_cnt, 16);
+	CHECK(name, info->topology.threads_cnt, 24);
+
+	CHECK(name, cache(info, 3)->size, 30 << 20);
+	CHECK(name, cache(info, 3)->instances_cnt, 1);
+
+	const cpu_core_type_t* performance = archinfo_core_type(info, CORE_TYPE_PERFORMANCE);
+	const cpu_core_type_t* efficient = archinfo_core_type(info, CORE_TYPE_EFFICIENT);
+
+	CHECK(name, info->core_types_cnt, 2);
+
+	if(performance != NULL && efficient != NULL)
+	{
+		CHECK(name, performance->cpus_cnt, 16);
+		CHECK(name, performance->cores_cnt, 8);
+		CHECK(name, performance->l2_size, 1280 << 10);
+		CHECK(name, efficient->cpus_cnt, 8);
+		CHECK(name, efficient->cores_cnt, 8);
+		CHECK(name, efficient->l2_size, 2 << 20);
+	}
+
+	CHECK_NAME(name, dispatch_select_for(info, KernelSumCandidates, KERNEL_CANDIDATES)->name, "AVX2+FMA");
+}
+
+int main(int argc, char* argv[])
+{
+	const char* directory = (argc > 1) ? argv[1] : "tests/dumps";
+
+	int replayed = replay(directory, "xeon.dump", check_xeon) &
+	               replay(directory, "genoa.dump", check_genoa) &
+	               replay(directory, "alderlake.dump", check_alderlake);
+
+	if(!replayed || Failures != 0)
+		return 1;
+
+	printf("Every dump decoded as expected\n");
+
+	return 0;
+}
@@ -0,0 +1,229 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ftw.h>
+#include <sys/stat.h>
+
+#include "resctrl.h"
+
+// number of failed checks
+static uint32_t Failures = 0;
+
+#define CHECK(value, expected) \
+	do \
+	{ \
+		unsigned long long v = (value), e = (expected); \
+		if(v != e) \
+		{ \
+			printf("%s is %llu instead of %llu\n", #value, v, e); \
+			Failures++; \
+		} \
+	} \
+	while(0)
+
+static void write_file(const char* root, const char* name, const char* content)
+{
+	char path[512];
+	snprintf(path, sizeof(path), "%s/%s", root, name);
+
+	FILE* file = fopen(path, "w");
+
+	if(file != NULL)
+	{
+		fputs(content, file);
+		fclose(file);
+	}
+}
+
+static void read_file(const char* root, const char* name, char* content, size_t size)
+{
+	char path[512];
+	snprintf(path, sizeof(path), "%s/%s", root, name);
+
+	FILE* file = fopen(path, "r");
+	size_t length = (file != NULL) ? fread(content, 1, size - 1, file) : 0;
+
+	content[length] = '\0';
+
+	if(file != NULL)
+		fclose(file);
+}
+
+static void check_schemata(const char* root, const char* name, const char* expected)
+{
+	char content[1024];
+	read_file(root, name, content, sizeof(content));
+
+	if(strcmp(content, expected) != 0)
+	{
+		printf("%s is:\n%sinstead of:\n%s", name, content, expected);
+		Failures++;
+	}
+}
+
+// the info directory and the default schemata of a mount with two l3 domains, mb is the bandwidth of the default group
+static void fake_tree(const char* root, const char* mb)
+{
+	char path[512];
+	const char* directories[] = { "info", "info/L3", "info/MB" };
+
+	for(uint32_t i = 0; i < 3; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/%s", root, directories[i]);
+		mkdir(path, 0755);
+	}
+
+	write_file(root, "info/L3/cbm_mask", "7ff\n");
+	write_file(root, "info/L3/num_closids", "16\n");
+	write_file(root, "info/L3/min_cbm_bits", "1\n");
+	write_file(root, "info/L3/shareable_bits", "600\n");
+	write_file(root, "info/MB/num_closids", "8\n");
+	write_file(root, "info/MB/min_bandwidth", "10\n");
+	write_file(root, "info/MB/bandwidth_gran", "10\n");
+
+	snprintf(path, sizeof(path), "    L3:0=7ff;1=7ff\n    MB:0=%s;1=%s\n", mb, mb);
+	write_file(root, "schemata", path);
+}
+
+// a class with a bandwidth limit and one without it on a percentage mount
+static void check_percent(const char* root)
+{
+	archinfo_t info;
+	memset(&info, 0, sizeof(info));
+
+	fake_tree(root, "100");
+
+	resctrl_t resctrl;
+	resctrl_class_t classes[2] = { { "db", 40, 45, "0-3" }, { "batch", 20, 0, "" } };
+	uint32_t default_mask = 0;
+
+	CHECK(resctrl_open(&resctrl, root, &info), 1);
+	CHECK(resctrl.mounted, 1);
+	CHECK(resctrl.mba_percent, 1);
+	CHECK(resctrl.domains_cnt, 2);
+
+	CHECK(resctrl_plan(&resctrl, classes, 2, &default_mask), RESCTRL_OK);
+	CHECK(classes[0].mask, 0xF);
+	CHECK(classes[0].mba_planned, 50);
+	CHECK(classes[1].mask, 0x30);
+	CHECK(classes[1].mba_planned, 0);
+	CHECK(default_mask, 0x7C0);
+
+	CHECK(resctrl_apply(&resctrl, classes, 2, default_mask), RESCTRL_OK);
+
+	check_schemata(root, "db/schemata", "L3:0=f;1=f\nMB:0=50;1=50\n");
+	check_schemata(root, "batch/schemata", "L3:0=30;1=30\n");
+	check_schemata(root, "schemata", "L3:0=7c0;1=7c0\n");
+	check_schemata(root, "db/cpus_list", "0-3");
+}
+
+// the bandwidth of amd cpus and of mba_MBps mounts is not a percentage
+static void check_units(const char* root)
+{
+	archinfo_t info;
+	memset(&info, 0, sizeof(info));
+
+	fake_tree(root, "2048");
+
+	resctrl_t resctrl;
+	resctrl_class_t classes[1] = { { "db", 40, 50, "" } };
+	uint32_t default_mask = 0;
+
+	CHECK(resctrl_open(&resctrl, root, &info), 1);
+	CHECK(resctrl.mba_percent, 0);
+	CHECK(resctrl_plan(&resctrl, classes, 1, &default_mask), RESCTRL_MBA_UNITS);
+
+	classes[0].mba = 0;
+
+	CHECK(resctrl_plan(&resctrl, classes, 1, &default_mask), RESCTRL_OK);
+}
+
+// a class without a share only throttles the bandwidth and keeps the ways of the default group
+static void check_unlimited(const char* root)
+{
+	archinfo_t info;
+	memset(&info, 0, sizeof(info));
+
+	fake_tree(root, "100");
+
+	resctrl_t resctrl;
+	resctrl_class_t classes[2] = { { "db", 0, 50, "" }, { "batch", 20, 0, "" } };
+	uint32_t default_mask = 0;
+
+	CHECK(resctrl_open(&resctrl, root, &info), 1);
+
+	CHECK(resctrl_plan(&resctrl, classes, 2, &default_mask), RESCTRL_OK);
+	CHECK(classes[0].mask, 0x7FC);
+	CHECK(classes[0].ways, 9);
+	CHECK(classes[0].mba_planned, 50);
+	CHECK(classes[1].mask, 0x3);
+	CHECK(default_mask, 0x7FC);
+
+	CHECK(resctrl_apply(&resctrl, classes, 2, default_mask), RESCTRL_OK);
+
+	check_schemata(root, "db/schemata", "L3:0=7fc;1=7fc\nMB:0=50;1=50\n");
+	check_schemata(root, "batch/schemata", "L3:0=3;1=3\n");
+}
+
+static int remove_entry(const char* path, const struct stat* st, int type, struct FTW* ftw)
+{
+	return remove(path);
+}
+
+int main()
+{
+	char percent[] = "/tmp/archinfo-resctrl-XXXXXX";
+	char units[] = "/tmp/archinfo-resctrl-XXXXXX";
+	char unlimited[] = "/tmp/archinfo-resctrl-XXXXXX";
+
+	if(mkdtemp(percent) == NULL || mkdtemp(units) == NULL || mkdtemp(unlimited) == NULL)
+	{
+		printf("Cannot create the fake resctrl trees\n");
+
+		return 1;
+	}
+
+	check_percent(percent);
+	check_units(units);
+	check_unlimited(unlimited);
+
+	// leave the trees for inspection if a check failed
+	if(Failures != 0)
+	{
+		printf("Fake resctrl trees: %s %s %s\n", percent, units, unlimited);
+
+		return 1;
+	}
+
+	nftw(percent, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+	nftw(units, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+	nftw(unlimited, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+
+	printf("Every plan was written as expected\n");
+
+	return 0;
+}
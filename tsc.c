@@ -0,0 +1,112 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "archinfo.h"
+#include "tsc.h"
+#include "timer.h"
+
+#define TSC_CALIBRATION_MS 50
+#define TSC_SAMPLE_TRIES   8
+
+tsc_clock_t TscClock;
+
+// 0 uninitialized, 1 initializing, 2 ready
+static uint32_t TscState = 0;
+static int TscUsable = 0;
+
+// pair a clock reading with the tick count, keeping the tightest of a few tries
+static void sample(uint64_t* ns, uint64_t* ticks)
+{
+	uint64_t best = UINT64_MAX;
+
+	// always written, the first try replaces them
+	*ns = 0;
+	*ticks = 0;
+
+	for(uint32_t i = 0; i < TSC_SAMPLE_TRIES; ++i)
+	{
+		uint64_t before = tsc_read_ordered();
+		uint64_t now = timer_raw_ns();
+		uint64_t after = tsc_read_ordered();
+
+		if(after - before < best)
+		{
+			best = after - before;
+
+			*ns = now;
+			*ticks = before + (after - before) / 2;
+		}
+	}
+}
+
+uint64_t tsc_calibrate(uint32_t ms)
+{
+	uint64_t start_ns, start_ticks;
+	uint64_t end_ns, end_ticks;
+
+	sample(&start_ns, &start_ticks);
+
+	// spin instead of sleeping so the interval is not stretched by the scheduler wakeup
+	while(timer_raw_ns() - start_ns < (uint64_t)ms * 1000000)
+		__builtin_ia32_pause();
+
+	sample(&end_ns, &end_ticks);
+
+	return (uint64_t)((double)(end_ticks - start_ticks) * 1e9 / (double)(end_ns - start_ns));
+}
+
+int tsc_init()
+{
+	uint32_t state = 0;
+
+	// the first caller sets the clock, the others wait for it
+	if(__atomic_compare_exchange_n(&TscState, &state, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+	{
+		cpu_tsc_t tsc;
+
+		if(archinfo_tsc(&tsc))
+		{
+			TscClock.frequency = tsc.frequency;
+			TscClock.invariant = tsc.invariant;
+
+			if(TscClock.frequency == 0)
+			{
+				TscClock.frequency = tsc_calibrate(TSC_CALIBRATION_MS);
+				TscClock.calibrated = 1;
+			}
+
+			if(TscClock.frequency != 0)
+			{
+				TscClock.mult = (1000000000ull << TSC_SHIFT) / TscClock.frequency;
+				TscUsable = TscClock.invariant;
+			}
+		}
+
+		__atomic_store_n(&TscState, 2, __ATOMIC_RELEASE);
+	}
+	else
+	{
+		while(__atomic_load_n(&TscState, __ATOMIC_ACQUIRE) != 2)
+			__builtin_ia32_pause();
+	}
+
+	return TscUsable;
+}
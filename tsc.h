@@ -0,0 +1,80 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <x86intrin.h>
+
+// ticks are converted to nanoseconds as ticks * mult >> TSC_SHIFT
+#define TSC_SHIFT 32
+
+typedef struct
+{
+	// tsc frequency in Hz
+	uint64_t frequency;
+
+	// nanoseconds per tick scaled by 2^TSC_SHIFT
+	uint64_t mult;
+
+	// the counter is invariant and can be used as a clock across cores and power states
+	uint32_t invariant;
+
+	// the frequency was measured instead of enumerated by cpuid leaf 0x15
+	uint32_t calibrated;
+
+} tsc_clock_t;
+
+// the conversion factor set by tsc_init()
+extern tsc_clock_t TscClock;
+
+// measure the tsc frequency in Hz against the raw monotonic clock over a number of milliseconds
+uint64_t tsc_calibrate(uint32_t ms);
+
+// set TscClock once from cpuid leaf 0x15, or by calibration if the leaf does not enumerate the frequency
+// returns 0 if the tsc is not invariant and should not be used as a clock
+int tsc_init();
+
+// read the counter, may be reordered with the surrounding loads
+static inline uint64_t tsc_read()
+{
+	return __rdtsc();
+}
+
+// read the counter after every previous instruction has executed
+static inline uint64_t tsc_read_ordered()
+{
+	uint32_t aux;
+
+	return __rdtscp(&aux);
+}
+
+// convert ticks to nanoseconds, without 128 bit arithmetic
+static inline uint64_t tsc_ticks_ns(uint64_t ticks)
+{
+	return (ticks >> 32) * TscClock.mult + (((ticks & 0xFFFFFFFF) * TscClock.mult) >> TSC_SHIFT);
+}
+
+// nanoseconds since the counter reset, tsc_init() must have been called
+static inline uint64_t tsc_ns()
+{
+	return tsc_ticks_ns(__rdtsc());
+}
@@ -0,0 +1,286 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "writer.h"
+
+void writer_init(writer_t* writer, FILE* file)
+{
+	writer->file = file;
+	writer->error = 0;
+	writer->depth = 0;
+	writer->empty[0] = 1;
+	writer->used = 0;
+	writer->heap = NULL;
+	writer->heap_used = 0;
+	writer->heap_size = 0;
+}
+
+const void* writer_memory(const writer_t* writer, size_t* size)
+{
+	*size = (writer->heap != NULL) ? writer->heap_used : writer->used;
+
+	return (writer->heap != NULL) ? writer->heap : writer->buffer;
+}
+
+void writer_release(writer_t* writer)
+{
+	free(writer->heap);
+
+	writer_init(writer, NULL);
+}
+
+// append to the heap of a writer without a file, moving the buffered bytes first
+static void spill(writer_t* writer, const void* data, size_t size)
+{
+	size_t needed = writer->heap_used + writer->used + size;
+
+	if(needed > writer->heap_size)
+	{
+		size_t heap_size = (writer->heap_size != 0) ? writer->heap_size * 2 : WRITER_BUFFER_SIZE * 2;
+
+		while(heap_size < needed)
+			heap_size *= 2;
+
+		char* heap = realloc(writer->heap, heap_size);
+
+		if(heap == NULL)
+		{
+			writer->error = 1;
+
+			return;
+		}
+
+		writer->heap = heap;
+		writer->heap_size = heap_size;
+	}
+
+	memcpy(writer->heap + writer->heap_used, writer->buffer, writer->used);
+	writer->heap_used += writer->used;
+	writer->used = 0;
+
+	memcpy(writer->heap + writer->heap_used, data, size);
+	writer->heap_used += size;
+}
+
+int writer_flush(writer_t* writer)
+{
+	if(writer->file == NULL)
+		return !writer->error;
+
+	if(!writer->error && writer->used != 0 && fwrite(writer->buffer, 1, writer->used, writer->file) != writer->used)
+		writer->error = 1;
+
+	writer->used = 0;
+
+	if(!writer->error && fflush(writer->file) != 0)
+		writer->error = 1;
+
+	return !writer->error;
+}
+
+void writer_bytes(writer_t* writer, const void* data, size_t size)
+{
+	// a writer without a file moves to the heap once its buffer is full
+	if(writer->file == NULL && (writer->heap != NULL || writer->used + size > WRITER_BUFFER_SIZE))
+	{
+		spill(writer, data, size);
+
+		return;
+	}
+
+	// a block larger than the buffer goes straight to the file
+	if(writer->used + size > WRITER_BUFFER_SIZE)
+	{
+		if(!writer->error && writer->used != 0 && fwrite(writer->buffer, 1, writer->used, writer->file) != writer->used)
+			writer->error = 1;
+
+		writer->used = 0;
+
+		if(size > WRITER_BUFFER_SIZE)
+		{
+			if(!writer->error && fwrite(data, 1, size, writer->file) != size)
+				writer->error = 1;
+
+			return;
+		}
+	}
+
+	memcpy(writer->buffer + writer->used, data, size);
+	writer->used += size;
+}
+
+void writer_text(writer_t* writer, const char* text)
+{
+	writer_bytes(writer, text, strlen(text));
+}
+
+void writer_decimal(writer_t* writer, uint64_t value)
+{
+	char digits[20];
+	uint32_t i = sizeof(digits);
+
+	do
+	{
+		digits[--i] = '0' + value % 10;
+		value /= 10;
+	}
+	while(value != 0);
+
+	writer_bytes(writer, digits + i, sizeof(digits) - i);
+}
+
+void writer_varint(writer_t* writer, uint64_t value)
+{
+	uint8_t bytes[10];
+	uint32_t cnt = 0;
+
+	while(value >= 0x80)
+	{
+		bytes[cnt++] = (uint8_t)value | 0x80;
+		value >>= 7;
+	}
+
+	bytes[cnt++] = (uint8_t)value;
+
+	writer_bytes(writer, bytes, cnt);
+}
+
+static void escaped(writer_t* writer, const char* text)
+{
+	static const char hex[] = "0123456789abcdef";
+
+	writer_bytes(writer, "\"", 1);
+
+	for(const char* run = text; ; ++text)
+	{
+		unsigned char c = *text;
+
+		// copy the runs of plain characters at once
+		if(c != '\0' && c != '"' && c != '\\' && c >= 0x20)
+			continue;
+
+		writer_bytes(writer, run, text - run);
+
+		if(c == '\0')
+			break;
+
+		char escape[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+
+		if(c == '"' || c == '\\')
+			writer_bytes(writer, (char[2]){ '\\', c }, 2);
+		else
+			writer_bytes(writer, escape, sizeof(escape));
+
+		run = text + 1;
+	}
+
+	writer_bytes(writer, "\"", 1);
+}
+
+// separator and key of the next value at the current level
+static void key(writer_t* writer, const char* name)
+{
+	// the top level values are separate lines
+	if(writer->depth != 0 && !writer->empty[writer->depth])
+		writer_bytes(writer, ",", 1);
+
+	writer->empty[writer->depth] = 0;
+
+	if(name != NULL)
+	{
+		escaped(writer, name);
+		writer_bytes(writer, ":", 1);
+	}
+}
+
+static void begin(writer_t* writer, const char* name, char bracket)
+{
+	// the writer fails instead of writing an unbalanced value
+	if(writer->depth + 1 == WRITER_MAX_DEPTH)
+	{
+		writer->error = 1;
+
+		return;
+	}
+
+	key(writer, name);
+	writer_bytes(writer, &bracket, 1);
+
+	writer->empty[++writer->depth] = 1;
+}
+
+static void end(writer_t* writer, char bracket)
+{
+	if(writer->depth == 0)
+		return;
+
+	writer_bytes(writer, &bracket, 1);
+	--writer->depth;
+
+	// the top level value ends the line
+	if(writer->depth == 0)
+		writer_bytes(writer, "\n", 1);
+}
+
+void json_begin_object(writer_t* writer, const char* key)
+{
+	begin(writer, key, '{');
+}
+
+void json_end_object(writer_t* writer)
+{
+	end(writer, '}');
+}
+
+void json_begin_array(writer_t* writer, const char* key)
+{
+	begin(writer, key, '[');
+}
+
+void json_end_array(writer_t* writer)
+{
+	end(writer, ']');
+}
+
+void json_string(writer_t* writer, const char* name, const char* value)
+{
+	key(writer, name);
+
+	if(value != NULL)
+		escaped(writer, value);
+	else
+		writer_text(writer, "null");
+}
+
+void json_uint(writer_t* writer, const char* name, uint64_t value)
+{
+	key(writer, name);
+	writer_decimal(writer, value);
+}
+
+void json_bool(writer_t* writer, const char* name, int value)
+{
+	key(writer, name);
+	writer_text(writer, value ? "true" : "false");
+}
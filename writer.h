@@ -0,0 +1,85 @@
+
+/*
+	archinfo - Copyright (c) 2017 loreloc - lorenzoloconte@outlook.it
+
+	This software is provided 'as-is', without any express or implied
+	warranty. In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	claim that you wrote the original software. If you use this software
+	in a product, an acknowledgement in the product documentation would be
+	appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define WRITER_BUFFER_SIZE 65536
+#define WRITER_MAX_DEPTH   16
+
+// buffered writer flushing to a file only when its buffer is full
+typedef struct
+{
+	FILE* file;
+
+	// set once a write to the file fails, every later write is dropped
+	int error;
+
+	// nesting of the json values and whether each level is still empty
+	uint32_t depth;
+	uint8_t empty[WRITER_MAX_DEPTH];
+
+	size_t used;
+	char buffer[WRITER_BUFFER_SIZE];
+
+	// bytes of a writer without a file that outgrew the buffer, which is empty afterwards
+	char* heap;
+	size_t heap_used;
+	size_t heap_size;
+
+} writer_t;
+
+// start writing to a file, a NULL file keeps the bytes in memory, on the heap past WRITER_BUFFER_SIZE
+void writer_init(writer_t* writer, FILE* file);
+
+// get the bytes kept by a writer without a file
+const void* writer_memory(const writer_t* writer, size_t* size);
+
+// release the heap of a writer without a file and start it again empty
+void writer_release(writer_t* writer);
+
+// write the buffered bytes to the file
+// returns 0 if a write failed
+int writer_flush(writer_t* writer);
+
+void writer_bytes(writer_t* writer, const void* data, size_t size);
+void writer_text(writer_t* writer, const char* text);
+
+// unsigned integer in decimal
+void writer_decimal(writer_t* writer, uint64_t value);
+
+// unsigned integer as a little endian base 128 varint, 7 bits per byte with the high bit set on all but the last
+void writer_varint(writer_t* writer, uint64_t value);
+
+// json values, the key is NULL inside arrays and for the top level values, which end a line
+// nesting deeper than WRITER_MAX_DEPTH - 1 levels fails the writer
+void json_begin_object(writer_t* writer, const char* key);
+void json_end_object(writer_t* writer);
+void json_begin_array(writer_t* writer, const char* key);
+void json_end_array(writer_t* writer);
+
+// a NULL string is written as null
+void json_string(writer_t* writer, const char* key, const char* value);
+void json_uint(writer_t* writer, const char* key, uint64_t value);
+void json_bool(writer_t* writer, const char* key, int value);